@@ -0,0 +1,72 @@
+/*
+ * checkpoint.h
+ * Checkpoint and restore of a running simulation
+ * Apes Collecting Bananas Simulation
+ *
+ * A checkpoint is taken under virtual time at a tick where every actor is
+ * parked on the clock, so no lock is held and no thread is mid-update. It
+ * holds the shared counters, the FamilyStatus array, each family's private
+ * state, each actor's generator state, pending wakeup and resume point, and
+ * the maze cells with the cell each female is in. Restoring rebuilds the
+ * family processes from it; under deterministic time the restored run
+ * continues exactly as the original.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#define CHECKPOINT_MAGIC "APESCKP1"
+#define CHECKPOINT_VERSION 3
+
+/*
+ * File header, followed by FamilyStatus[num_families], the babies' final
+ * counts (int32_t[num_families * babies_per_family]), FamilyState[num_families],
+ * the babies' running counts (int32_t, same size), ActorState[num_slots],
+ * MazeCell[maze_rows * maze_cols] and each female's cell
+ * (int32_t[num_families], see female_cell())
+ */
+typedef struct {
+    char magic[8];                      // CHECKPOINT_MAGIC
+    uint32_t version;                   // CHECKPOINT_VERSION
+    uint32_t seed;                      // Seed of the checkpointed run
+    int32_t time_mode;                  // TIME_MODE_* of the checkpointed run
+    int32_t num_families;
+    int32_t babies_per_family;
+    int32_t maze_rows;
+    int32_t maze_cols;
+    int32_t num_slots;                  // ActorState entries (scheduler slots)
+    int32_t num_actors;                 // Actors still registered with the clock
+    int32_t total_bananas_in_maze;
+    int32_t withdrawn_count;
+    int32_t reserved;
+    int64_t now_ms;                     // Simulated time of the checkpoint
+} CheckpointHeader;
+
+_Static_assert(sizeof(CheckpointHeader) == 64, "CheckpointHeader must stay 64 bytes");
+
+struct SharedData;
+
+/*
+ * Write a checkpoint if one was requested (SIGUSR1 or checkpoint_at_ms)
+ * Called by the virtual clock while every actor is parked and the caller
+ * holds the clock lock
+ */
+void checkpoint_poll(struct SharedData* shared);
+
+/*
+ * Read and check a checkpoint's header
+ * Returns 0 on success, -1 on failure
+ */
+int checkpoint_read_header(const char* path, CheckpointHeader* header);
+
+/*
+ * Load a checkpoint into freshly initialized shared data (same maze size,
+ * families and babies); the family processes then resume from it
+ * Actors resume their generator streams only if the seed is unchanged
+ * Returns 0 on success, -1 on failure
+ */
+int checkpoint_restore(struct SharedData* shared, const char* path);
+
+#endif /* CHECKPOINT_H */
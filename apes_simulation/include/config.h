@@ -7,6 +7,17 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#define TRACE_PATH_MAX 256
+
+/* execution_mode values */
+#define EXEC_MODE_PROCESS 0             // One process per family, one thread per ape
+#define EXEC_MODE_POOL 1                // All families in one process on a worker pool
+
+/* frame_format values (see frames.h) */
+#define FRAME_FORMAT_PPM 0              // Binary PPM (P6) frames back to back
+#define FRAME_FORMAT_Y4M 1              // YUV4MPEG2 stream, 4:4:4
+#define FRAME_FORMAT_RAW 2              // Bare RGB24 frames
+
 typedef struct {
     // Maze settings
     int maze_rows;
@@ -43,14 +54,64 @@ typedef struct {
     int baby_eaten_threshold;
     int max_simulation_time_seconds;
     
+    // Random seed (0 = pick one at startup; the chosen seed is printed)
+    unsigned int seed;
+    
+    // Runtime settings
+    int shm_hugepages;              // 1 = back shared memory with huge pages
+    int maze_lock_stripes;          // Striped cell locks (rounded to a power of two)
+    int event_ring_capacity;        // Shared event ring slots (rounded to a power of two)
+    char trace_file[TRACE_PATH_MAX];    // Binary event trace ("" = no trace)
+    long trace_max_records;         // Record slots in the trace file
+    long record_max_records;        // Decision slots in a --record file
+    int execution_mode;             // EXEC_MODE_* (pool needs virtual time)
+    int pool_workers;               // Pool worker threads (0 = online CPUs)
+    int display_refresh_ms;         // Live terminal display frame interval (wall clock)
+    char frame_file[TRACE_PATH_MAX];    // Headless frame recording ("" = off)
+    int frame_format;               // FRAME_FORMAT_*
+    int frame_interval_ms;          // Simulated time between recorded frames
+    int frame_cell_pixels;          // Side of one maze cell in a recorded frame
+
 } SimConfig;
 
+/* Sweeps (apes_batch): key=a:b:step (inclusive range) or key={x,y,...} */
+#define SWEEP_MAX_AXES 8                // Swept keys per config file
+#define SWEEP_MAX_VALUES 256            // Values per swept key
+#define SWEEP_MAX_POINTS 65536          // Grid points per sweep
+#define SWEEP_KEY_LEN 64
+#define SWEEP_VALUE_LEN 32
+
+/*
+ * One swept key and the values it takes
+ */
+typedef struct {
+    char key[SWEEP_KEY_LEN];
+    int num_values;
+    char values[SWEEP_MAX_VALUES][SWEEP_VALUE_LEN];
+} SweepAxis;
+
+/*
+ * A config file expanded into the Cartesian grid of its swept keys
+ */
+typedef struct {
+    SimConfig base;                     // Every line applied, swept keys at their first value
+    int num_axes;
+    SweepAxis axes[SWEEP_MAX_AXES];
+    int num_points;                     // Product of the axes' value counts (1 without axes)
+} ConfigSweep;
+
 /*
  * Load configuration from file
  * Returns pointer to SimConfig on success, NULL on failure
  */
 SimConfig* load_config(const char* filename);
 
+/*
+ * Load configuration from in-memory config file text (same syntax)
+ * Returns pointer to SimConfig on success, NULL on failure
+ */
+SimConfig* load_config_text(const char* text);
+
 /*
  * Print configuration values (for debugging)
  */
@@ -66,5 +127,29 @@ void free_config(SimConfig* config);
  */
 void set_default_config(SimConfig* config);
 
+/*
+ * Load a config file whose values may be sweeps (apes_batch)
+ * A plain config gives a sweep of one point without axes
+ * Returns pointer to ConfigSweep on success, NULL on failure
+ */
+ConfigSweep* load_config_sweep(const char* filename);
+
+/*
+ * Validated configuration of one grid point (0..num_points-1); the last
+ * axis varies fastest
+ * Returns pointer to SimConfig (free with free_config()), NULL on failure
+ */
+SimConfig* sweep_point_config(const ConfigSweep* sweep, int point);
+
+/*
+ * Value an axis takes at a grid point
+ */
+const char* sweep_point_value(const ConfigSweep* sweep, int point, int axis);
+
+/*
+ * Free a sweep
+ */
+void free_config_sweep(ConfigSweep* sweep);
+
 #endif /* CONFIG_H */
 
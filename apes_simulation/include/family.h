@@ -11,6 +11,10 @@
 #include "shared_data.h"
 #include "config.h"
 
+/* ActorStep.sleep_ms of a step that parks until the family event channel
+ * fires (see family_event()) instead of for a fixed time */
+#define FAMILY_PARK_EVENT -1
+
 /*
  * Local family data (private to each family process)
  * This is NOT in shared memory - each process has its own copy
@@ -34,15 +38,14 @@ typedef struct {
     
     // Baby states
     int num_babies;
-    int baby_eaten[MAX_BABIES];     // Per-baby eaten count
+    int32_t* baby_eaten;            // Per-baby eaten count (see baby_eaten_state())
     
     // Control flags
     int should_withdraw;            // Set by male when energy low
     
     // Thread synchronization (within this process)
+    // Babies wait for fights on the shared family_event() channel
     pthread_mutex_t family_lock;
-    pthread_cond_t fight_started;   // Signal babies when male fights
-    pthread_cond_t fight_ended;     // Signal when fight is over
     
     // References to shared data
     SharedData* shared;
@@ -50,12 +53,25 @@ typedef struct {
     
 } FamilyLocal;
 
+/*
+ * Where a family thread's step ended: the simulated sleep it parks for and
+ * the RESUME_* point its next step continues from
+ */
+typedef struct {
+    int sleep_ms;                   // Or FAMILY_PARK_EVENT
+    int resume;
+    int resume_arg;                 // Opponent of a male fight in progress
+    uint32_t event_seen;            // Event generation a FAMILY_PARK_EVENT park waits past
+} ActorStep;
+
 /*
  * Baby thread argument structure
  */
 typedef struct {
     int baby_id;
     FamilyLocal* family;
+    pthread_t tid;
+    int started;                    // 1 once the thread is running
 } BabyArg;
 
 /*
@@ -64,6 +80,20 @@ typedef struct {
  */
 void run_family_process(int family_id, SharedData* shared, const SimConfig* config);
 
+/*
+ * Pool execution: set up a family inside the calling process and seed the
+ * generator streams its threads' steps will use
+ */
+void start_family_tasks(FamilyLocal* local, int family_id, SharedData* shared,
+                        const SimConfig* config);
+
+/*
+ * Pool execution: run one step of family thread role (ROLE_FEMALE,
+ * ROLE_MALE or ROLE_BABY + baby_id), then queue its next step on the
+ * clock or retire it
+ */
+void run_family_step(FamilyLocal* local, int role);
+
 /*
  * Thread function: Female ape
  * - Navigates maze collecting bananas
@@ -90,6 +120,18 @@ void* male_thread(void* arg);
  */
 void* baby_thread(void* arg);
 
+/*
+ * Signal family_id's event channel: its babies re-check their wait
+ * (fight started or ended, male stopped)
+ */
+void wake_family(SharedData* shared, int family_id);
+
+/*
+ * Signal every family's event channel, after simulation_running was
+ * cleared, so waiting babies exit at once
+ */
+void wake_all_families(SharedData* shared);
+
 /*
  * Get neighboring family IDs (linear basket arrangement)
  * Sets left and right to neighbor IDs, or -1 if no neighbor
@@ -110,12 +152,13 @@ float calculate_fight_probability(int my_bananas, int their_bananas, const SimCo
 void female_fight(FamilyLocal* local, int other_family_id);
 
 /*
- * Execute male fight
+ * Start a male fight
  * Called when male decides to fight neighbor
- * Random winner takes loser's basket
- * Signals babies during fight
+ * Signals babies, then ends the male's step with a park for the fight's
+ * duration; its next step settles it (random winner takes loser's basket)
+ * Returns 1 if the fight started, 0 if it was called off
  */
-void male_fight(FamilyLocal* local, int opponent_id);
+int male_fight(FamilyLocal* local, int opponent_id, ActorStep* step);
 
 /*
  * Thread-safe basket operations
@@ -0,0 +1,55 @@
+/*
+ * frames.h
+ * Headless frame recorder: the maze rendered to a video file
+ * Apes Collecting Bananas Simulation
+ *
+ * A software rasteriser draws the maze the way apes_viewer does (exit band,
+ * rocks, bananas, one monkey per family colour, grid lines) into a pixel
+ * buffer, and the monitor writes one frame every frame_interval_ms of
+ * simulated time (wall time in real mode). The picture follows the
+ * published snapshot (see Snapshot): each cell is copied from a
+ * prerendered stamp, and only the cells in blocks whose snapshot counter
+ * moved are redrawn, so a frame costs about one write() of the buffer.
+ */
+
+#ifndef FRAMES_H
+#define FRAMES_H
+
+#include <stdint.h>
+
+struct SharedData;
+
+#define FRAME_MAX_BYTES (1u << 30)      // Largest frame frames_open() accepts
+
+/*
+ * Start recording the maze of shared to path (FRAME_FORMAT_* file layout)
+ * Call after the maze is built; interval_ms is the simulated time between
+ * frames, cell_pixels the side of one cell in pixels
+ * Returns 0 on success, -1 on failure
+ */
+int frames_open(const char* path, int format, int interval_ms, int cell_pixels,
+                const struct SharedData* shared);
+
+/*
+ * Write the frames due by now (repeating the current picture for any the
+ * caller slept through); no-op when not recording
+ */
+void frames_capture(const struct SharedData* shared);
+
+/*
+ * Milliseconds until the next frame is due (0 if one is due now), or -1
+ * when not recording
+ */
+long frames_due_in_ms(const struct SharedData* shared);
+
+/*
+ * Stop recording and close the file
+ */
+void frames_close(void);
+
+/*
+ * Name of a FRAME_FORMAT_* constant
+ */
+const char* frame_format_name(int format);
+
+#endif /* FRAMES_H */
@@ -14,6 +14,9 @@
 #include <stdarg.h>
 #include <time.h>
 #include <ctype.h>
+#include <limits.h>
+#include <errno.h>
+#include <sched.h>
 
 /* ==================== POSIX Headers ==================== */
 #include <unistd.h>
@@ -23,8 +26,10 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
-#include <sys/shm.h>
-#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
 
 /* ==================== Project Headers ==================== */
 #include "shared_data.h"
@@ -33,6 +38,14 @@
 #include "maze.h"
 #include "family.h"
 #include "sem_wrapper.h"
+#include "sim_clock.h"
+#include "simulation.h"
+#include "trace.h"
+#include "replay.h"
+#include "checkpoint.h"
+#include "pool.h"
+#include "screen.h"
+#include "frames.h"
 
 #endif /* LOCAL_H */
 
@@ -16,6 +16,19 @@
  */
 void init_maze(SharedData* shared, const SimConfig* config);
 
+/*
+ * Recompute the banana distance field from scratch (multi-source BFS from
+ * every cell holding bananas); init_maze and checkpoint restore call it,
+ * take_bananas keeps it current incrementally afterwards
+ */
+void build_banana_field(SharedData* shared);
+
+/*
+ * Rebuild the cells' occupant lists from the family -> cell map
+ * (female_cell()); checkpoint restore calls it
+ */
+void build_female_index(SharedData* shared);
+
 /*
  * Print the maze to console (for debugging)
  * Shows obstacles, bananas, and female positions
@@ -27,21 +40,26 @@ void print_maze(const SharedData* shared);
  */
 void print_maze_colored(const SharedData* shared);
 
+struct Screen;
+
 /*
- * Print compact maze with colors (2 chars per cell)
+ * Draw the compact maze with colors (2 columns per cell) into a live
+ * display frame (see screen.h), from cells copied out of the published
+ * snapshot (rows * cols entries, see Snapshot)
  */
-void print_maze_compact(const SharedData* shared);
+void draw_maze_compact(struct Screen* screen, const SharedData* shared, const SnapshotCell* cells);
 
 /*
  * Get number of bananas at a specific cell
- * Thread-safe: uses cell lock
+ * Thread-safe: atomic load
  */
 int get_bananas_at(SharedData* shared, int x, int y);
 
 /*
  * Take bananas from a cell
  * Returns the actual number of bananas taken (may be less than requested)
- * Thread-safe: uses cell lock
+ * Thread-safe: lock-free compare-and-swap on the cell, atomic decrement of
+ * total_bananas_in_maze
  */
 int take_bananas(SharedData* shared, int x, int y, int count);
 
@@ -67,15 +85,18 @@ int is_passable(const SharedData* shared, int x, int y);
 int get_random_start_position(const SharedData* shared, int* x, int* y);
 
 /*
- * Get next move direction towards exit (simple pathfinding)
- * Exit is defined as row 0 (top of maze)
+ * Get next move direction towards exit
+ * Exit is defined as row 0 (top of maze); cells with a path follow the
+ * shortest-path field built by init_maze, the rest fall back to greedy
+ * up / sideways / down steps
  * Returns direction constant (DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT) or -1 if stuck
  */
 int get_direction_to_exit(const SharedData* shared, int x, int y);
 
 /*
  * Get next move direction to explore maze (find bananas)
- * Prefers cells with bananas, avoids obstacles
+ * Prefers cells with bananas, then the neighbour nearest to remaining
+ * bananas by the banana distance field; avoids obstacles
  */
 int get_direction_to_explore(const SharedData* shared, int x, int y);
 
@@ -87,13 +108,19 @@ int get_direction_to_explore(const SharedData* shared, int x, int y);
 int move_in_direction(const SharedData* shared, int* x, int* y, int direction);
 
 /*
- * Mark a female as present/absent in a cell
+ * Mark a female as present/absent in a cell of the spatial index
+ * Present moves her there from the cell she was in (if any); absent only
+ * removes her if she is in this cell. A move holds both cells' lock
+ * stripes, so no reader sees her in neither cell. Only the family's own
+ * female may call it.
  */
 void set_female_in_cell(SharedData* shared, int x, int y, int family_id, int present);
 
 /*
  * Check if another female is in the same cell
- * Returns the family_id of the other female, or -1 if none
+ * Returns the lowest family_id of another female, or -1 if none
+ * Walks the cell's occupant list under its lock stripe, cost O(females
+ * in the cell)
  */
 int check_female_collision(const SharedData* shared, int x, int y, int my_family_id);
 
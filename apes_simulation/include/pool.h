@@ -0,0 +1,43 @@
+/*
+ * pool.h
+ * Work-stealing worker pool for in-process execution
+ * Apes Collecting Bananas Simulation
+ *
+ * With execution_mode=pool every family runs inside the coordinating
+ * process: the female, male and baby threads become steps (see family.h)
+ * that the virtual clock hands out as tasks whenever they are due. A fixed
+ * set of workers runs them; each worker has its own task deque and steals
+ * from the others once it runs dry, so the thread count stays at the core
+ * count however many families there are.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+struct SharedData;
+
+typedef struct Pool Pool;
+
+/*
+ * Runs one step of a clock actor and parks or retires it on the clock
+ */
+typedef void (*PoolStepFn)(int actor, void* arg);
+
+/*
+ * Start num_workers workers (0 = one per online CPU) and switch the clock
+ * to pool execution; the first batch of steps is released at once
+ * Returns the pool, or NULL on failure
+ */
+Pool* pool_start(struct SharedData* shared, int num_workers, PoolStepFn step, void* arg);
+
+/*
+ * 1 once every actor has exited (safe to poll from a signal handler)
+ */
+int pool_finished(const Pool* pool);
+
+/*
+ * Wait until every actor has exited, then stop the workers and free the pool
+ */
+void pool_wait(Pool* pool);
+
+#endif /* POOL_H */
@@ -0,0 +1,105 @@
+/*
+ * replay.h
+ * Deterministic record and replay of a simulation run
+ * Apes Collecting Bananas Simulation
+ *
+ * Both modes run under TIME_MODE_DETERMINISTIC, where one actor runs at a
+ * time in a fixed order. Recording logs every decision an actor makes (raw
+ * random draws, basket lock acquisitions, fight outcomes) with the config
+ * text and seed. Replaying feeds the recorded draws back, checks every
+ * other decision and the final outcome, and reports the first divergence.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include "simulation.h"
+
+#define REPLAY_MAGIC "APESRPL1"
+#define REPLAY_VERSION 4
+#define REPLAY_CONFIG_MAX 8192              // Largest config file a recording can embed
+
+/* Decision kinds */
+#define REPLAY_RNG         1                // Raw 64-bit generator output
+#define REPLAY_BASKET_LOCK 2                // Basket lock acquired (value = family)
+#define REPLAY_FIGHT       3                // Fight outcome (value = 1 if the initiator won)
+
+/*
+ * One decision (24 bytes)
+ */
+typedef struct {
+    uint64_t value;
+    int64_t time_ms;                        // Virtual time of the decision
+    int32_t actor;                          // Clock actor that made it
+    int32_t kind;                           // REPLAY_* kind
+} ReplayRecord;
+
+/*
+ * Recording file header, followed by ReplayRecord[capacity]
+ */
+typedef struct {
+    char magic[8];                          // REPLAY_MAGIC
+    uint32_t version;                       // REPLAY_VERSION
+    uint32_t record_size;                   // sizeof(ReplayRecord)
+    uint64_t capacity;                      // Record slots allocated
+    uint64_t next;                          // Decisions made (beyond capacity: not stored)
+    uint32_t seed;                          // Effective seed of the recorded run
+    uint32_t config_len;                    // Bytes used in config_text
+    int32_t has_result;                     // 1 once the run finished and result is valid
+    int32_t reserved;
+    SimResult result;                       // Outcome of the recorded run
+    char config_text[REPLAY_CONFIG_MAX];    // Config file the run was started with
+} ReplayHeader;
+
+/*
+ * Start a recording of up to max_records decisions (record_max_records):
+ * create the file and embed config_file's text
+ * A run that fills it is stopped, and replay_finish() fails
+ * Call before init_simulation()
+ * Returns 0 on success, -1 on failure
+ */
+int replay_record_open(const char* path, const char* config_file, uint64_t max_records);
+
+/*
+ * Open a recording for replay
+ * Returns the recorded configuration (seed included), or NULL on failure
+ */
+SimConfig* replay_load(const char* path);
+
+/*
+ * Bind the open recording to a run's shared data (timestamps, seed, and
+ * stopping a run that fills the recording)
+ * No-op when neither recording nor replaying
+ */
+void replay_attach(SharedData* shared);
+
+/*
+ * Set the clock actor of the calling thread (-1 = not an actor)
+ * Only actor threads take part in record and replay
+ */
+void replay_set_actor(int actor);
+
+/*
+ * Pass a raw random draw through the recorder
+ * Recording: logs it. Replaying: returns the recorded draw instead.
+ */
+uint64_t replay_rng(uint64_t drawn);
+
+/*
+ * Log (recording) or check (replaying) a decision of the calling actor
+ */
+void replay_decision(int kind, int value);
+
+/*
+ * Finish the run: store (recording) or compare (replaying) its outcome
+ * Returns 0 if the replay matched or the recording is complete, -1 otherwise
+ */
+int replay_finish(const SimResult* result);
+
+/*
+ * Trim and close the recording file
+ */
+void replay_close(void);
+
+#endif /* REPLAY_H */
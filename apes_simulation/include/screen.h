@@ -0,0 +1,70 @@
+/*
+ * screen.h
+ * Frame-buffer terminal renderer for the live display
+ * Apes Collecting Bananas Simulation
+ *
+ * A frame is composed into a grid of cells (one UTF-8 glyph and one colour
+ * each) and compared with the frame already on the terminal: only the cells
+ * that changed are sent, behind cursor-positioning escapes, and the whole
+ * update goes out in a single write(). An unchanged frame costs no output.
+ */
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#define SCREEN_DEFAULT_COLS 256         // Frame width when the output is not a terminal
+#define SCREEN_MAX_ROWS 1024            // Frame height limit when the output is not a terminal
+
+/* Cell colours (SGR sequences in screen.c) */
+enum {
+    SCREEN_PLAIN = 0,
+    SCREEN_RED,
+    SCREEN_GREEN,
+    SCREEN_BLUE,
+    SCREEN_MAGENTA,
+    SCREEN_CYAN,
+    SCREEN_YELLOW,
+    SCREEN_WALL,                        // White background block
+    SCREEN_NUM_COLORS
+};
+
+typedef struct Screen Screen;
+
+/*
+ * Create a renderer writing to fd; the first frame repaints everything
+ * Returns the screen, or NULL on failure
+ */
+Screen* screen_create(int fd);
+
+/*
+ * Free the renderer (the terminal keeps the last frame)
+ */
+void screen_destroy(Screen* screen);
+
+/*
+ * Start composing a new frame: blank grid, cursor at the top left
+ * Picks up terminal resizes (the next flush then repaints everything)
+ */
+void screen_begin(Screen* screen);
+
+/*
+ * Append formatted text at the frame cursor in the given SCREEN_* colour
+ * '\n' moves to the start of the next row; text past the right edge or
+ * the bottom of the terminal is clipped
+ */
+void screen_printf(Screen* screen, int color, const char* format, ...);
+
+/*
+ * Forget what the terminal shows, so the next flush repaints everything
+ * (e.g. after other output may have scrolled the screen)
+ */
+void screen_invalidate(Screen* screen);
+
+/*
+ * Send the cells that differ from the previous frame in one write()
+ * Leaves the terminal cursor below the frame
+ * Returns the number of bytes written, -1 on a write error
+ */
+long screen_flush(Screen* screen);
+
+#endif /* SCREEN_H */
@@ -1,47 +1,81 @@
 /*
  * sem_wrapper.h
- * Cross-platform semaphore wrapper
- * Uses named semaphores on macOS, unnamed on Linux
+ * Cross-platform process-shared locks and event channels
+ * sim_mutex_t and sim_event_t live in shared memory and work across threads
+ * and forked family processes: futex-based on Linux, spin + yield
+ * elsewhere (macOS)
  */
 
 #ifndef SEM_WRAPPER_H
 #define SEM_WRAPPER_H
 
-#include <semaphore.h>
+#include <stdint.h>
 
-#ifdef __APPLE__
-    /* macOS: Use named semaphores */
-    #define USE_NAMED_SEMAPHORES 1
-    
-    /* Store array of named semaphore pointers */
-    extern sem_t* maze_lock_ptrs[50][50];
-    extern sem_t* basket_lock_ptrs[10];
-    extern sem_t* global_lock_ptr;
-    
-#else
-    /* Linux: Use unnamed semaphores */
-    #define USE_NAMED_SEMAPHORES 0
-#endif
+/* Upper bound on adaptive spinning before a contended lock sleeps */
+#define SIM_MUTEX_MAX_SPIN 200
 
 /*
- * Initialize semaphores for simulation
- * Returns 0 on success, -1 on failure
+ * Process-shared mutex
+ * Uncontended lock/unlock is a single atomic each; contended waiters spin
+ * briefly, then sleep in the kernel until the holder wakes them
+ */
+typedef struct {
+    uint32_t state;                     // 0 = unlocked, 1 = locked, 2 = locked with sleepers
+    int32_t spin;                       // Adaptive spin estimate (iterations)
+} sim_mutex_t;
+
+/*
+ * Process-shared event channel: a generation counter that waiters sleep on
+ * A waiter reads the generation, checks its condition, then waits for the
+ * generation to move on; signal bumps it and wakes every waiter, so a
+ * signal between the check and the wait is never lost
+ */
+typedef struct {
+    uint32_t generation;                // Bumped by every signal
+    uint32_t waiters;                   // Threads asleep in sim_event_wait()
+} sim_event_t;
+
+/*
+ * Initialize a mutex (unlocked)
+ * Returns 0 (kept int for symmetry with sem_init)
+ */
+int sim_mutex_init(sim_mutex_t* mutex);
+
+/*
+ * Acquire / release a mutex
  */
-int init_simulation_semaphores(void* shared_data, int num_families, int rows, int cols);
+void sim_mutex_lock(sim_mutex_t* mutex);
+void sim_mutex_unlock(sim_mutex_t* mutex);
 
 /*
- * Cleanup semaphores
+ * Initialize an event channel (generation 0, no waiters)
  */
-void cleanup_simulation_semaphores(int num_families, int rows, int cols);
+void sim_event_init(sim_event_t* event);
 
 /*
- * Semaphore operations wrappers
+ * Current generation; read it before checking the condition waited for
+ */
+uint32_t sim_event_read(const sim_event_t* event);
+
+/*
+ * Sleep until the generation differs from seen (returns at once if it
+ * already does)
+ */
+void sim_event_wait(sim_event_t* event, uint32_t seen);
+
+/*
+ * Start a new generation and wake every waiter
+ * Lock-free and async-signal-safe
+ */
+void sim_event_signal(sim_event_t* event);
+
+/*
+ * Initialize global, basket and maze stripe locks and the family event
+ * channels for simulation
+ * Maze cells share num_stripes locks (see maze_lock_stripe), so startup
+ * cost does not grow with the maze size
+ * Returns 0 on success, -1 on failure
  */
-int sem_wait_wrapper(sem_t* sem, int row, int col, int is_maze);
-int sem_post_wrapper(sem_t* sem, int row, int col, int is_maze);
-int sem_wait_basket(sem_t* sem, int family_id);
-int sem_post_basket(sem_t* sem, int family_id);
-int sem_wait_global(sem_t* sem);
-int sem_post_global(sem_t* sem);
+int init_simulation_locks(void* shared_data, int num_families, int num_stripes);
 
 #endif /* SEM_WRAPPER_H */
@@ -7,19 +7,27 @@
 #ifndef SHARED_DATA_H
 #define SHARED_DATA_H
 
+#include <sched.h>
 #include <semaphore.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include <pthread.h>
+#include "sem_wrapper.h"
 
-/* Maximum limits */
-#define MAX_ROWS 50
-#define MAX_COLS 50
-#define MAX_FAMILIES 10
-#define MAX_BABIES 5
+/* Maximum limits (families, babies and the maze are sized at runtime) */
+#define MAX_MAZE_LOCK_STRIPES 65536     // Upper bound for maze_lock_stripes
 
 /* Event log settings */
-#define MAX_EVENTS 10
+#define MAX_EVENTS 10                   // Events shown by the live display
 #define MAX_EVENT_LEN 120
+#define MAX_EVENT_RING_CAPACITY 65536   // Upper bound for event_ring_capacity
+
+/* Change notification for read-only observers (see mark_cell_changed()) */
+#define CHANGE_BLOCK_SHIFT 6            // 64 cells per block counter
+#define CHANGE_GROUP_SHIFT 6            // 64 blocks per group counter
+#define SNAPSHOT_INTERVAL_MS 50         // Simulated ms between snapshot publishes (see Snapshot)
 
 /* Termination reasons */
 #define TERM_RUNNING 0
@@ -34,15 +42,46 @@
 #define DIR_LEFT 2
 #define DIR_RIGHT 3
 
+/* Time modes (see sim_clock.h) */
+#define TIME_MODE_REAL 0                // Actors pace themselves with wall-clock sleeps
+#define TIME_MODE_VIRTUAL 1             // Actors run under the simulated clock
+#define TIME_MODE_DETERMINISTIC 2       // Simulated clock, one actor at a time (reproducible)
+
+/* Actor roles within a family (used to derive scheduler slots) */
+#define ROLE_FEMALE 0
+#define ROLE_MALE 1
+#define ROLE_BABY 2                     // Babies use ROLE_BABY + baby_id
+
+/* Scheduler slots: one for the monitor plus one per family thread
+ * (2 + babies_per_family per family, see sim_actor_id()) */
+#define ACTOR_MONITOR 0
+
+/* Where an actor continues when a run is restored from a checkpoint */
+#define RESUME_LOOP 0                   // Top of its main loop
+#define RESUME_FEMALE_REST 1            // End of a rest: recover energy
+#define RESUME_MALE_FIGHT 2             // Settle the fight with resume_arg
+#define RESUME_BABY_FIGHT_END 3         // Wait for dad's fight to end
+#define RESUME_EXITED 4                 // Actor had already exited
+
+#define CHECKPOINT_PATH_MAX 256
+
 /*
- * Single cell in the maze
+ * Single cell in the maze (8 bytes)
+ * Which females are in the cell is kept apart, see cell_occupant()
  */
 typedef struct {
-    int bananas;                        // Number of bananas in this cell
-    int is_obstacle;                    // 1 if obstacle, 0 if passable
-    int females_in_cell[MAX_FAMILIES];  // Track which females are in this cell (1=present)
+    int32_t bananas;                    // Number of bananas in this cell
+    uint8_t is_obstacle;                // 1 if obstacle, 0 if passable
+    uint8_t exit_dir;                   // DIR_* of the next step on a shortest path to row 0
+    uint16_t reserved;
 } MazeCell;
 
+/* exit_dir of cells with no path to row 0 (and of row 0 itself) */
+#define EXIT_DIR_NONE 0xFF
+
+/* Banana distance of cells from which no banana can be reached */
+#define BANANA_DIST_NONE INT32_MAX
+
 /*
  * Public family status (visible to all processes via shared memory)
  */
@@ -58,7 +97,6 @@ typedef struct {
     int female_in_maze;                 // 1 = female is in maze, 0 = at basket
     int female_resting;                 // 1 = female is resting (vulnerable if carrying bananas!)
     int female_collected;               // Bananas female is currently carrying
-    int baby_bananas_eaten[MAX_BABIES]; // Bananas eaten by each baby
     int total_collected;                // Total bananas collected by female
     
     // Detailed banana flow tracking
@@ -70,27 +108,133 @@ typedef struct {
 } FamilyStatus;
 
 /*
- * Recent event entry for live display
+ * Slot of the shared event ring
+ * seq is ticket + 1 once the event with that ticket is complete, 0 while a
+ * producer is writing the slot (see add_shared_event / read_shared_event)
  */
 typedef struct {
-    char message[MAX_EVENT_LEN];
+    uint64_t seq;                       // Completion marker (ticket + 1)
     double timestamp;
+    char message[MAX_EVENT_LEN];
 } EventEntry;
 
+/*
+ * Per-actor state for checkpoints
+ * Each actor publishes rng and its resume point whenever it parks on the
+ * virtual clock; wake_ms and live are only filled in a checkpoint
+ */
+typedef struct {
+    uint64_t rng[4];                    // Generator state at the last park
+    int64_t wake_ms;                    // Pending wakeup (simulated ms)
+    int32_t resume;                     // RESUME_* point after the wakeup
+    int32_t resume_arg;                 // Opponent of an interrupted male fight
+    int32_t live;                       // 1 = registered with the clock, 0 = exited
+    int32_t event_wait;                 // 1 = parked until sim_wake_actor() (see sim_park_event())
+} ActorState;
+
+/*
+ * Private family state (FamilyLocal), published by the family's threads
+ * whenever one of them parks, so a checkpoint sees all of it
+ * The babies' counts live in their own region, see baby_eaten_state()
+ */
+typedef struct {
+    int basket_bananas;
+    int male_energy;
+    int male_fighting;
+    int female_energy;
+    int female_x, female_y;
+    int female_collected;
+    int female_in_maze;
+    int female_resting;
+    int should_withdraw;
+} FamilyState;
+
+/*
+ * Pending wakeup in the virtual clock's priority queue
+ */
+typedef struct {
+    long long wake_ms;                  // Simulated time at which the actor resumes
+    int actor;                          // Scheduler slot of the sleeping actor
+} ClockEntry;
+
+/*
+ * Simulated clock shared by every actor in every family process
+ * Time only advances once all registered actors are parked in sim_sleep_ms()
+ */
+typedef struct {
+    int mode;                           // TIME_MODE_REAL or TIME_MODE_VIRTUAL
+    int serial;                         // 1 = release one actor per turn (deterministic mode)
+    long long now_ms;                   // Simulated milliseconds since start
+    int num_actors;                     // Actors still registered with the clock
+    int num_waiting;                    // Actors currently parked in sim_sleep_ms()
+    int heap_size;                      // Entries in the wakeup heap
+    size_t heap_offset;                 // Byte offset of the ClockEntry min-heap (by wake_ms)
+    size_t wake_offset;                 // Byte offset of the per-actor wakeup semaphores
+    sim_mutex_t lock;                   // Protects all fields above
+} SimClock;
+
+/*
+ * One cell as observers draw it, as of the last snapshot publish
+ */
+typedef struct {
+    int32_t bananas;                    // Bananas in the cell
+    int32_t ape;                        // Lowest family whose female is here, -1 if none
+} SnapshotCell;
+
+/*
+ * Consistent copy of what the observers draw (the live display, apes_viewer
+ * and the frame recorder), refreshed by the monitor every
+ * SNAPSHOT_INTERVAL_MS under a sequence lock: seq is odd while a publish
+ * is under way. Readers take no lock and never hold up the simulation;
+ * see snapshot_read_begin(). Each publish bumps the snapshot's own change
+ * counters for the cells it rewrote, laid out like the live ones (see
+ * mark_cell_changed()).
+ */
+typedef struct {
+    uint32_t seq;                       // Publishes started and finished (odd = in progress)
+    uint32_t change_generation;         // SharedData change_generation as of the publish
+    long long elapsed_ms;               // sim_elapsed_ms() at the publish
+    int simulation_running;
+    int termination_reason;
+    int withdrawn_count;
+    int total_bananas_in_maze;
+    size_t families_offset;             // Byte offset of FamilyStatus[num_families]
+    size_t female_cell_offset;          // Byte offset of int32_t[num_families] (family -> cell)
+    size_t cells_offset;                // Byte offset of SnapshotCell[rows * cols]
+    size_t change_counts_offset;        // Byte offset of uint32_t[groups + blocks]
+} Snapshot;
+
 /*
  * Main shared memory structure
  * This is shared between the main process and all family processes
  * Note: Named struct allows forward declaration in other headers
+ *
+ * The maze cells follow this struct in the same segment as a tightly packed
+ * row-major array of maze_rows * maze_cols entries, then the banana
+ * distance field (one int32_t per cell), then the striped cell lock table
+ * (maze_lock_stripes entries). The per-family and per-actor arrays are
+ * sized from num_families and babies_per_family the same way, and so are
+ * the regions of the published snapshot. All are
+ * located by offset (not pointer) so every process can map the segment at
+ * a different address; use the accessors below.
  */
 typedef struct SharedData {
     // Maze data
-    MazeCell maze[MAX_ROWS][MAX_COLS];
+    size_t maze_offset;                 // Byte offset of MazeCell[rows * cols]
+    size_t banana_dist_offset;          // Byte offset of int32_t[rows * cols]
+    size_t maze_locks_offset;           // Byte offset of sim_mutex_t[maze_lock_stripes]
+    size_t occupant_offset;             // Byte offset of int32_t[rows * cols] (occupant list heads)
+    size_t change_counts_offset;        // Byte offset of uint32_t[groups + blocks] (see change_group())
+    int maze_lock_stripes;              // Lock table size (power of two)
     int maze_rows;
     int maze_cols;
-    int total_bananas_in_maze;          // Track remaining bananas
+    int total_bananas_in_maze;          // Track remaining bananas (atomic updates)
     
-    // Family status array
-    FamilyStatus families[MAX_FAMILIES];
+    // Family status array (variable-length regions)
+    size_t families_offset;             // Byte offset of FamilyStatus[num_families]
+    size_t baby_eaten_offset;           // Byte offset of int32_t[num_families * babies_per_family]
+    size_t female_cell_offset;          // Byte offset of int32_t[num_families] (family -> cell)
+    size_t female_next_offset;          // Byte offset of int32_t[num_families] (occupant list links)
     int num_families;
     
     // Global simulation state
@@ -98,25 +242,364 @@ typedef struct SharedData {
     int simulation_running;             // 1 = running, 0 = stopped
     int termination_reason;             // TERM_* constant
     int winning_family;                 // Family ID that caused termination (-1 if none)
+    long long termination_ms;           // Elapsed ms when a termination rule fired (-1 = none yet)
     time_t start_time;
+    unsigned int seed;                  // Effective random seed (reproduce with seed=)
+    uint32_t change_generation;         // Bumped by every change an observer can see
+    SimClock clock;                     // Real or virtual simulation time
+    
+    // What observers draw, published by the monitor (variable-length regions)
+    Snapshot snapshot;
+    
+    // Lock-free multi-producer event ring (variable-length region)
+    size_t events_offset;               // Byte offset of EventEntry[event_capacity]
+    int event_capacity;                 // Slots in the ring (power of two)
+    uint64_t event_next;                // Next ticket; producers fetch-add it
     
-    // Recent events circular buffer for live display
-    EventEntry recent_events[MAX_EVENTS];
-    int event_head;                      // Next write position
-    sem_t event_lock;                    // Lock for event buffer
+    // Checkpoint and restore (see checkpoint.h)
+    int babies_per_family;
+    int actors_per_family;              // Scheduler slots per family (2 + babies_per_family)
+    int checkpoint_pending;             // 1 = write a checkpoint at the next quiescent tick
+    long long checkpoint_at_ms;         // Also write one once simulated time reaches this (-1 = off)
+    char checkpoint_path[CHECKPOINT_PATH_MAX];
+    int restored;                       // 1 = actors resume from actor_state (--restore)
+    int restore_rng;                    // 1 = actors also resume their generator streams
+    size_t actor_state_offset;          // Byte offset of ActorState[clock slots]
+    size_t family_state_offset;         // Byte offset of FamilyState[num_families]
+    size_t baby_state_offset;           // Byte offset of int32_t[num_families * babies_per_family]
     
     // Synchronization primitives
-    // Note: These semaphores are initialized with pshared=1 for inter-process use
-    sem_t maze_locks[MAX_ROWS][MAX_COLS];   // Per-cell locks
-    sem_t basket_locks[MAX_FAMILIES];        // Per-basket locks
-    sem_t global_lock;                       // For global state updates
+    // Note: sim_mutex_t is process-shared, usable from every family process
+    size_t basket_locks_offset;              // Byte offset of sim_mutex_t[num_families]
+    size_t family_events_offset;             // Byte offset of sim_event_t[num_families]
+    sim_mutex_t global_lock;                 // For global state updates
+    sim_mutex_t banana_field_lock;           // Serializes banana distance updates
     
 } SharedData;
 
 /*
- * Shared memory key (for shmget)
+ * Cell at (row, col) of the variable-length maze region
+ * No bounds checking: callers validate with is_valid_cell()
+ */
+static inline MazeCell* maze_cell(const SharedData* shared, int row, int col) {
+    return (MazeCell*)((const char*)shared + shared->maze_offset) +
+           (size_t)row * (size_t)shared->maze_cols + (size_t)col;
+}
+
+/*
+ * Steps from (row, col) to the nearest cell holding bananas
+ * (BANANA_DIST_NONE if none is reachable); see update_banana_field()
+ * Read with relaxed atomic loads: writers hold banana_field_lock
+ */
+static inline int32_t* banana_dist(const SharedData* shared, int row, int col) {
+    return (int32_t*)((const char*)shared + shared->banana_dist_offset) +
+           (size_t)row * (size_t)shared->maze_cols + (size_t)col;
+}
+
+/*
+ * Stripe guarding (row, col) in a table of `stripes` locks (power of two)
+ * Hashes both coordinates so neighbouring cells land on different stripes
+ */
+static inline int maze_lock_stripe(int row, int col, int stripes) {
+    uint32_t h = (uint32_t)row * 73856093u ^ (uint32_t)col * 19349663u;
+    return (int)((h ^ (h >> 16)) & (uint32_t)(stripes - 1));
+}
+
+/*
+ * Lock for (row, col): one stripe of the shared lock table
+ * Cells that share a stripe also share the lock. Only a female's move
+ * holds two, lower stripe first (see set_female_in_cell())
+ */
+static inline sim_mutex_t* maze_lock(const SharedData* shared, int row, int col) {
+    return (sim_mutex_t*)((const char*)shared + shared->maze_locks_offset) +
+           maze_lock_stripe(row, col, shared->maze_lock_stripes);
+}
+
+/*
+ * Spatial index of the females in the maze
+ * Each cell heads a list of the families whose female is in it, linked
+ * through female_next() in ascending family order; female_cell() maps
+ * each family back to its cell (row * maze_cols + col, -1 = not in the
+ * maze). Writers hold the lock stripes of the cells a move touches (see
+ * set_female_in_cell()), and female_cell() goes straight from the old
+ * cell to the new one. check_female_collision() walks a list under its
+ * stripe; the lock-free readers below use relaxed atomic loads and may
+ * see a move a moment late.
+ */
+static inline int32_t* cell_occupant(const SharedData* shared, int row, int col) {
+    return (int32_t*)((const char*)shared + shared->occupant_offset) +
+           (size_t)row * (size_t)shared->maze_cols + (size_t)col;
+}
+
+static inline int32_t* female_cell(const SharedData* shared, int f) {
+    return (int32_t*)((const char*)shared + shared->female_cell_offset) + f;
+}
+
+static inline int32_t* female_next(const SharedData* shared, int f) {
+    return (int32_t*)((const char*)shared + shared->female_next_offset) + f;
+}
+
+/*
+ * Lowest family id whose female is in (row, col), or -1 if none is
+ */
+static inline int first_female(const SharedData* shared, int row, int col) {
+    return __atomic_load_n(cell_occupant(shared, row, col), __ATOMIC_RELAXED);
+}
+
+/*
+ * Families whose female is in rows row0..row1, cols col0..col1 (inclusive)
+ * Stores at most max family ids in out and returns how many it stored
+ * Walks the family -> cell map, so the cost is one load per family
+ * however large the region is
+ */
+static inline int females_in_region(const SharedData* shared, int row0, int col0,
+                                    int row1, int col1, int* out, int max) {
+    int count = 0;
+    int f;
+    
+    for (f = 0; f < shared->num_families && count < max; f++) {
+        int32_t cell = __atomic_load_n(female_cell(shared, f), __ATOMIC_RELAXED);
+        int row, col;
+        
+        if (cell < 0) continue;
+        row = cell / shared->maze_cols;
+        col = cell % shared->maze_cols;
+        if (row >= row0 && row <= row1 && col >= col0 && col <= col1) {
+            out[count++] = f;
+        }
+    }
+    return count;
+}
+
+/*
+ * Change notification for observers of the live maze (the monitor, which
+ * publishes the snapshot; see Snapshot): the maze is split into blocks of 64 cells and groups of
+ * 64 blocks, each with a counter that writers bump after changing a cell
+ * in it, and change_generation is bumped after every change. An observer
+ * keeps its own copies of the counters; one that moved since its last
+ * look marks where to rescan, so it never has to clear anything and any
+ * number of observers can follow the same segment. A bump that lands
+ * while an observer is comparing is seen on its next look.
+ */
+static inline int change_blocks(const SharedData* shared) {
+    size_t cells = (size_t)shared->maze_rows * (size_t)shared->maze_cols;
+    
+    return (int)((cells + (1u << CHANGE_BLOCK_SHIFT) - 1) >> CHANGE_BLOCK_SHIFT);
+}
+
+static inline int change_groups(const SharedData* shared) {
+    return (change_blocks(shared) + (1 << CHANGE_GROUP_SHIFT) - 1) >> CHANGE_GROUP_SHIFT;
+}
+
+static inline uint32_t* change_group(const SharedData* shared, int group) {
+    return (uint32_t*)((const char*)shared + shared->change_counts_offset) + group;
+}
+
+static inline uint32_t* change_block(const SharedData* shared, int block) {
+    return change_group(shared, change_groups(shared)) + block;
+}
+
+/*
+ * Publish a change observers see outside the maze (baskets, status)
+ */
+static inline void note_change(SharedData* shared) {
+    __atomic_add_fetch(&shared->change_generation, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Publish a change to cell (row, col): call after the cell was written
+ */
+static inline void mark_cell_changed(SharedData* shared, int row, int col) {
+    int block = (int)(((size_t)row * (size_t)shared->maze_cols + (size_t)col) >> CHANGE_BLOCK_SHIFT);
+    
+    __atomic_add_fetch(change_block(shared, block), 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(change_group(shared, block >> CHANGE_GROUP_SHIFT), 1, __ATOMIC_RELEASE);
+    note_change(shared);
+}
+
+/*
+ * Public status of family f
+ */
+static inline FamilyStatus* family_status(const SharedData* shared, int f) {
+    return (FamilyStatus*)((const char*)shared + shared->families_offset) + f;
+}
+
+/*
+ * Bananas eaten by each of family f's babies (babies_per_family entries),
+ * saved by each baby as it exits
+ */
+static inline int32_t* baby_bananas_eaten(const SharedData* shared, int f) {
+    return (int32_t*)((const char*)shared + shared->baby_eaten_offset) +
+           (size_t)f * (size_t)shared->babies_per_family;
+}
+
+/*
+ * Private state of family f as last published for checkpoints
+ */
+static inline FamilyState* family_state(const SharedData* shared, int f) {
+    return (FamilyState*)((const char*)shared + shared->family_state_offset) + f;
+}
+
+/*
+ * Running eaten counts of family f's babies: the babies count here directly,
+ * so a checkpoint sees them without a copy
+ */
+static inline int32_t* baby_eaten_state(const SharedData* shared, int f) {
+    return (int32_t*)((const char*)shared + shared->baby_state_offset) +
+           (size_t)f * (size_t)shared->babies_per_family;
+}
+
+/*
+ * Checkpoint state of clock actor `actor` (see sim_actor_id())
+ */
+static inline ActorState* actor_state(const SharedData* shared, int actor) {
+    return (ActorState*)((const char*)shared + shared->actor_state_offset) + actor;
+}
+
+/*
+ * Lock of family f's basket
+ */
+static inline sim_mutex_t* basket_lock(const SharedData* shared, int f) {
+    return (sim_mutex_t*)((const char*)shared + shared->basket_locks_offset) + f;
+}
+
+/*
+ * Event channel of family f: signalled when its male's fight starts or
+ * ends, when its male stops and when the simulation ends, so its babies
+ * sleep until one of those instead of polling
+ */
+static inline sim_event_t* family_event(const SharedData* shared, int f) {
+    return (sim_event_t*)((const char*)shared + shared->family_events_offset) + f;
+}
+
+/*
+ * The clock's wakeup heap (one entry per clock slot at most)
+ */
+static inline ClockEntry* clock_heap(const SharedData* shared) {
+    return (ClockEntry*)((const char*)shared + shared->clock.heap_offset);
+}
+
+/*
+ * Wakeup semaphore of clock actor `actor`
+ */
+static inline sem_t* clock_wake(const SharedData* shared, int actor) {
+    return (sem_t*)((const char*)shared + shared->clock.wake_offset) + actor;
+}
+
+/*
+ * Ring slot that holds (or will hold) event number `ticket`
+ */
+static inline EventEntry* event_slot(const SharedData* shared, uint64_t ticket) {
+    return (EventEntry*)((const char*)shared + shared->events_offset) +
+           (ticket & (uint64_t)(shared->event_capacity - 1));
+}
+
+/*
+ * Copy event number `ticket` into *out without blocking producers
+ * Returns 1 on success, 0 if the event is still being written or has
+ * already been overwritten by a later lap of the ring
+ */
+static inline int read_shared_event(const SharedData* shared, uint64_t ticket, EventEntry* out) {
+    const EventEntry* slot = event_slot(shared, ticket);
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    
+    if (seq != ticket + 1) return 0;
+    memcpy(out, slot, sizeof(EventEntry));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) return 0;
+    out->message[MAX_EVENT_LEN - 1] = '\0';
+    return 1;
+}
+
+/*
+ * Regions of the published snapshot (see Snapshot); read them only between
+ * snapshot_read_begin() and snapshot_read_retry()
+ */
+static inline FamilyStatus* snapshot_family(const SharedData* shared, int f) {
+    return (FamilyStatus*)((const char*)shared + shared->snapshot.families_offset) + f;
+}
+
+static inline int32_t* snapshot_female_cell(const SharedData* shared, int f) {
+    return (int32_t*)((const char*)shared + shared->snapshot.female_cell_offset) + f;
+}
+
+static inline SnapshotCell* snapshot_cell(const SharedData* shared, int row, int col) {
+    return (SnapshotCell*)((const char*)shared + shared->snapshot.cells_offset) +
+           (size_t)row * (size_t)shared->maze_cols + (size_t)col;
+}
+
+/*
+ * Counter k of the snapshot: groups first, then blocks, as change_group()
+ */
+static inline uint32_t* snapshot_change_count(const SharedData* shared, int k) {
+    return (uint32_t*)((const char*)shared + shared->snapshot.change_counts_offset) + k;
+}
+
+/*
+ * Start reading the snapshot: waits out a publish in progress
+ * Returns the sequence number to hand to snapshot_read_retry()
+ */
+static inline uint32_t snapshot_read_begin(const SharedData* shared) {
+    uint32_t seq;
+    
+    while ((seq = __atomic_load_n(&shared->snapshot.seq, __ATOMIC_ACQUIRE)) & 1u) {
+        sched_yield();
+    }
+    return seq;
+}
+
+/*
+ * Finish reading the snapshot
+ * Returns 1 if a publish overlapped the read, so what was copied may be
+ * torn and the read has to start over; 0 if it is consistent
+ */
+static inline int snapshot_read_retry(const SharedData* shared, uint32_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&shared->snapshot.seq, __ATOMIC_RELAXED) != seq;
+}
+
+/*
+ * Snapshot counters (groups, then blocks) that moved away from the
+ * reader's copies in seen, or all of them when full: stores their indices
+ * in out (groups + blocks entries) and their values in counts at the same
+ * index. Group counters that did not move skip their blocks.
+ * Returns how many indices it stored; after a read that does not have to
+ * be retried, snapshot_commit_counts() takes them over into seen
+ */
+static inline int snapshot_changed_counts(const SharedData* shared, const uint32_t* seen,
+                                          uint32_t* counts, int* out, int full) {
+    int groups = change_groups(shared);
+    int blocks = change_blocks(shared);
+    int n = 0;
+    
+    for (int g = 0; g < groups; g++) {
+        int last_block = (g + 1) << CHANGE_GROUP_SHIFT;
+        
+        counts[g] = __atomic_load_n(snapshot_change_count(shared, g), __ATOMIC_ACQUIRE);
+        if (!full && counts[g] == seen[g]) continue;
+        out[n++] = g;
+        
+        if (last_block > blocks) last_block = blocks;
+        for (int k = groups + (g << CHANGE_GROUP_SHIFT); k < groups + last_block; k++) {
+            counts[k] = __atomic_load_n(snapshot_change_count(shared, k), __ATOMIC_ACQUIRE);
+            if (full || counts[k] != seen[k]) out[n++] = k;
+        }
+    }
+    return n;
+}
+
+static inline void snapshot_commit_counts(uint32_t* seen, const uint32_t* counts,
+                                          const int* changed, int n) {
+    for (int i = 0; i < n; i++) {
+        seen[changed[i]] = counts[changed[i]];
+    }
+}
+
+/*
+ * Prefix of the per-run POSIX shared memory name ("/apes_sim_<pid>")
  */
-#define SHM_KEY 0x1234
+#define SHM_NAME_PREFIX "/apes_sim_"
+#define SHM_NAME_LEN 64
 
 #endif /* SHARED_DATA_H */
 
@@ -0,0 +1,114 @@
+/*
+ * sim_clock.h
+ * Real and virtual simulation time
+ * Apes Collecting Bananas Simulation
+ */
+
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+
+struct SharedData;
+
+/*
+ * Initialize the simulation clock
+ * num_actors is the number of threads that will pace themselves with
+ * sim_sleep_ms(); virtual time does not advance until all of them are parked
+ * Returns 0 on success, -1 on failure
+ */
+int init_sim_clock(struct SharedData* shared, int mode, int num_actors);
+
+/*
+ * Destroy the clock's wakeup semaphores
+ */
+void cleanup_sim_clock(struct SharedData* shared);
+
+/*
+ * Parse a time mode name ("real", "virtual" or "deterministic")
+ * Returns TIME_MODE_* constant, or -1 if the name is unknown
+ */
+int parse_time_mode(const char* name);
+
+/*
+ * Name of a TIME_MODE_* constant
+ */
+const char* time_mode_name(int mode);
+
+/*
+ * Scheduler slot for a family thread (role is ROLE_FEMALE, ROLE_MALE
+ * or ROLE_BABY + baby_id)
+ */
+int sim_actor_id(const struct SharedData* shared, int family_id, int role);
+
+/*
+ * Scheduler slots of a run: the monitor plus every family thread
+ */
+int sim_actor_slots(const struct SharedData* shared);
+
+/*
+ * Sleep for the given number of simulated milliseconds
+ * Real mode: plain wall-clock sleep
+ * Virtual mode: queue a wakeup and block until the clock reaches it
+ */
+void sim_sleep_ms(struct SharedData* shared, int actor, int milliseconds);
+
+/*
+ * sim_sleep_ms() for a sleep that a checkpoint may interrupt mid-action:
+ * a restored run resumes the actor at resume (RESUME_*) with resume_arg
+ * Under pool execution it only queues the actor's next step and returns
+ */
+void sim_park_ms(struct SharedData* shared, int actor, int milliseconds,
+                 int resume, int resume_arg);
+
+/*
+ * Park until another actor calls sim_wake_actor() for this one (virtual
+ * time only); a restored run resumes the actor at resume
+ * If *generation has moved on from seen, the event the actor waits for
+ * already happened, and it is due again at once
+ * Under pool execution it only marks the actor parked and returns
+ */
+void sim_park_event(struct SharedData* shared, int actor, int resume,
+                    const uint32_t* generation, uint32_t seen);
+
+/*
+ * Make an actor parked in sim_park_event() due at the current tick
+ * No-op for an actor that is not parked on an event, and in real time
+ */
+void sim_wake_actor(struct SharedData* shared, int actor);
+
+/*
+ * Called by every actor before it touches shared state
+ * Deterministic mode: wait for this actor's first turn
+ * Restored run: reload the actor's generator and sleep out its pending wakeup
+ * Returns the RESUME_* point to continue from (RESUME_LOOP for a new run)
+ */
+int sim_actor_start(struct SharedData* shared, int actor);
+
+/*
+ * Switch the virtual clock to pool execution (release = NULL switches back)
+ * Actors become steps: when one is due, release(actor, arg) is called with
+ * the clock lock held, and parking queues the next step instead of blocking.
+ * Queues every actor's first step and releases the first batch
+ */
+void sim_clock_start_pool(struct SharedData* shared, void (*release)(int actor, void* arg),
+                          void* arg);
+
+/*
+ * Unregister an actor that will not call sim_sleep_ms() again
+ * Must be called exactly once per registered actor
+ */
+void sim_actor_exit(struct SharedData* shared);
+
+/*
+ * Seconds elapsed since the simulation started (simulated in virtual mode)
+ */
+double sim_elapsed_seconds(const struct SharedData* shared);
+
+/*
+ * Milliseconds elapsed since the simulation started (whole seconds in real
+ * time); stored as termination_ms when a termination rule fires
+ */
+long long sim_elapsed_ms(const struct SharedData* shared);
+
+#endif /* SIM_CLOCK_H */
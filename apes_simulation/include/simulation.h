@@ -0,0 +1,111 @@
+/*
+ * simulation.h
+ * Lifecycle of one simulation run (shared memory, family processes, monitor)
+ * Apes Collecting Bananas Simulation
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "shared_data.h"
+#include "config.h"
+#include "family.h"
+
+struct Pool;
+
+/* Families whose final basket a SimResult keeps (the rest only count
+ * towards best_family) */
+#define SIM_RESULT_BASKETS 16
+
+/*
+ * One simulation instance
+ * Owned by the coordinating process (apes_simulation or a batch worker)
+ */
+typedef struct {
+    const SimConfig* config;
+    SharedData* shared;
+    size_t shm_size;                    // Bytes mapped for SharedData
+    char shm_name[SHM_NAME_LEN];        // POSIX shm name ("" = anonymous)
+    pid_t* child_pids;                  // One family process per family
+    int num_children;
+    pthread_t monitor_tid;
+    int monitor_started;
+    FamilyLocal* families;              // Pool execution: every family's local state
+    struct Pool* pool;                  // Pool execution: the workers running the actors
+    uint32_t* snapshot_seen;            // Live change counters as of the last snapshot publish
+} Simulation;
+
+/*
+ * Outcome of a finished run (compact, suitable for aggregation)
+ */
+typedef struct {
+    unsigned int seed;
+    int completed;                      // 1 = run finished and result is valid
+    int termination_reason;             // TERM_* constant
+    int winning_family;                 // Family that caused termination (-1 if none)
+    int best_family;                    // Family with the largest basket (-1 if none)
+    double duration_seconds;            // Simulated seconds under virtual time
+    int remaining_bananas;
+    int withdrawn_count;
+    int total_eaten;
+    int num_families;
+    int baskets[SIM_RESULT_BASKETS];    // Baskets of the first families
+} SimResult;
+
+/*
+ * Bytes of shared memory a run of this config maps
+ */
+size_t shared_data_size(const SimConfig* config);
+
+/*
+ * Create and map shared memory, initialize locks, clock and maze
+ * shm_name is a POSIX shm name the viewer can attach to, or NULL for an
+ * anonymous mapping only this process tree can see
+ * Returns 0 on success, -1 on failure
+ */
+int init_simulation(Simulation* sim, const SimConfig* config, int time_mode, const char* shm_name);
+
+/*
+ * Record the start time, fork one process per family and start the monitor
+ * (execution_mode=pool: set up every family here and start the workers)
+ * Returns 0 on success, -1 on failure
+ */
+int start_simulation(Simulation* sim);
+
+/*
+ * Wait for all family processes (or pooled actors), then stop and join
+ * the monitor
+ */
+void wait_simulation(Simulation* sim);
+
+/*
+ * Stop the run early: terminate and reap all family processes
+ * (pooled families stop at their next step)
+ */
+void stop_simulation(Simulation* sim);
+
+/*
+ * Seconds from the start to the termination rule that ended the run
+ * (elapsed time so far if none has fired)
+ */
+double simulation_duration_seconds(const struct SharedData* shared);
+
+/*
+ * Fill a SimResult from the final shared state
+ */
+void collect_simulation_result(const Simulation* sim, SimResult* result);
+
+/*
+ * Destroy the clock's semaphores, unmap shared memory and unlink its name
+ */
+void cleanup_simulation(Simulation* sim);
+
+/*
+ * Human-readable name of a TERM_* constant
+ */
+const char* termination_reason_name(int reason);
+
+#endif /* SIMULATION_H */
@@ -0,0 +1,114 @@
+/*
+ * trace.h
+ * Structured binary event trace (fixed-size records in a mapped file)
+ * Apes Collecting Bananas Simulation
+ *
+ * The file is a TraceHeader followed by TraceRecord slots. Writers in any
+ * family process reserve a slot with an atomic fetch-add on header.next,
+ * fill it and publish it by storing its type last. apes_trace decodes it.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_MAGIC "APESTRC1"
+#define TRACE_VERSION 3
+
+/* Record types (0 marks a slot that was reserved but never completed) */
+#define TRACE_NONE             0
+#define TRACE_FAMILY_START     1    // family
+#define TRACE_FEMALE_ENTER     2    // family, cell
+#define TRACE_COLLECT          3    // family, cell, amount taken, value = carrying
+#define TRACE_FEMALE_FIGHT     4    // family = winner, other = loser, cell, amount taken
+#define TRACE_FEMALE_STEAL     5    // family = thief, other = exhausted victim, cell, amount
+#define TRACE_FEMALE_EXIT      6    // family, cell, amount = carrying
+#define TRACE_DEPOSIT          7    // family, amount, value = basket
+#define TRACE_FEMALE_EXHAUSTED 8    // family, cell, value = carrying
+#define TRACE_FEMALE_REST      9    // family, value = energy
+#define TRACE_FEMALE_RECOVER   10   // family, value = energy after rest
+#define TRACE_MALE_CHALLENGE   11   // family, other, value = probability (percent)
+#define TRACE_MALE_FIGHT       12   // family = winner, other = loser, amount taken, value = basket
+#define TRACE_BABY_EAT         13   // family, baby, other = victim, amount, value = total eaten
+#define TRACE_BABY_GIVE        14   // family, baby, other = victim, amount, value = basket
+#define TRACE_WITHDRAW         15   // family, amount = basket, value = male energy
+#define TRACE_TERMINATE        16   // family = winner (-1 if none), value = TERM_* reason
+#define TRACE_TYPE_COUNT       17
+
+/*
+ * File header (64 bytes)
+ */
+typedef struct {
+    char magic[8];                      // TRACE_MAGIC
+    uint32_t version;                   // TRACE_VERSION
+    uint32_t record_size;               // sizeof(TraceRecord)
+    uint64_t capacity;                  // Record slots allocated when the file was created
+    uint64_t next;                      // Records reserved; beyond capacity they were dropped
+    uint32_t seed;
+    int32_t num_families;
+    int32_t babies_per_family;
+    int32_t maze_rows;
+    int32_t maze_cols;
+    int32_t time_mode;                  // TIME_MODE_* of the run
+    uint8_t reserved[8];
+} TraceHeader;
+
+/*
+ * One event (48 bytes); unused fields are -1
+ * Cells and babies are full ints: mazes and families are sized at runtime
+ */
+typedef struct {
+    uint64_t sim_time_us;               // Simulated time (wall time in real mode)
+    uint64_t real_time_ns;              // Monotonic time since the trace was opened
+    int32_t family;
+    int32_t other;                      // Opponent or victim family
+    int32_t amount;                     // Bananas moved
+    int32_t value;                      // Type-specific, see TRACE_* above
+    int32_t baby;
+    int32_t row;
+    int32_t col;
+    uint8_t type;                       // TRACE_* (stored last)
+    uint8_t reserved[3];
+} TraceRecord;
+
+_Static_assert(sizeof(TraceHeader) == 64, "TraceHeader must stay 64 bytes");
+_Static_assert(sizeof(TraceRecord) == 48, "TraceRecord must stay 48 bytes");
+
+/*
+ * Short name of a TRACE_* type ("?" if unknown)
+ */
+static inline const char* trace_type_name(int type) {
+    static const char* const names[TRACE_TYPE_COUNT] = {
+        "none", "family_start", "female_enter", "collect", "female_fight",
+        "female_steal", "female_exit", "deposit", "female_exhausted",
+        "female_rest", "female_recover", "male_challenge", "male_fight",
+        "baby_eat", "baby_give", "withdraw", "terminate"
+    };
+    
+    return (type >= 0 && type < TRACE_TYPE_COUNT) ? names[type] : "?";
+}
+
+struct SharedData;
+
+/*
+ * Create the trace file with room for max_records and map it
+ * Call in the coordinating process before the families are forked; the
+ * mapping is inherited, so every family process appends to the same file
+ * Returns 0 on success, -1 on failure
+ */
+int trace_open(const char* path, uint64_t max_records, const struct SharedData* shared,
+               int babies_per_family);
+
+/*
+ * Append one event (no-op when no trace is open)
+ */
+void trace_record(const struct SharedData* shared, int type, int family, int other, int baby,
+                  int row, int col, int amount, int value);
+
+/*
+ * Trim unused slots from the file and unmap it (coordinating process only)
+ */
+void trace_close(void);
+
+#endif /* TRACE_H */
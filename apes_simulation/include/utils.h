@@ -8,17 +8,39 @@
 #define UTILS_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 
 /* ==================== Random Functions ==================== */
+/* Each thread has its own xoshiro256** generator (no shared state) */
 
 /*
- * Initialize random seed
+ * Pick a fresh non-zero seed from the clock and process ID
+ * Print it so the run can be reproduced with seed=
  */
-void init_random(void);
+unsigned int make_random_seed(void);
 
 /*
- * Generate random integer in range [min, max] (inclusive)
+ * Seed the calling thread's generator for one actor's stream
+ * The stream is derived from (seed, family_id, role), so each thread
+ * draws the same sequence on every run with the same seed
+ * role is ROLE_FEMALE, ROLE_MALE or ROLE_BABY + baby_id
+ */
+void seed_thread_random(unsigned int seed, int family_id, int role);
+
+/*
+ * Seed the calling thread's setup stream (maze generation)
+ */
+void seed_random(unsigned int seed);
+
+/*
+ * Copy the calling thread's generator state out or back in (checkpoints)
+ */
+void random_get_state(uint64_t state[4]);
+void random_set_state(const uint64_t state[4]);
+
+/*
+ * Generate random integer in range [min, max] (inclusive, unbiased)
  */
 int random_int(int min, int max);
 
@@ -50,6 +72,7 @@ void sleep_ms(int milliseconds);
 void get_time_string(char* buffer, size_t size);
 
 /* ==================== Logging Functions ==================== */
+/* Lines are queued per thread and written by a background writer thread */
 
 /*
  * Log an event with timestamp
@@ -76,29 +99,35 @@ void log_male(int family_id, const char* format, ...);
  */
 void log_baby(int family_id, int baby_id, const char* format, ...);
 
-/* ==================== Shared Memory Helpers ==================== */
-
 /*
- * Create shared memory segment
- * Returns shared memory ID on success, -1 on failure
+ * Write out all queued log lines now (also runs at exit and before fork)
  */
-int create_shared_memory(size_t size, int key);
+void log_flush(void);
+
+/* ==================== Shared Memory Helpers ==================== */
+
+/* Page size used when huge pages are requested */
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
 
 /*
- * Attach to existing shared memory segment
- * Returns pointer to shared memory, NULL on failure
+ * Create and map a shared memory region of *size bytes
+ * name: POSIX shm name (e.g. "/apes_sim_1234"), or NULL for an anonymous
+ *       mapping shared only with forked children
+ * use_hugepages: opt-in MAP_HUGETLB (anonymous) / MADV_HUGEPAGE (named);
+ *       *size is rounded up when huge pages are used
+ * Returns pointer to the mapping, NULL on failure
  */
-void* attach_shared_memory(int shm_id);
+void* create_shared_memory(const char* name, size_t* size, int use_hugepages);
 
 /*
- * Detach from shared memory
+ * Unmap shared memory
  */
-void detach_shared_memory(void* ptr);
+void detach_shared_memory(void* ptr, size_t size);
 
 /*
- * Destroy shared memory segment
+ * Remove a named shared memory segment (existing mappings stay valid)
  */
-void destroy_shared_memory(int shm_id);
+void destroy_shared_memory(const char* name);
 
 /* ==================== Console Helpers ==================== */
 
@@ -153,7 +182,8 @@ void log_event_to_file(const char* format, ...);
 struct SharedData;
 
 /*
- * Add event to shared memory buffer for live display
+ * Append an event to the shared lock-free ring for live display
+ * Safe from any thread of any family process; read with read_shared_event
  */
 void add_shared_event(struct SharedData* shared, const char* format, ...);
 
@@ -0,0 +1,517 @@
+/*
+ * batch.c
+ * Headless batch runner: many independent simulations in parallel
+ *
+ * Usage: apes_batch <config_file> <first_seed> <last_seed>
+ *                   [-j jobs] [-o results_file] [--time-mode=real|virtual|deterministic]
+ *
+ * Each seed runs in its own worker process with an anonymous shared
+ * mapping, so runs never interfere with each other or with an interactive
+ * apes_simulation. Results are gathered into one aggregated file. The exit
+ * status is 1 if any run failed or the file could not be written.
+ *
+ * A config with swept values (key=a:b:step or key={x,y,...}) runs every
+ * seed at every point of the grid the sweeps span, and the results add
+ * the point's values to each row and a summary per point.
+ */
+
+#include "local.h"
+#include <sys/mman.h>
+
+#define DEFAULT_RESULTS_FILE "batch_results.txt"
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s <config_file> <first_seed> <last_seed> "
+                    "[-j jobs] [-o results_file] [--time-mode=real|virtual|deterministic]\n", prog);
+    fprintf(stderr, "  Seeds must be >= 1. Defaults: jobs = online CPUs, "
+                    "results = %s, time mode = virtual\n", DEFAULT_RESULTS_FILE);
+}
+
+/*
+ * Name of a per-run output file: <base>.<seed>, or <base>.p<point>.<seed>
+ * in a sweep (point >= 0)
+ * Returns 0 on success, -1 if the name is too long
+ */
+static int run_file_name(char* name, size_t size, const char* base, int point, unsigned int seed) {
+    int len;
+    
+    if (point >= 0) {
+        len = snprintf(name, size, "%s.p%d.%u", base, point, seed);
+    } else {
+        len = snprintf(name, size, "%s.%u", base, seed);
+    }
+    return (len < 0 || (size_t)len >= size) ? -1 : 0;
+}
+
+/*
+ * Run one simulation in the current (worker) process and store its result
+ * point is the sweep point of base_config (-1 without a sweep)
+ * Never returns
+ */
+static void run_worker(const SimConfig* base_config, int point, unsigned int seed, int time_mode,
+                       SimResult* slot) {
+    SimConfig config = *base_config;
+    Simulation sim;
+    int devnull;
+    
+    config.seed = seed;
+    
+    /* One trace and one recording per run */
+    if (config.trace_file[0] != '\0' &&
+        run_file_name(config.trace_file, sizeof(config.trace_file),
+                      base_config->trace_file, point, seed) != 0) {
+        fprintf(stderr, "Seed %u: trace file name too long\n", seed);
+        exit(1);
+    }
+    if (config.frame_file[0] != '\0' &&
+        run_file_name(config.frame_file, sizeof(config.frame_file),
+                      base_config->frame_file, point, seed) != 0) {
+        fprintf(stderr, "Seed %u: frame file name too long\n", seed);
+        exit(1);
+    }
+
+    /* Headless: discard the per-run log output */
+    devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+    
+    if (init_simulation(&sim, &config, time_mode, NULL) != 0 ||
+        start_simulation(&sim) != 0) {
+        fprintf(stderr, "Seed %u: failed to start simulation\n", seed);
+        stop_simulation(&sim);
+        cleanup_simulation(&sim);
+        exit(1);
+    }
+    
+    wait_simulation(&sim);
+    collect_simulation_result(&sim, slot);
+    cleanup_simulation(&sim);
+    
+    exit(0);
+}
+
+static void write_summary(FILE* out, const SimResult* results, int num_runs,
+                          int num_families, double wall_seconds) {
+    int reason_counts[TERM_TIMEOUT + 1] = {0};
+    int* best_counts;
+    int no_winner = 0;
+    int completed = 0;
+    double total_duration = 0.0;
+    double total_remaining = 0.0;
+    int i;
+    
+    best_counts = (int*)calloc((size_t)num_families, sizeof(int));
+    if (best_counts == NULL) {
+        fprintf(stderr, "Failed to allocate batch summary\n");
+        return;
+    }
+    
+    for (i = 0; i < num_runs; i++) {
+        const SimResult* r = &results[i];
+        
+        if (!r->completed) continue;
+        
+        completed++;
+        total_duration += r->duration_seconds;
+        total_remaining += r->remaining_bananas;
+        if (r->termination_reason >= 0 && r->termination_reason <= TERM_TIMEOUT) {
+            reason_counts[r->termination_reason]++;
+        }
+        if (r->best_family >= 0) {
+            best_counts[r->best_family]++;
+        } else {
+            no_winner++;
+        }
+    }
+    
+    fprintf(out, "# SUMMARY\n");
+    fprintf(out, "# runs=%d completed=%d wall_time=%.1fs\n", num_runs, completed, wall_seconds);
+    if (completed == 0) {
+        free(best_counts);
+        return;
+    }
+    
+    fprintf(out, "# mean_duration=%.2fs mean_remaining=%.2f\n",
+            total_duration / completed, total_remaining / completed);
+    for (i = TERM_WITHDRAWN_THRESHOLD; i <= TERM_TIMEOUT; i++) {
+        fprintf(out, "# termination %-10s %5d (%5.1f%%)\n", termination_reason_name(i),
+                reason_counts[i], 100.0 * reason_counts[i] / completed);
+    }
+    for (i = 0; i < num_families; i++) {
+        /* Large runs only list families that were ever best */
+        if (best_counts[i] == 0 && num_families > SIM_RESULT_BASKETS) continue;
+        fprintf(out, "# best_family %-2d %5d (%5.1f%%)\n", i,
+                best_counts[i], 100.0 * best_counts[i] / completed);
+    }
+    fprintf(out, "# no_winner      %5d (%5.1f%%)\n", no_winner, 100.0 * no_winner / completed);
+    free(best_counts);
+}
+
+/*
+ * Leading columns of a sweep row: the point and its value of every swept key
+ */
+static void write_point_columns(FILE* out, const ConfigSweep* sweep, int point) {
+    int a;
+    
+    fprintf(out, "%d", point);
+    for (a = 0; a < sweep->num_axes; a++) {
+        fprintf(out, "\t%s", sweep_point_value(sweep, point, a));
+    }
+    fprintf(out, "\t");
+}
+
+/*
+ * One summary row per sweep point: outcome shares, the family most often
+ * best and the mean basket of each family, averaged over that point's seeds
+ * ("-" for families the point does not have)
+ */
+static void write_point_summary(FILE* out, const SimResult* results, int seeds_per_point,
+                                const ConfigSweep* sweep, int num_families) {
+    int baskets = num_families < SIM_RESULT_BASKETS ? num_families : SIM_RESULT_BASKETS;
+    int* best_counts;
+    int point, i, j;
+    
+    best_counts = (int*)calloc((size_t)num_families, sizeof(int));
+    if (best_counts == NULL) {
+        fprintf(stderr, "Failed to allocate point summary\n");
+        return;
+    }
+    
+    fprintf(out, "# POINTS\n");
+    fprintf(out, "# point");
+    for (i = 0; i < sweep->num_axes; i++) {
+        fprintf(out, "\t%s", sweep->axes[i].key);
+    }
+    fprintf(out, "\truns\tcompleted\tmean_duration_s\tmean_remaining");
+    for (i = TERM_WITHDRAWN_THRESHOLD; i <= TERM_TIMEOUT; i++) {
+        fprintf(out, "\t%s", termination_reason_name(i));
+    }
+    fprintf(out, "\ttop_family\ttop_share");
+    for (j = 0; j < baskets; j++) {
+        fprintf(out, "\tmean_basket_%d", j);
+    }
+    fprintf(out, "\n");
+    
+    for (point = 0; point < sweep->num_points; point++) {
+        const SimResult* runs = &results[(size_t)point * seeds_per_point];
+        int reason_counts[TERM_TIMEOUT + 1] = {0};
+        double basket_totals[SIM_RESULT_BASKETS] = {0.0};
+        int basket_runs[SIM_RESULT_BASKETS] = {0};
+        double total_duration = 0.0;
+        double total_remaining = 0.0;
+        int completed = 0;
+        int top = -1;
+        
+        memset(best_counts, 0, (size_t)num_families * sizeof(int));
+        for (i = 0; i < seeds_per_point; i++) {
+            const SimResult* r = &runs[i];
+            
+            if (!r->completed) continue;
+            
+            completed++;
+            total_duration += r->duration_seconds;
+            total_remaining += r->remaining_bananas;
+            if (r->termination_reason >= 0 && r->termination_reason <= TERM_TIMEOUT) {
+                reason_counts[r->termination_reason]++;
+            }
+            if (r->best_family >= 0 && r->best_family < num_families) {
+                best_counts[r->best_family]++;
+            }
+            for (j = 0; j < r->num_families && j < SIM_RESULT_BASKETS; j++) {
+                basket_totals[j] += r->baskets[j];
+                basket_runs[j]++;
+            }
+        }
+        for (j = 0; j < num_families; j++) {
+            if (best_counts[j] > 0 && (top < 0 || best_counts[j] > best_counts[top])) top = j;
+        }
+        
+        fprintf(out, "# ");
+        write_point_columns(out, sweep, point);
+        fprintf(out, "%d\t%d", seeds_per_point, completed);
+        if (completed == 0) {
+            fprintf(out, "\n");
+            continue;
+        }
+        fprintf(out, "\t%.2f\t%.2f", total_duration / completed, total_remaining / completed);
+        for (i = TERM_WITHDRAWN_THRESHOLD; i <= TERM_TIMEOUT; i++) {
+            fprintf(out, "\t%d", reason_counts[i]);
+        }
+        fprintf(out, "\t%d\t%.3f", top, top >= 0 ? (double)best_counts[top] / completed : 0.0);
+        for (j = 0; j < baskets; j++) {
+            if (basket_runs[j] > 0) {
+                fprintf(out, "\t%.2f", basket_totals[j] / basket_runs[j]);
+            } else {
+                fprintf(out, "\t-");
+            }
+        }
+        fprintf(out, "\n");
+    }
+    free(best_counts);
+}
+
+/*
+ * Run i is seed first_seed + i % seeds_per_point at point i / seeds_per_point
+ */
+static void write_results(FILE* out, const SimResult* results, int num_runs, int seeds_per_point,
+                          const ConfigSweep* sweep, int num_families, const char* config_file,
+                          unsigned int first_seed, int time_mode, int jobs) {
+    int i, j;
+    
+    fprintf(out, "# APES SIMULATION - BATCH RESULTS\n");
+    fprintf(out, "# config=%s seeds=%u..%u time_mode=%s jobs=%d",
+            config_file, first_seed, first_seed + (unsigned int)(seeds_per_point - 1),
+            time_mode_name(time_mode), jobs);
+    if (sweep->num_axes > 0) {
+        fprintf(out, " points=%d", sweep->num_points);
+    }
+    fprintf(out, "\n# ");
+    if (sweep->num_axes > 0) {
+        fprintf(out, "point\t");
+        for (i = 0; i < sweep->num_axes; i++) {
+            fprintf(out, "%s\t", sweep->axes[i].key);
+        }
+    }
+    fprintf(out, "seed\ttermination\twinning_family\tbest_family\tduration_s\t"
+                 "remaining\twithdrawn\teaten");
+    for (j = 0; j < num_families && j < SIM_RESULT_BASKETS; j++) {
+        fprintf(out, "\tbasket_%d", j);
+    }
+    fprintf(out, "\n");
+    
+    for (i = 0; i < num_runs; i++) {
+        const SimResult* r = &results[i];
+        
+        if (sweep->num_axes > 0) {
+            write_point_columns(out, sweep, i / seeds_per_point);
+        }
+        if (!r->completed) {
+            fprintf(out, "%u\tfailed\n", first_seed + (unsigned int)(i % seeds_per_point));
+            continue;
+        }
+        
+        fprintf(out, "%u\t%s\t%d\t%d\t%.1f\t%d\t%d\t%d",
+                r->seed, termination_reason_name(r->termination_reason),
+                r->winning_family, r->best_family, r->duration_seconds,
+                r->remaining_bananas, r->withdrawn_count, r->total_eaten);
+        for (j = 0; j < r->num_families && j < SIM_RESULT_BASKETS; j++) {
+            fprintf(out, "\t%d", r->baskets[j]);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+static void free_point_configs(SimConfig** configs, int num_points) {
+    int p;
+    
+    for (p = 0; p < num_points; p++) {
+        free_config(configs[p]);
+    }
+    free(configs);
+}
+
+int main(int argc, char* argv[]) {
+    ConfigSweep* sweep;
+    SimConfig** configs;
+    const char* config_file;
+    const char* results_file = DEFAULT_RESULTS_FILE;
+    int time_mode = TIME_MODE_VIRTUAL;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long first_seed, last_seed;
+    SimResult* results;
+    size_t results_size;
+    int num_runs, next_run = 0, active = 0;
+    int seeds_per_point, num_families = 0;
+    int uses_pool = 0;
+    int failed = 0;
+    int status = 0;
+    struct timespec t_start, t_end;
+    FILE* out;
+    int i;
+    
+    if (argc < 4) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    config_file = argv[1];
+    first_seed = strtoul(argv[2], NULL, 10);
+    last_seed = strtoul(argv[3], NULL, 10);
+    if (first_seed < 1 || last_seed < first_seed || last_seed > 0xFFFFFFFFul) {
+        fprintf(stderr, "Invalid seed range %s..%s\n", argv[2], argv[3]);
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    for (i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            results_file = argv[++i];
+        } else if (strncmp(argv[i], "--time-mode=", 12) == 0) {
+            time_mode = parse_time_mode(argv[i] + 12);
+            if (time_mode < 0) {
+                fprintf(stderr, "Unknown time mode '%s' (expected real, virtual or deterministic)\n",
+                        argv[i] + 12);
+                return 1;
+            }
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (jobs < 1) jobs = 1;
+    
+    sweep = load_config_sweep(config_file);
+    if (sweep == NULL) {
+        fprintf(stderr, "Failed to load configuration from: %s\n", config_file);
+        return 1;
+    }
+    
+    /* Every point gets its own validated config, built before any fork */
+    configs = (SimConfig**)calloc((size_t)sweep->num_points, sizeof(SimConfig*));
+    if (configs == NULL) {
+        fprintf(stderr, "Failed to allocate sweep configurations\n");
+        free_config_sweep(sweep);
+        return 1;
+    }
+    for (i = 0; i < sweep->num_points; i++) {
+        configs[i] = sweep_point_config(sweep, i);
+        if (configs[i] == NULL) {
+            if (sweep->num_axes > 0) {
+                fprintf(stderr, "Sweep point %d of %s is not a valid configuration\n", i, config_file);
+            } else {
+                fprintf(stderr, "Failed to load configuration from: %s\n", config_file);
+            }
+            free_point_configs(configs, sweep->num_points);
+            free_config_sweep(sweep);
+            return 1;
+        }
+        if (configs[i]->execution_mode == EXEC_MODE_POOL) uses_pool = 1;
+        if (configs[i]->num_families > num_families) num_families = configs[i]->num_families;
+    }
+    if (uses_pool && time_mode == TIME_MODE_REAL) {
+        fprintf(stderr, "Note: execution_mode=pool runs under virtual time\n");
+        time_mode = TIME_MODE_VIRTUAL;
+    }
+    
+    seeds_per_point = (int)(last_seed - first_seed + 1);
+    if (last_seed - first_seed >= (unsigned long)INT_MAX / (unsigned long)sweep->num_points) {
+        fprintf(stderr, "Too many runs: %d points x %lu seeds\n",
+                sweep->num_points, last_seed - first_seed + 1);
+        free_point_configs(configs, sweep->num_points);
+        free_config_sweep(sweep);
+        return 1;
+    }
+    num_runs = seeds_per_point * sweep->num_points;
+    
+    /* The jobs already fill the CPUs: a pooled run left at pool_workers=0
+     * gets its share of them, not a pool of its own per CPU */
+    if (uses_pool) {
+        int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        int parallel = jobs < num_runs ? jobs : num_runs;
+        int share = cpus / parallel > 1 ? cpus / parallel : 1;
+        
+        for (i = 0; i < sweep->num_points; i++) {
+            if (configs[i]->execution_mode == EXEC_MODE_POOL && configs[i]->pool_workers == 0) {
+                configs[i]->pool_workers = share;
+            }
+        }
+    }
+    
+    /* Result slots live in an anonymous shared mapping so every worker
+     * can write its own entry without any extra IPC */
+    results_size = (size_t)num_runs * sizeof(SimResult);
+    results = (SimResult*)mmap(NULL, results_size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) {
+        perror("mmap failed");
+        free_point_configs(configs, sweep->num_points);
+        free_config_sweep(sweep);
+        return 1;
+    }
+    memset(results, 0, results_size);
+    
+    if (sweep->num_axes > 0) {
+        printf("Running %d simulations (%d points x seeds %lu..%lu) with %d parallel jobs...\n",
+               num_runs, sweep->num_points, first_seed, last_seed, jobs);
+    } else {
+        printf("Running %d simulations (seeds %lu..%lu) with %d parallel jobs...\n",
+               num_runs, first_seed, last_seed, jobs);
+    }
+    fflush(stdout);
+    
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    
+    while (next_run < num_runs || active > 0) {
+        /* Keep every job slot busy */
+        while (active < jobs && next_run < num_runs) {
+            int point = next_run / seeds_per_point;
+            pid_t pid = fork();
+            
+            if (pid < 0) {
+                perror("fork failed");
+                break;
+            }
+            if (pid == 0) {
+                run_worker(configs[point], sweep->num_axes > 0 ? point : -1,
+                           (unsigned int)(first_seed + next_run % seeds_per_point),
+                           time_mode, &results[next_run]);
+            }
+            
+            next_run++;
+            active++;
+        }
+        
+        if (active == 0) break;  /* fork keeps failing */
+        
+        if (waitpid(-1, NULL, 0) > 0) {
+            active--;
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    double wall_seconds = (t_end.tv_sec - t_start.tv_sec) +
+                          (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+    
+    out = fopen(results_file, "w");
+    if (out == NULL) {
+        perror("Failed to open results file");
+        status = 1;
+    } else {
+        write_results(out, results, num_runs, seeds_per_point, sweep, num_families, config_file,
+                      (unsigned int)first_seed, time_mode, jobs);
+        fprintf(out, "#\n");
+        write_summary(out, results, num_runs, num_families, wall_seconds);
+        if (sweep->num_axes > 0) {
+            fprintf(out, "#\n");
+            write_point_summary(out, results, seeds_per_point, sweep, num_families);
+        }
+        fclose(out);
+        printf("Results saved to: %s\n", results_file);
+    }
+    
+    write_summary(stdout, results, num_runs, num_families, wall_seconds);
+    if (sweep->num_axes > 0) {
+        write_point_summary(stdout, results, seeds_per_point, sweep, num_families);
+    }
+    
+    /* Scripts tell a failed batch from a good one by the exit status */
+    for (i = 0; i < num_runs; i++) {
+        if (!results[i].completed) failed++;
+    }
+    if (failed > 0) {
+        fprintf(stderr, "%d of %d runs failed\n", failed, num_runs);
+        status = 1;
+    }
+    
+    munmap(results, results_size);
+    free_point_configs(configs, sweep->num_points);
+    free_config_sweep(sweep);
+    
+    return status;
+}
@@ -0,0 +1,200 @@
+/*
+ * checkpoint.c
+ * Checkpoint writer (at a quiescent virtual tick) and restore
+ */
+
+#include "local.h"
+
+/* Scheduler slots covered by a checkpoint (as sim_actor_slots()) */
+static long long checkpoint_slots(int num_families, int babies_per_family) {
+    return 1 + (long long)num_families * (2 + (long long)babies_per_family);
+}
+
+static int write_checkpoint(const SharedData* shared, const char* path) {
+    const SimClock* clock = &shared->clock;
+    const ClockEntry* heap = clock_heap(shared);
+    CheckpointHeader header;
+    ActorState* actors;
+    char tmp_path[CHECKPOINT_PATH_MAX + 8];
+    size_t cells = (size_t)shared->maze_rows * (size_t)shared->maze_cols;
+    size_t families = (size_t)shared->num_families;
+    size_t babies = families * (size_t)shared->babies_per_family;
+    int slots = sim_actor_slots(shared);
+    FILE* file;
+    int i, ok;
+    
+    actors = (ActorState*)malloc(sizeof(ActorState) * (size_t)slots);
+    if (actors == NULL) {
+        fprintf(stderr, "Failed to allocate checkpoint actors\n");
+        return -1;
+    }
+    
+    /* Actors still registered are exactly the ones in the wakeup heap and
+     * the ones parked on an event */
+    memcpy(actors, actor_state(shared, 0), sizeof(ActorState) * (size_t)slots);
+    for (i = 0; i < slots; i++) {
+        actors[i].live = actors[i].event_wait;
+        actors[i].wake_ms = actors[i].event_wait ? clock->now_ms : 0;
+    }
+    for (i = 0; i < clock->heap_size; i++) {
+        actors[heap[i].actor].live = 1;
+        actors[heap[i].actor].wake_ms = heap[i].wake_ms;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.seed = shared->seed;
+    header.time_mode = clock->serial ? TIME_MODE_DETERMINISTIC : clock->mode;
+    header.num_families = shared->num_families;
+    header.babies_per_family = shared->babies_per_family;
+    header.maze_rows = shared->maze_rows;
+    header.maze_cols = shared->maze_cols;
+    header.num_slots = slots;
+    header.num_actors = clock->num_actors;
+    header.total_bananas_in_maze = shared->total_bananas_in_maze;
+    header.withdrawn_count = shared->withdrawn_count;
+    header.now_ms = clock->now_ms;
+    
+    /* Write beside the target and rename, so a reader never sees half a file */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    file = fopen(tmp_path, "wb");
+    if (file == NULL) {
+        perror("Failed to create checkpoint file");
+        free(actors);
+        return -1;
+    }
+    
+    ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fwrite(family_status(shared, 0), sizeof(FamilyStatus), families, file) == families &&
+         fwrite(baby_bananas_eaten(shared, 0), sizeof(int32_t), babies, file) == babies &&
+         fwrite(family_state(shared, 0), sizeof(FamilyState), families, file) == families &&
+         fwrite(baby_eaten_state(shared, 0), sizeof(int32_t), babies, file) == babies &&
+         fwrite(actors, sizeof(ActorState), (size_t)slots, file) == (size_t)slots &&
+         fwrite(maze_cell(shared, 0, 0), sizeof(MazeCell), cells, file) == cells &&
+         fwrite(female_cell(shared, 0), sizeof(int32_t), families, file) == families;
+    if (fclose(file) != 0) ok = 0;
+    free(actors);
+    
+    if (!ok || rename(tmp_path, path) != 0) {
+        perror("Failed to write checkpoint file");
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+void checkpoint_poll(SharedData* shared) {
+    long long now = shared->clock.now_ms;
+    int due = __atomic_exchange_n(&shared->checkpoint_pending, 0, __ATOMIC_ACQ_REL);
+    
+    if (shared->checkpoint_at_ms >= 0 && now >= shared->checkpoint_at_ms) {
+        shared->checkpoint_at_ms = -1;
+        due = 1;
+    }
+    if (!due) return;
+    
+    /* Once termination is flagged the actors are already on their way out */
+    if (!shared->simulation_running) return;
+    
+    if (write_checkpoint(shared, shared->checkpoint_path) == 0) {
+        add_shared_event(shared, "Checkpoint written to %s at t=%.1fs",
+                         shared->checkpoint_path, now / 1000.0);
+        log_event("Checkpoint written to %s at t=%.3fs", shared->checkpoint_path, now / 1000.0);
+    }
+}
+
+/*
+ * Open a checkpoint and read its header
+ * Returns the open file positioned after the header, or NULL on failure
+ */
+static FILE* open_checkpoint(const char* path, CheckpointHeader* header) {
+    FILE* file = fopen(path, "rb");
+    
+    if (file == NULL) {
+        perror("Failed to open checkpoint file");
+        return NULL;
+    }
+    
+    if (fread(header, sizeof(*header), 1, file) != 1 ||
+        memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != CHECKPOINT_VERSION) {
+        fprintf(stderr, "%s: not a version %d checkpoint file\n", path, CHECKPOINT_VERSION);
+        fclose(file);
+        return NULL;
+    }
+    
+    if (header->num_families < 1 || header->babies_per_family < 0 ||
+        header->num_slots != checkpoint_slots(header->num_families, header->babies_per_family) ||
+        header->num_actors < 0 || header->num_actors > header->num_slots) {
+        fprintf(stderr, "%s: corrupt checkpoint header\n", path);
+        fclose(file);
+        return NULL;
+    }
+    
+    return file;
+}
+
+int checkpoint_read_header(const char* path, CheckpointHeader* header) {
+    FILE* file = open_checkpoint(path, header);
+    
+    if (file == NULL) return -1;
+    fclose(file);
+    return 0;
+}
+
+int checkpoint_restore(SharedData* shared, const char* path) {
+    CheckpointHeader header;
+    size_t cells = (size_t)shared->maze_rows * (size_t)shared->maze_cols;
+    size_t families, babies;
+    FILE* file;
+    int ok;
+    
+    file = open_checkpoint(path, &header);
+    if (file == NULL) return -1;
+    
+    /* The shared memory layout follows the config, so its shape must match */
+    if (header.num_families != shared->num_families ||
+        header.babies_per_family != shared->babies_per_family ||
+        header.maze_rows != shared->maze_rows || header.maze_cols != shared->maze_cols) {
+        fprintf(stderr, "%s: checkpoint has %d families, %d babies, %dx%d maze; "
+                "the config has %d, %d, %dx%d\n", path,
+                header.num_families, header.babies_per_family, header.maze_rows, header.maze_cols,
+                shared->num_families, shared->babies_per_family, shared->maze_rows, shared->maze_cols);
+        fclose(file);
+        return -1;
+    }
+    
+    families = (size_t)header.num_families;
+    babies = families * (size_t)header.babies_per_family;
+    ok = fread(family_status(shared, 0), sizeof(FamilyStatus), families, file) == families &&
+         fread(baby_bananas_eaten(shared, 0), sizeof(int32_t), babies, file) == babies &&
+         fread(family_state(shared, 0), sizeof(FamilyState), families, file) == families &&
+         fread(baby_eaten_state(shared, 0), sizeof(int32_t), babies, file) == babies &&
+         fread(actor_state(shared, 0), sizeof(ActorState), (size_t)header.num_slots, file) ==
+             (size_t)header.num_slots &&
+         fread(maze_cell(shared, 0, 0), sizeof(MazeCell), cells, file) == cells &&
+         fread(female_cell(shared, 0), sizeof(int32_t), families, file) == families;
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "%s: checkpoint file is truncated\n", path);
+        return -1;
+    }
+    
+    build_banana_field(shared);
+    build_female_index(shared);
+    shared->total_bananas_in_maze = header.total_bananas_in_maze;
+    shared->withdrawn_count = header.withdrawn_count;
+    shared->clock.now_ms = header.now_ms;
+    shared->clock.num_actors = header.num_actors;
+    shared->restored = 1;
+    
+    /* A different seed branches the run: actors draw fresh streams */
+    shared->restore_rng = (header.seed == shared->seed);
+    
+    add_shared_event(shared, "Restored checkpoint %s (t=%.1fs%s)", path, header.now_ms / 1000.0,
+                     shared->restore_rng ? "" : ", new seed");
+    log_event("Restored checkpoint %s at t=%.3fs (seed %u, now %u)", path,
+              header.now_ms / 1000.0, header.seed, shared->seed);
+    return 0;
+}
@@ -2,6 +2,33 @@
 
 #define MAX_LINE_LENGTH 256
 
+/*
+ * Check that a run of this shape can be set up: clock actor ids are ints
+ * and the shared segment has to fit in physical memory
+ * Returns 0 if it can, -1 (with an error) if not
+ */
+static int check_shared_segment(const SimConfig* config) {
+    long long actors = 1 + (long long)config->num_families * (2 + (long long)config->babies_per_family);
+    size_t memory = (size_t)sysconf(_SC_PHYS_PAGES) * (size_t)sysconf(_SC_PAGESIZE);
+    size_t size;
+    
+    if (actors > INT_MAX) {
+        fprintf(stderr, "Error: %d families of %d babies are %lld actors, at most %d are supported\n",
+                config->num_families, config->babies_per_family, actors, INT_MAX);
+        return -1;
+    }
+    
+    size = shared_data_size(config);
+    if (size > memory) {
+        fprintf(stderr, "Error: %d families of %d babies in a %dx%d maze need a %zu MB "
+                "shared segment, only %zu MB of memory is available\n",
+                config->num_families, config->babies_per_family, config->maze_rows,
+                config->maze_cols, size >> 20, memory >> 20);
+        return -1;
+    }
+    return 0;
+}
+
 static char* trim_whitespace(char* str) {
     char* end;
     
@@ -54,6 +81,24 @@ void set_default_config(SimConfig* config) {
     config->winning_basket_threshold = 50;
     config->baby_eaten_threshold = 15;
     config->max_simulation_time_seconds = 120;
+    
+    /* Random seed */
+    config->seed = 0;
+    
+    /* Runtime settings */
+    config->shm_hugepages = 0;
+    config->maze_lock_stripes = 256;
+    config->event_ring_capacity = 1024;
+    config->trace_file[0] = '\0';
+    config->trace_max_records = 1000000;
+    config->record_max_records = 16777216;
+    config->execution_mode = EXEC_MODE_PROCESS;
+    config->pool_workers = 0;
+    config->display_refresh_ms = 250;
+    config->frame_file[0] = '\0';
+    config->frame_format = FRAME_FORMAT_Y4M;
+    config->frame_interval_ms = 100;
+    config->frame_cell_pixels = 4;
 }
 
 static void parse_config_line(SimConfig* config, const char* key, const char* value) {
@@ -113,39 +158,177 @@ static void parse_config_line(SimConfig* config, const char* key, const char* va
     } else if (strcmp(key, "max_simulation_time_seconds") == 0) {
         config->max_simulation_time_seconds = atoi(value);
     }
+
+    else if (strcmp(key, "seed") == 0) {
+        config->seed = (unsigned int)strtoul(value, NULL, 10);
+    }
+    else if (strcmp(key, "shm_hugepages") == 0) {
+        config->shm_hugepages = atoi(value);
+    }
+    else if (strcmp(key, "maze_lock_stripes") == 0) {
+        config->maze_lock_stripes = atoi(value);
+    }
+    else if (strcmp(key, "event_ring_capacity") == 0) {
+        config->event_ring_capacity = atoi(value);
+    }
+    else if (strcmp(key, "trace_file") == 0) {
+        /* Paths end at the first blank, so a trailing comment is dropped */
+        safe_strcpy(config->trace_file, value, sizeof(config->trace_file));
+        config->trace_file[strcspn(config->trace_file, " \t#")] = '\0';
+    }
+    else if (strcmp(key, "trace_max_records") == 0) {
+        config->trace_max_records = atol(value);
+    }
+    else if (strcmp(key, "record_max_records") == 0) {
+        config->record_max_records = atol(value);
+    }
+    else if (strcmp(key, "execution_mode") == 0) {
+        /* The name ends at the first blank, like a path */
+        size_t len = strcspn(value, " \t#");
+        
+        if (len == 4 && strncmp(value, "pool", len) == 0) {
+            config->execution_mode = EXEC_MODE_POOL;
+        } else if (len == 7 && strncmp(value, "process", len) == 0) {
+            config->execution_mode = EXEC_MODE_PROCESS;
+        } else {
+            fprintf(stderr, "Warning: execution_mode must be process or pool, using process\n");
+            config->execution_mode = EXEC_MODE_PROCESS;
+        }
+    }
+    else if (strcmp(key, "pool_workers") == 0) {
+        config->pool_workers = atoi(value);
+    }
+    else if (strcmp(key, "display_refresh_ms") == 0) {
+        config->display_refresh_ms = atoi(value);
+    }
+    else if (strcmp(key, "frame_file") == 0) {
+        safe_strcpy(config->frame_file, value, sizeof(config->frame_file));
+        config->frame_file[strcspn(config->frame_file, " \t#")] = '\0';
+    }
+    else if (strcmp(key, "frame_format") == 0) {
+        size_t len = strcspn(value, " \t#");
+        
+        if (len == 3 && strncmp(value, "ppm", len) == 0) {
+            config->frame_format = FRAME_FORMAT_PPM;
+        } else if (len == 3 && strncmp(value, "y4m", len) == 0) {
+            config->frame_format = FRAME_FORMAT_Y4M;
+        } else if (len == 3 && strncmp(value, "raw", len) == 0) {
+            config->frame_format = FRAME_FORMAT_RAW;
+        } else {
+            fprintf(stderr, "Warning: frame_format must be ppm, y4m or raw, using y4m\n");
+            config->frame_format = FRAME_FORMAT_Y4M;
+        }
+    }
+    else if (strcmp(key, "frame_interval_ms") == 0) {
+        config->frame_interval_ms = atoi(value);
+    }
+    else if (strcmp(key, "frame_cell_pixels") == 0) {
+        config->frame_cell_pixels = atoi(value);
+    }
     else {
         fprintf(stderr, "Warning: Unknown config key '%s'\n", key);
     }
 }
 
 
-SimConfig* load_config(const char* filename) {
-    FILE* file;
-    char line[MAX_LINE_LENGTH];
-    SimConfig* config;
+/*
+ * Expand a sweep value: "a:b:step" is the range a, a + step, ... up to b
+ * inclusive, "{x,y,...}" a list; a trailing comment is ignored
+ * Returns the number of values stored in axis, 0 for a plain value, -1 if
+ * the sweep is malformed
+ */
+static int parse_sweep(const char* key, const char* value, SweepAxis* axis) {
+    char text[MAX_LINE_LENGTH];
+    char* body;
     
-
-    config = (SimConfig*)malloc(sizeof(SimConfig));
-    if (config == NULL) {
-        fprintf(stderr, "Error: Failed to allocate memory for config\n");
-        return NULL;
-    }
+    safe_strcpy(text, value, sizeof(text));
+    text[strcspn(text, "#")] = '\0';
+    body = trim_whitespace(text);
+    safe_strcpy(axis->key, key, sizeof(axis->key));
+    axis->num_values = 0;
     
-
-    set_default_config(config);
+    if (body[0] == '{') {
+        size_t len = strlen(body);
+        char* item;
+        char* save = NULL;
     
-    file = fopen(filename, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Warning: Could not open config file '%s', using defaults\n", filename);
-        return config;
+        if (body[len - 1] != '}') {
+            fprintf(stderr, "Error: %s: sweep list '%s' has no closing brace\n", key, body);
+            return -1;
+        }
+        body[len - 1] = '\0';
+        for (item = strtok_r(body + 1, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)) {
+            item = trim_whitespace(item);
+            if (item[0] == '\0') continue;
+            if (axis->num_values == SWEEP_MAX_VALUES || strlen(item) >= SWEEP_VALUE_LEN) {
+                fprintf(stderr, "Error: %s: sweep list is limited to %d values of %d characters\n",
+                        key, SWEEP_MAX_VALUES, SWEEP_VALUE_LEN - 1);
+                return -1;
+            }
+            safe_strcpy(axis->values[axis->num_values++], item, SWEEP_VALUE_LEN);
+        }
+        if (axis->num_values == 0) {
+            fprintf(stderr, "Error: %s: empty sweep list\n", key);
+            return -1;
+        }
+        return axis->num_values;
     }
     
+    /* A range is exactly three numbers; anything else (a path with a
+     * colon, say) is a plain value */
+    {
+        double from, to, step, count;
+        char* end;
+        int i, n;
+    
+        from = strtod(body, &end);
+        if (end == body || *end != ':') return 0;
+        body = end + 1;
+        to = strtod(body, &end);
+        if (end == body || *end != ':') return 0;
+        body = end + 1;
+        step = strtod(body, &end);
+        if (end == body || *end != '\0') return 0;
+    
+        count = (to - from) / step;
+        if (step == 0.0 || count < -1e-9) {
+            fprintf(stderr, "Error: %s: sweep step %g never reaches %g from %g\n", key, step, to, from);
+            return -1;
+        }
+        if (count + 1.0 > SWEEP_MAX_VALUES) {
+            fprintf(stderr, "Error: %s: sweep is limited to %d values\n", key, SWEEP_MAX_VALUES);
+            return -1;
+        }
+    
+        /* Multiply rather than accumulate, and allow for rounding at the end */
+        n = (int)(count + 1e-9) + 1;
+        for (i = 0; i < n; i++) {
+            double v = from + i * step;
+    
+            if (v > -1e-12 && v < 1e-12) v = 0.0;
+            snprintf(axis->values[i], SWEEP_VALUE_LEN, "%.10g", v);
+        }
+        axis->num_values = n;
+        return n;
+    }
+}
 
+/*
+ * Parse key=value lines from an open stream (without validating them)
+ * Swept keys become axes of sweep; in a single run (sweep = NULL) they
+ * are reported and take their first value
+ * Returns 0 on success, -1 if a sweep is malformed or there are too many
+ */
+static int read_config_lines(SimConfig* config, FILE* file, ConfigSweep* sweep) {
+    char line[MAX_LINE_LENGTH];
+    SweepAxis axis;
+    
     while (fgets(line, sizeof(line), file) != NULL) {
         char* trimmed = trim_whitespace(line);
         char* key;
         char* value;
         char* equals;
+        int values;
         
 
         if (trimmed[0] == '\0' || trimmed[0] == '#') {
@@ -164,32 +347,258 @@ SimConfig* load_config(const char* filename) {
         value = trim_whitespace(equals + 1);
         
         
-        parse_config_line(config, key, value);
+        values = parse_sweep(key, value, &axis);
+        
+        /* A malformed sweep is an error even where sweeps are not run */
+        if (values < 0) return -1;
+        if (values == 0) {
+            parse_config_line(config, key, value);
+            continue;
+        }
+        if (sweep == NULL) {
+            fprintf(stderr, "Warning: %s sweeps %d values (apes_batch only), using %s\n",
+                    key, values, axis.values[0]);
+        } else if (sweep->num_axes == SWEEP_MAX_AXES) {
+            fprintf(stderr, "Error: at most %d keys can be swept\n", SWEEP_MAX_AXES);
+            return -1;
+        } else {
+            sweep->axes[sweep->num_axes++] = axis;
+        }
+        parse_config_line(config, key, axis.values[0]);
+    }
+    
+    return 0;
+}
+
+/*
+ * Check and clamp a parsed configuration
+ * Returns 0 on success, -1 if no run can use it
+ */
+static int validate_config(SimConfig* config) {
+    /* The maze is sized at runtime; it only needs an exit row and an entry row */
+    if (config->maze_rows < 2) {
+        fprintf(stderr, "Warning: maze_rows must be at least 2, using 2\n");
+        config->maze_rows = 2;
+    }
+    if (config->maze_cols < 1) {
+        fprintf(stderr, "Warning: maze_cols must be at least 1, using 1\n");
+        config->maze_cols = 1;
+    }
+    if ((long long)config->maze_rows * config->maze_cols > INT_MAX) {
+        /* Cells are indexed with ints (x * maze_cols + y, female_cell) */
+        fprintf(stderr, "Error: a %dx%d maze has more than %d cells\n",
+                config->maze_rows, config->maze_cols, INT_MAX);
+        return -1;
+    }
+    if (config->num_families < 1) {
+        fprintf(stderr, "Warning: num_families must be at least 1, using 1\n");
+        config->num_families = 1;
+    }
+    if (config->babies_per_family < 0) {
+        fprintf(stderr, "Warning: babies_per_family must not be negative, using 0\n");
+        config->babies_per_family = 0;
+    }
+    if (config->maze_lock_stripes < 1 || config->maze_lock_stripes > MAX_MAZE_LOCK_STRIPES) {
+        fprintf(stderr, "Warning: maze_lock_stripes must be 1..%d, using 256\n", MAX_MAZE_LOCK_STRIPES);
+        config->maze_lock_stripes = 256;
+    }
+    if ((config->maze_lock_stripes & (config->maze_lock_stripes - 1)) != 0) {
+        int stripes = 1;
+        
+        /* Stripes are selected with a mask, so round up to a power of two */
+        while (stripes < config->maze_lock_stripes) stripes <<= 1;
+        fprintf(stderr, "Warning: maze_lock_stripes %d is not a power of two, using %d\n",
+                config->maze_lock_stripes, stripes);
+        config->maze_lock_stripes = stripes;
+    }
+    if (config->event_ring_capacity < MAX_EVENTS ||
+        config->event_ring_capacity > MAX_EVENT_RING_CAPACITY) {
+        fprintf(stderr, "Warning: event_ring_capacity must be %d..%d, using 1024\n",
+                MAX_EVENTS, MAX_EVENT_RING_CAPACITY);
+        config->event_ring_capacity = 1024;
+    }
+    if ((config->event_ring_capacity & (config->event_ring_capacity - 1)) != 0) {
+        int capacity = 1;
+        
+        /* Slots are selected with a mask, so round up to a power of two */
+        while (capacity < config->event_ring_capacity) capacity <<= 1;
+        fprintf(stderr, "Warning: event_ring_capacity %d is not a power of two, using %d\n",
+                config->event_ring_capacity, capacity);
+        config->event_ring_capacity = capacity;
+    }
+    if (config->trace_max_records < 1) {
+        fprintf(stderr, "Warning: trace_max_records must be positive, using 1000000\n");
+        config->trace_max_records = 1000000;
+    }
+    if (config->record_max_records < 1) {
+        fprintf(stderr, "Warning: record_max_records must be positive, using 16777216\n");
+        config->record_max_records = 16777216;
+    }
+    if (config->pool_workers < 0) {
+        fprintf(stderr, "Warning: pool_workers must be 0 (online CPUs) or more, using 0\n");
+        config->pool_workers = 0;
+    }
+    if (config->display_refresh_ms < 20 || config->display_refresh_ms > 10000) {
+        fprintf(stderr, "Warning: display_refresh_ms must be 20..10000, using 250\n");
+        config->display_refresh_ms = 250;
+    }
+    if (config->frame_interval_ms < 1 || config->frame_interval_ms > 60000) {
+        fprintf(stderr, "Warning: frame_interval_ms must be 1..60000, using 100\n");
+        config->frame_interval_ms = 100;
+    }
+    if (config->frame_cell_pixels < 1 || config->frame_cell_pixels > 64) {
+        fprintf(stderr, "Warning: frame_cell_pixels must be 1..64, using 4\n");
+        config->frame_cell_pixels = 4;
     }
     
+    /* Last: the segment size depends on the maze, lock and ring settings too */
+    return check_shared_segment(config);
+}
+
+/*
+ * Parse key=value lines from an open stream, then validate the result
+ * Returns 0 on success, -1 if the configuration is unusable
+ */
+static int read_config_stream(SimConfig* config, FILE* file) {
+    if (read_config_lines(config, file, NULL) != 0) return -1;
+    return validate_config(config);
+}
+
+SimConfig* load_config(const char* filename) {
+    FILE* file;
+    SimConfig* config;
+    
+
+    config = (SimConfig*)malloc(sizeof(SimConfig));
+    if (config == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory for config\n");
+        return NULL;
+    }
+    
+
+    set_default_config(config);
+    
+    file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Warning: Could not open config file '%s', using defaults\n", filename);
+        return config;
+    }
+    
+    if (read_config_stream(config, file) != 0) {
+        fclose(file);
+        free(config);
+        return NULL;
+    }
+    fclose(file);
+    
+    return config;
+}
+
+SimConfig* load_config_text(const char* text) {
+    SimConfig* config;
+    FILE* file;
+    
+    config = (SimConfig*)malloc(sizeof(SimConfig));
+    if (config == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory for config\n");
+        return NULL;
+    }
+    
+    set_default_config(config);
+    if (text[0] == '\0') return config;
+    
+    file = fmemopen((void*)text, strlen(text), "r");
+    if (file == NULL) {
+        perror("Failed to read embedded config");
+        free(config);
+        return NULL;
+    }
+    
+    if (read_config_stream(config, file) != 0) {
+        fclose(file);
+        free(config);
+        return NULL;
+    }
+    fclose(file);
+    
+    return config;
+}
+
+ConfigSweep* load_config_sweep(const char* filename) {
+    ConfigSweep* sweep;
+    FILE* file;
+    int i;
+    
+    sweep = (ConfigSweep*)calloc(1, sizeof(ConfigSweep));
+    if (sweep == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory for config sweep\n");
+        return NULL;
+    }
+    
+    set_default_config(&sweep->base);
+    sweep->num_points = 1;
+    
+    file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Warning: Could not open config file '%s', using defaults\n", filename);
+        return sweep;
+    }
+    
+    if (read_config_lines(&sweep->base, file, sweep) != 0) {
+        fclose(file);
+        free(sweep);
+        return NULL;
+    }
     fclose(file);
     
+    for (i = 0; i < sweep->num_axes; i++) {
+        if (sweep->num_points > SWEEP_MAX_POINTS / sweep->axes[i].num_values) {
+            fprintf(stderr, "Error: sweep has more than %d points\n", SWEEP_MAX_POINTS);
+            free(sweep);
+            return NULL;
+        }
+        sweep->num_points *= sweep->axes[i].num_values;
+    }
     
-    if (config->maze_rows > MAX_ROWS) {
-        fprintf(stderr, "Warning: maze_rows exceeds MAX_ROWS (%d), capping\n", MAX_ROWS);
-        config->maze_rows = MAX_ROWS;
+    return sweep;
+}
+
+const char* sweep_point_value(const ConfigSweep* sweep, int point, int axis) {
+    int i;
+    
+    /* Mixed radix: the last axis is the lowest digit */
+    for (i = sweep->num_axes - 1; i > axis; i--) {
+        point /= sweep->axes[i].num_values;
     }
-    if (config->maze_cols > MAX_COLS) {
-        fprintf(stderr, "Warning: maze_cols exceeds MAX_COLS (%d), capping\n", MAX_COLS);
-        config->maze_cols = MAX_COLS;
+    return sweep->axes[axis].values[point % sweep->axes[axis].num_values];
+}
+
+SimConfig* sweep_point_config(const ConfigSweep* sweep, int point) {
+    SimConfig* config;
+    int i;
+    
+    config = (SimConfig*)malloc(sizeof(SimConfig));
+    if (config == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory for config\n");
+        return NULL;
     }
-    if (config->num_families > MAX_FAMILIES) {
-        fprintf(stderr, "Warning: num_families exceeds MAX_FAMILIES (%d), capping\n", MAX_FAMILIES);
-        config->num_families = MAX_FAMILIES;
+    
+    *config = sweep->base;
+    for (i = 0; i < sweep->num_axes; i++) {
+        parse_config_line(config, sweep->axes[i].key, sweep_point_value(sweep, point, i));
     }
-    if (config->babies_per_family > MAX_BABIES) {
-        fprintf(stderr, "Warning: babies_per_family exceeds MAX_BABIES (%d), capping\n", MAX_BABIES);
-        config->babies_per_family = MAX_BABIES;
+    if (validate_config(config) != 0) {
+        free(config);
+        return NULL;
     }
     
     return config;
 }
 
+void free_config_sweep(ConfigSweep* sweep) {
+    free(sweep);
+}
+
 
 void print_config(const SimConfig* config) {
     printf("\n========== SIMULATION CONFIGURATION ==========\n");
@@ -227,6 +636,24 @@ void print_config(const SimConfig* config) {
     printf("  winning_basket_threshold:%d\n", config->winning_basket_threshold);
     printf("  baby_eaten_threshold:   %d\n", config->baby_eaten_threshold);
     printf("  max_simulation_time:    %d seconds\n", config->max_simulation_time_seconds);
+    
+    printf("\n--- Runtime Settings ---\n");
+    printf("  seed:                   %u%s\n", config->seed, config->seed == 0 ? " (random)" : "");
+    printf("  shm_hugepages:          %d\n", config->shm_hugepages);
+    printf("  maze_lock_stripes:      %d\n", config->maze_lock_stripes);
+    printf("  event_ring_capacity:    %d\n", config->event_ring_capacity);
+    printf("  trace_file:             %s\n", config->trace_file[0] ? config->trace_file : "(none)");
+    printf("  trace_max_records:      %ld\n", config->trace_max_records);
+    printf("  record_max_records:     %ld\n", config->record_max_records);
+    printf("  execution_mode:         %s\n",
+           config->execution_mode == EXEC_MODE_POOL ? "pool" : "process");
+    printf("  pool_workers:           %d%s\n", config->pool_workers,
+           config->pool_workers == 0 ? " (online CPUs)" : "");
+    printf("  display_refresh_ms:     %d\n", config->display_refresh_ms);
+    printf("  frame_file:             %s\n", config->frame_file[0] ? config->frame_file : "(none)");
+    printf("  frame_format:           %s\n", frame_format_name(config->frame_format));
+    printf("  frame_interval_ms:      %d\n", config->frame_interval_ms);
+    printf("  frame_cell_pixels:      %d\n", config->frame_cell_pixels);
     printf("===============================================\n\n");
 }
 
@@ -21,11 +21,130 @@ float calculate_fight_probability(int my_bananas, int their_bananas, const SimCo
 }
 
 void sync_basket_to_shared_unlocked(FamilyLocal* local) {
-    local->shared->families[local->family_id].basket_bananas = local->basket_bananas;
+    family_status(local->shared, local->family_id)->basket_bananas = local->basket_bananas;
 }
 
 void sync_basket_from_shared_unlocked(FamilyLocal* local) {
-    local->basket_bananas = local->shared->families[local->family_id].basket_bananas;
+    local->basket_bananas = family_status(local->shared, local->family_id)->basket_bananas;
+}
+
+/*
+ * Copy the private family state to shared memory for checkpoints
+ * Caller holds family_lock
+ */
+static void publish_family_state(FamilyLocal* local) {
+    FamilyState* state = family_state(local->shared, local->family_id);
+    
+    state->basket_bananas = local->basket_bananas;
+    state->male_energy = local->male_energy;
+    state->male_fighting = local->male_fighting;
+    state->female_energy = local->female_energy;
+    state->female_x = local->female_x;
+    state->female_y = local->female_y;
+    state->female_collected = local->female_collected;
+    state->female_in_maze = local->female_in_maze;
+    state->female_resting = local->female_resting;
+    state->should_withdraw = local->should_withdraw;
+}
+
+/*
+ * Simulated sleep of a family thread, for the step's time or until the
+ * family event fires (FAMILY_PARK_EVENT)
+ * Under virtual time the family state is published first: the last thread
+ * of the family to park leaves the state a checkpoint will see
+ */
+static void family_park(FamilyLocal* local, int actor, const ActorStep* step) {
+    SharedData* shared = local->shared;
+    
+    if (shared->clock.mode == TIME_MODE_VIRTUAL) {
+        pthread_mutex_lock(&local->family_lock);
+        publish_family_state(local);
+        pthread_mutex_unlock(&local->family_lock);
+    }
+    if (step->sleep_ms == FAMILY_PARK_EVENT) {
+        sim_park_event(shared, actor, step->resume,
+                       &family_event(shared, local->family_id)->generation, step->event_seen);
+    } else {
+        sim_park_ms(shared, actor, step->sleep_ms, step->resume, step->resume_arg);
+    }
+}
+
+/*
+ * Unregister a family thread from the clock, publishing its last changes
+ */
+static void family_actor_exit(FamilyLocal* local) {
+    pthread_mutex_lock(&local->family_lock);
+    publish_family_state(local);
+    pthread_mutex_unlock(&local->family_lock);
+    sim_actor_exit(local->shared);
+}
+
+/*
+ * End a thread's step with a park of the given length
+ * Returns 1, the step functions' "parked" result
+ */
+static int park_step(ActorStep* step, int milliseconds, int resume, int resume_arg) {
+    step->sleep_ms = milliseconds;
+    step->resume = resume;
+    step->resume_arg = resume_arg;
+    return 1;
+}
+
+/*
+ * Wait for the family event to move past seen (caller holds family_lock)
+ * seen must be read before the caller checked its wait condition, so a
+ * signal sent in between is not lost
+ * Real time: blocks on the event channel, family_lock released meanwhile
+ * Virtual time: a blocked thread would stall the shared clock, so the wait
+ * ends the step with an event park instead: family_lock is released and
+ * the caller returns, to be resumed at resume once the event fires
+ * Returns 1 if the step parked, 0 after a real-time wait
+ */
+static int wait_family_signal(FamilyLocal* local, uint32_t seen, ActorStep* step, int resume) {
+    sim_event_t* event = family_event(local->shared, local->family_id);
+    
+    pthread_mutex_unlock(&local->family_lock);
+    if (local->shared->clock.mode == TIME_MODE_VIRTUAL) {
+        step->event_seen = seen;
+        return park_step(step, FAMILY_PARK_EVENT, resume, 0);
+    }
+    
+    sim_event_wait(event, seen);
+    pthread_mutex_lock(&local->family_lock);
+    return 0;
+}
+
+/*
+ * Current generation of this family's event, read before a wait check
+ */
+static uint32_t family_event_seen(FamilyLocal* local) {
+    return sim_event_read(family_event(local->shared, local->family_id));
+}
+
+void wake_family(SharedData* shared, int family_id) {
+    int i;
+    
+    sim_event_signal(family_event(shared, family_id));
+    for (i = 0; i < shared->babies_per_family; i++) {
+        sim_wake_actor(shared, sim_actor_id(shared, family_id, ROLE_BABY + i));
+    }
+}
+
+void wake_all_families(SharedData* shared) {
+    int i;
+    
+    for (i = 0; i < shared->num_families; i++) {
+        wake_family(shared, i);
+    }
+}
+
+/*
+ * Acquire a family's basket lock
+ * The acquisition order is a recorded decision under record/replay
+ */
+static void lock_basket(SharedData* shared, int family_id) {
+    sim_mutex_lock(basket_lock(shared, family_id));
+    replay_decision(REPLAY_BASKET_LOCK, family_id);
 }
 
 /*
@@ -42,15 +161,16 @@ int add_to_basket(FamilyLocal* local, int amount) {
         return local->basket_bananas;  /* Return current value */
     }
     
-    sem_wait(&shared->basket_locks[family_id]);
+    lock_basket(shared, family_id);
     
     /* Always read from shared memory first (authoritative source) */
-    local->basket_bananas = shared->families[family_id].basket_bananas;
+    local->basket_bananas = family_status(shared, family_id)->basket_bananas;
     local->basket_bananas += amount;
-    shared->families[family_id].basket_bananas = local->basket_bananas;
+    family_status(shared, family_id)->basket_bananas = local->basket_bananas;
     new_total = local->basket_bananas;
     
-    sem_post(&shared->basket_locks[family_id]);
+    sim_mutex_unlock(basket_lock(shared, family_id));
+    note_change(shared);
     
     return new_total;
 }
@@ -68,10 +188,10 @@ int get_basket_count(FamilyLocal* local) {
         return local->basket_bananas;  /* Return cached value */
     }
     
-    sem_wait(&shared->basket_locks[family_id]);
-    count = shared->families[family_id].basket_bananas;
+    lock_basket(shared, family_id);
+    count = family_status(shared, family_id)->basket_bananas;
     local->basket_bananas = count;  /* Update local cache */
-    sem_post(&shared->basket_locks[family_id]);
+    sim_mutex_unlock(basket_lock(shared, family_id));
     
     return count;
 }
@@ -82,7 +202,7 @@ int get_basket_count(FamilyLocal* local) {
 int should_continue(FamilyLocal* local) {
     return local->shared->simulation_running && 
            !local->should_withdraw &&
-           local->shared->families[local->family_id].is_active;
+           family_status(local->shared, local->family_id)->is_active;
 }
 
 /*
@@ -108,41 +228,53 @@ void init_family_local(FamilyLocal* local, int family_id,
     local->should_withdraw = 0;
     
     local->num_babies = config->babies_per_family;
-    for (i = 0; i < MAX_BABIES; i++) {
-        local->baby_eaten[i] = 0;
-    }
+    local->baby_eaten = baby_eaten_state(shared, family_id);
     
     pthread_mutex_init(&local->family_lock, NULL);
-    pthread_cond_init(&local->fight_started, NULL);
-    pthread_cond_init(&local->fight_ended, NULL);
+    
+    /* A restored run picks up the checkpointed state instead */
+    if (shared->restored) {
+        const FamilyState* state = family_state(shared, family_id);
+        
+        local->basket_bananas = state->basket_bananas;
+        local->male_energy = state->male_energy;
+        local->male_fighting = state->male_fighting;
+        local->female_energy = state->female_energy;
+        local->female_x = state->female_x;
+        local->female_y = state->female_y;
+        local->female_collected = state->female_collected;
+        local->female_in_maze = state->female_in_maze;
+        local->female_resting = state->female_resting;
+        local->should_withdraw = state->should_withdraw;
+        return;
+    }
     
     /* Initialize shared status */
-    shared->families[family_id].is_active = 1;
-    shared->families[family_id].basket_bananas = 0;
-    shared->families[family_id].male_fighting = 0;
-    shared->families[family_id].female_fighting = 0;
-    shared->families[family_id].female_opponent = -1;
-    shared->families[family_id].male_energy = config->male_initial_energy;
-    shared->families[family_id].female_energy = config->female_initial_energy;
-    shared->families[family_id].female_in_maze = 0;
-    shared->families[family_id].female_resting = 0;
-    shared->families[family_id].female_collected = 0;
-    shared->families[family_id].total_collected = 0;
-    shared->families[family_id].bananas_from_maze = 0;
-    shared->families[family_id].bananas_from_male_fights = 0;
-    shared->families[family_id].bananas_from_female_fights = 0;
-    shared->families[family_id].bananas_lost_male_fights = 0;
-    shared->families[family_id].bananas_lost_female_fights = 0;
-    for (i = 0; i < MAX_BABIES; i++) {
-        shared->families[family_id].baby_bananas_eaten[i] = 0;
+    family_status(shared, family_id)->is_active = 1;
+    family_status(shared, family_id)->basket_bananas = 0;
+    family_status(shared, family_id)->male_fighting = 0;
+    family_status(shared, family_id)->female_fighting = 0;
+    family_status(shared, family_id)->female_opponent = -1;
+    family_status(shared, family_id)->male_energy = config->male_initial_energy;
+    family_status(shared, family_id)->female_energy = config->female_initial_energy;
+    family_status(shared, family_id)->female_in_maze = 0;
+    family_status(shared, family_id)->female_resting = 0;
+    family_status(shared, family_id)->female_collected = 0;
+    family_status(shared, family_id)->total_collected = 0;
+    family_status(shared, family_id)->bananas_from_maze = 0;
+    family_status(shared, family_id)->bananas_from_male_fights = 0;
+    family_status(shared, family_id)->bananas_from_female_fights = 0;
+    family_status(shared, family_id)->bananas_lost_male_fights = 0;
+    family_status(shared, family_id)->bananas_lost_female_fights = 0;
+    for (i = 0; i < local->num_babies; i++) {
+        local->baby_eaten[i] = 0;
+        baby_bananas_eaten(shared, family_id)[i] = 0;
     }
     
 }
 
 void cleanup_family_local(FamilyLocal* local) {
     pthread_mutex_destroy(&local->family_lock);
-    pthread_cond_destroy(&local->fight_started);
-    pthread_cond_destroy(&local->fight_ended);
 }
 
 void female_fight(FamilyLocal* local, int other_family_id) {
@@ -158,119 +290,125 @@ void female_fight(FamilyLocal* local, int other_family_id) {
     int first = (my_id < other_family_id) ? my_id : other_family_id;
     int second = (my_id < other_family_id) ? other_family_id : my_id;
     
-    sem_wait(&shared->basket_locks[first]);
+    lock_basket(shared, first);
     if (!should_continue(local)) {
-        sem_post(&shared->basket_locks[first]);
+        sim_mutex_unlock(basket_lock(shared, first));
         return;
     }
     
-    sem_wait(&shared->basket_locks[second]);
+    lock_basket(shared, second);
     if (!should_continue(local)) {
-        sem_post(&shared->basket_locks[second]);
-        sem_post(&shared->basket_locks[first]);
+        sim_mutex_unlock(basket_lock(shared, second));
+        sim_mutex_unlock(basket_lock(shared, first));
         return;
     }
     
     /* Get other female's collected bananas from shared memory */
-    int other_collected = shared->families[other_family_id].female_collected;
+    int other_collected = family_status(shared, other_family_id)->female_collected;
     int my_collected = local->female_collected;
     
     /* Mark both females as fighting */
-    shared->families[my_id].female_fighting = 1;
-    shared->families[my_id].female_opponent = other_family_id;
-    shared->families[other_family_id].female_fighting = 1;
-    shared->families[other_family_id].female_opponent = my_id;
+    family_status(shared, my_id)->female_fighting = 1;
+    family_status(shared, my_id)->female_opponent = other_family_id;
+    family_status(shared, other_family_id)->female_fighting = 1;
+    family_status(shared, other_family_id)->female_opponent = my_id;
     
     add_shared_event(shared, "FEMALE FIGHT: Fam%d vs Fam%d (carrying %d vs %d)", 
                      my_id, other_family_id, my_collected, other_collected);
     
     /* Random winner */
     int i_win = random_chance(0.5);
+    replay_decision(REPLAY_FIGHT, i_win);
     
     if (i_win) {
         /* I win - take their bananas */
         local->female_collected += other_collected;
-        shared->families[other_family_id].female_collected = 0;
+        family_status(shared, other_family_id)->female_collected = 0;
         
         /* Track banana flow */
-        shared->families[my_id].bananas_from_female_fights += other_collected;
-        shared->families[other_family_id].bananas_lost_female_fights += other_collected;
+        family_status(shared, my_id)->bananas_from_female_fights += other_collected;
+        family_status(shared, other_family_id)->bananas_lost_female_fights += other_collected;
         
         add_shared_event(shared, "Female %d WON! Took %d bananas from Female %d", 
                          my_id, other_collected, other_family_id);
+        trace_record(shared, TRACE_FEMALE_FIGHT, my_id, other_family_id, -1,
+                     local->female_x, local->female_y, other_collected, local->female_collected);
     } else {
         /* They win - they take my bananas */
-        shared->families[other_family_id].female_collected += my_collected;
+        family_status(shared, other_family_id)->female_collected += my_collected;
         local->female_collected = 0;
         
         /* Track banana flow */
-        shared->families[my_id].bananas_lost_female_fights += my_collected;
-        shared->families[other_family_id].bananas_from_female_fights += my_collected;
+        family_status(shared, my_id)->bananas_lost_female_fights += my_collected;
+        family_status(shared, other_family_id)->bananas_from_female_fights += my_collected;
         
         add_shared_event(shared, "Female %d LOST! Lost %d bananas to Female %d", 
                          my_id, my_collected, other_family_id);
+        trace_record(shared, TRACE_FEMALE_FIGHT, other_family_id, my_id, -1,
+                     local->female_x, local->female_y, my_collected,
+                     family_status(shared, other_family_id)->female_collected);
     }
     
     /* Update my collected in shared memory */
-    shared->families[my_id].female_collected = local->female_collected;
+    family_status(shared, my_id)->female_collected = local->female_collected;
     
     /* Both lose energy */
     pthread_mutex_lock(&local->family_lock);
     local->female_energy -= local->config->female_fight_energy_cost;
     if (local->female_energy < 0) local->female_energy = 0;  /* Prevent negative */
-    shared->families[my_id].female_energy = local->female_energy;
+    family_status(shared, my_id)->female_energy = local->female_energy;
     pthread_mutex_unlock(&local->family_lock);
     
     /* Clear fighting flags */
-    shared->families[my_id].female_fighting = 0;
-    shared->families[my_id].female_opponent = -1;
-    shared->families[other_family_id].female_fighting = 0;
-    shared->families[other_family_id].female_opponent = -1;
+    family_status(shared, my_id)->female_fighting = 0;
+    family_status(shared, my_id)->female_opponent = -1;
+    family_status(shared, other_family_id)->female_fighting = 0;
+    family_status(shared, other_family_id)->female_opponent = -1;
     
-    sem_post(&shared->basket_locks[second]);
-    sem_post(&shared->basket_locks[first]);
+    sim_mutex_unlock(basket_lock(shared, second));
+    sim_mutex_unlock(basket_lock(shared, first));
 }
 
 /* ==================== Male Fight ==================== */
 
 /*
- * Execute male fight with neighbor
+ * Start a male fight with neighbor
  */
-void male_fight(FamilyLocal* local, int opponent_id) {
+int male_fight(FamilyLocal* local, int opponent_id, ActorStep* step) {
     SharedData* shared = local->shared;
     int my_id = local->family_id;
     
     /* Check if simulation is still running */
     if (!should_continue(local)) {
-        return;
+        return 0;
     }
     
     /* Check if opponent is still active */
-    if (!shared->families[opponent_id].is_active) {
-        return;
+    if (!family_status(shared, opponent_id)->is_active) {
+        return 0;
     }
     
     /* Lock both baskets in order to prevent deadlock */
     int first = (my_id < opponent_id) ? my_id : opponent_id;
     int second = (my_id < opponent_id) ? opponent_id : my_id;
     
-    sem_wait(&shared->basket_locks[first]);
+    lock_basket(shared, first);
     if (!should_continue(local)) {
-        sem_post(&shared->basket_locks[first]);
-        return;
+        sim_mutex_unlock(basket_lock(shared, first));
+        return 0;
     }
     
-    sem_wait(&shared->basket_locks[second]);
+    lock_basket(shared, second);
     if (!should_continue(local)) {
-        sem_post(&shared->basket_locks[second]);
-        sem_post(&shared->basket_locks[first]);
-        return;
+        sim_mutex_unlock(basket_lock(shared, second));
+        sim_mutex_unlock(basket_lock(shared, first));
+        return 0;
     }
     
     /* Read CURRENT values from shared memory (authoritative source) */
-    local->basket_bananas = shared->families[my_id].basket_bananas;
+    local->basket_bananas = family_status(shared, my_id)->basket_bananas;
     int my_basket = local->basket_bananas;
-    int their_basket = shared->families[opponent_id].basket_bananas;
+    int their_basket = family_status(shared, opponent_id)->basket_bananas;
     
     add_shared_event(shared, "MALE FIGHT: Fam%d vs Fam%d (basket %d vs %d)", 
                      my_id, opponent_id, my_basket, their_basket);
@@ -278,139 +416,187 @@ void male_fight(FamilyLocal* local, int opponent_id) {
     /* Signal that fight started - babies can steal! */
     pthread_mutex_lock(&local->family_lock);
     local->male_fighting = 1;
-    shared->families[my_id].male_fighting = 1;
-    shared->families[opponent_id].male_fighting = 1;
-    pthread_cond_broadcast(&local->fight_started);
+    family_status(shared, my_id)->male_fighting = 1;
+    family_status(shared, opponent_id)->male_fighting = 1;
     pthread_mutex_unlock(&local->family_lock);
+    note_change(shared);
+    wake_family(shared, my_id);
     
     /* Fight duration - release locks during sleep to allow babies to steal */
-    sem_post(&shared->basket_locks[second]);
-    sem_post(&shared->basket_locks[first]);
+    sim_mutex_unlock(basket_lock(shared, second));
+    sim_mutex_unlock(basket_lock(shared, first));
     
-    sleep_ms(200 + random_int(0, 300));
+    return park_step(step, 200 + random_int(0, 300), RESUME_MALE_FIGHT, opponent_id);
+}
+
+/*
+ * Second half of a male fight, after its duration: pick the winner,
+ * move the baskets and end the fight
+ */
+static void settle_male_fight(FamilyLocal* local, int opponent_id) {
+    SharedData* shared = local->shared;
+    int my_id = local->family_id;
+    int first = (my_id < opponent_id) ? my_id : opponent_id;
+    int second = (my_id < opponent_id) ? opponent_id : my_id;
+    int my_basket, their_basket;
     
     /* Re-acquire locks to determine outcome */
-    sem_wait(&shared->basket_locks[first]);
-    sem_wait(&shared->basket_locks[second]);
+    lock_basket(shared, first);
+    lock_basket(shared, second);
     
     /* Re-read current values (may have changed during fight!) */
-    my_basket = shared->families[my_id].basket_bananas;
-    their_basket = shared->families[opponent_id].basket_bananas;
+    my_basket = family_status(shared, my_id)->basket_bananas;
+    their_basket = family_status(shared, opponent_id)->basket_bananas;
     
     /* Determine winner */
     int i_win = random_chance(0.5);
+    replay_decision(REPLAY_FIGHT, i_win);
     
     if (i_win) {
         /* I win - take their basket */
         local->basket_bananas = my_basket + their_basket;
-        shared->families[opponent_id].basket_bananas = 0;
-        shared->families[my_id].basket_bananas = local->basket_bananas;
+        family_status(shared, opponent_id)->basket_bananas = 0;
+        family_status(shared, my_id)->basket_bananas = local->basket_bananas;
         
         /* Track banana flow */
-        shared->families[my_id].bananas_from_male_fights += their_basket;
-        shared->families[opponent_id].bananas_lost_male_fights += their_basket;
+        family_status(shared, my_id)->bananas_from_male_fights += their_basket;
+        family_status(shared, opponent_id)->bananas_lost_male_fights += their_basket;
         
         add_shared_event(shared, "Male %d WON! Took %d from Male %d (basket=%d)", 
                          my_id, their_basket, opponent_id, local->basket_bananas);
+        trace_record(shared, TRACE_MALE_FIGHT, my_id, opponent_id, -1, -1, -1,
+                     their_basket, local->basket_bananas);
         
         /* Check winning threshold */
         if (local->basket_bananas >= local->config->winning_basket_threshold) {
-            sem_wait(&shared->global_lock);
+            sim_mutex_lock(&shared->global_lock);
             shared->simulation_running = 0;
             shared->termination_reason = TERM_BASKET_THRESHOLD;
+            shared->termination_ms = sim_elapsed_ms(shared);
             shared->winning_family = my_id;
-            sem_post(&shared->global_lock);
+            sim_mutex_unlock(&shared->global_lock);
+            wake_all_families(shared);
             add_shared_event(shared, "Family %d WINS! Reached basket threshold!", my_id);
+            trace_record(shared, TRACE_TERMINATE, my_id, -1, -1, -1, -1, -1, TERM_BASKET_THRESHOLD);
         }
     } else {
         /* They win - lose my basket */
-        shared->families[opponent_id].basket_bananas = their_basket + my_basket;
+        family_status(shared, opponent_id)->basket_bananas = their_basket + my_basket;
         local->basket_bananas = 0;
-        shared->families[my_id].basket_bananas = 0;
+        family_status(shared, my_id)->basket_bananas = 0;
         
         /* Track banana flow */
-        shared->families[opponent_id].bananas_from_male_fights += my_basket;
-        shared->families[my_id].bananas_lost_male_fights += my_basket;
+        family_status(shared, opponent_id)->bananas_from_male_fights += my_basket;
+        family_status(shared, my_id)->bananas_lost_male_fights += my_basket;
         
         add_shared_event(shared, "Male %d LOST! Lost %d bananas to Male %d", 
                          my_id, my_basket, opponent_id);
+        trace_record(shared, TRACE_MALE_FIGHT, opponent_id, my_id, -1, -1, -1,
+                     my_basket, family_status(shared, opponent_id)->basket_bananas);
     }
     
     /* BOTH fighters lose energy */
     pthread_mutex_lock(&local->family_lock);
     local->male_energy -= local->config->male_fight_energy_cost;
     if (local->male_energy < 0) local->male_energy = 0;  /* Prevent negative */
-    shared->families[my_id].male_energy = local->male_energy;
+    family_status(shared, my_id)->male_energy = local->male_energy;
     pthread_mutex_unlock(&local->family_lock);
     
     /* OPPONENT also loses energy! */
-    int opponent_old_energy = shared->families[opponent_id].male_energy;
-    shared->families[opponent_id].male_energy -= local->config->male_fight_energy_cost;
-    if (shared->families[opponent_id].male_energy < 0) {
-        shared->families[opponent_id].male_energy = 0;
+    int opponent_old_energy = family_status(shared, opponent_id)->male_energy;
+    family_status(shared, opponent_id)->male_energy -= local->config->male_fight_energy_cost;
+    if (family_status(shared, opponent_id)->male_energy < 0) {
+        family_status(shared, opponent_id)->male_energy = 0;
     }
     
     add_shared_event(shared, "Male %d energy: %d->%d, Male %d energy: %d->%d (fight cost: %d each)", 
                      my_id, local->male_energy + local->config->male_fight_energy_cost, local->male_energy,
-                     opponent_id, opponent_old_energy, shared->families[opponent_id].male_energy,
+                     opponent_id, opponent_old_energy, family_status(shared, opponent_id)->male_energy,
                      local->config->male_fight_energy_cost);
     
     /* Signal fight ended */
     pthread_mutex_lock(&local->family_lock);
     local->male_fighting = 0;
-    shared->families[my_id].male_fighting = 0;
-    shared->families[opponent_id].male_fighting = 0;
-    pthread_cond_broadcast(&local->fight_ended);
+    family_status(shared, my_id)->male_fighting = 0;
+    family_status(shared, opponent_id)->male_fighting = 0;
     pthread_mutex_unlock(&local->family_lock);
+    note_change(shared);  /* Also covers the baskets and energies above */
+    wake_family(shared, my_id);
     
-    sem_post(&shared->basket_locks[second]);
-    sem_post(&shared->basket_locks[first]);
+    sim_mutex_unlock(basket_lock(shared, second));
+    sim_mutex_unlock(basket_lock(shared, first));
 }
 
 
-void* female_thread(void* arg) {
-    FamilyLocal* local = (FamilyLocal*)arg;
+/*
+ * End of a female's rest: recover energy and clear the resting flag
+ */
+static void female_recover(FamilyLocal* local) {
     SharedData* shared = local->shared;
     const SimConfig* config = local->config;
     int family_id = local->family_id;
     
+    pthread_mutex_lock(&local->family_lock);
+    int old_energy = local->female_energy;
+    local->female_energy += config->female_rest_recovery;
+    if (local->female_energy > config->female_initial_energy) {
+        local->female_energy = config->female_initial_energy;
+    }
+    local->female_resting = 0;
+    family_status(shared, family_id)->female_resting = 0;  /* Clear resting flag */
+    family_status(shared, family_id)->female_energy = local->female_energy;
+    pthread_mutex_unlock(&local->family_lock);
+    note_change(shared);
+    
+    add_shared_event(shared, "Female %d recovered energy (%d -> %d)", 
+                     family_id, old_energy, local->female_energy);
+    trace_record(shared, TRACE_FEMALE_RECOVER, family_id, -1, -1, -1, -1, -1,
+                 local->female_energy);
+}
+
+/* ==================== Thread Steps ==================== */
+
+/*
+ * A family thread runs as steps: each one continues from step->resume and
+ * goes up to the thread's next simulated sleep, which it describes in step
+ * Returns 1 if the step ended with a park, 0 once the thread has finished
+ */
+
+static int female_step(FamilyLocal* local, ActorStep* step) {
+    SharedData* shared = local->shared;
+    const SimConfig* config = local->config;
+    int family_id = local->family_id;
+    
+    if (step->resume == RESUME_FEMALE_REST) female_recover(local);
+    
     while (should_continue(local)) {
         /* Check if resting */
         if (local->female_resting) {
-            sleep_ms(1000);
-            
-            pthread_mutex_lock(&local->family_lock);
-            int old_energy = local->female_energy;
-            local->female_energy += config->female_rest_recovery;
-            if (local->female_energy > config->female_initial_energy) {
-                local->female_energy = config->female_initial_energy;
-            }
-            local->female_resting = 0;
-            shared->families[family_id].female_resting = 0;  /* Clear resting flag */
-            shared->families[family_id].female_energy = local->female_energy;
-            pthread_mutex_unlock(&local->family_lock);
-            
-            add_shared_event(shared, "Female %d recovered energy (%d -> %d)", 
-                             family_id, old_energy, local->female_energy);
-            continue;
+            return park_step(step, 1000, RESUME_FEMALE_REST, 0);
         }
         
         /* Check energy level */
         if (local->female_energy <= 0) {
             /* ZERO energy - MUST rest, even if carrying bananas (vulnerable!) */
             local->female_resting = 1;
-            shared->families[family_id].female_resting = 1;  /* Mark as resting in shared memory */
+            family_status(shared, family_id)->female_resting = 1;  /* Mark as resting in shared memory */
             add_shared_event(shared, "Female %d EXHAUSTED (energy=0)! Resting in maze%s", 
                              family_id, 
                              local->female_collected > 0 ? " - VULNERABLE with bananas!" : "");
+            trace_record(shared, TRACE_FEMALE_EXHAUSTED, family_id, -1, -1,
+                         local->female_in_maze ? local->female_x : -1,
+                         local->female_in_maze ? local->female_y : -1,
+                         -1, local->female_collected);
             continue;
         } else if (local->female_energy < config->female_rest_threshold) {
             /* Low energy but not zero - if carrying bananas, head to exit first */
             if (!(local->female_collected > 0 && local->female_in_maze)) {
                 local->female_resting = 1;
-                shared->families[family_id].female_resting = 1;
+                family_status(shared, family_id)->female_resting = 1;
                 add_shared_event(shared, "Female %d resting (energy=%d < threshold=%d)", 
                                  family_id, local->female_energy, config->female_rest_threshold);
+                trace_record(shared, TRACE_FEMALE_REST, family_id, -1, -1, -1, -1, -1,
+                             local->female_energy);
                 continue;
             }
         }
@@ -421,15 +607,16 @@ void* female_thread(void* arg) {
                 local->female_in_maze = 1;
                 set_female_in_cell(shared, local->female_x, local->female_y, family_id, 1);
                 
-                shared->families[family_id].female_in_maze = 1;
-                shared->families[family_id].female_x = local->female_x;
-                shared->families[family_id].female_y = local->female_y;
+                family_status(shared, family_id)->female_in_maze = 1;
+                family_status(shared, family_id)->female_x = local->female_x;
+                family_status(shared, family_id)->female_y = local->female_y;
                 
                 add_shared_event(shared, ">>> Female %d ENTERED maze at BORDER row %d, col %d", 
                                  family_id, local->female_x, local->female_y);
+                trace_record(shared, TRACE_FEMALE_ENTER, family_id, -1, -1,
+                             local->female_x, local->female_y, -1, -1);
             } else {
-                sleep_ms(500);
-                continue;
+                return park_step(step, 500, RESUME_LOOP, 0);
             }
         }
         
@@ -437,31 +624,40 @@ void* female_thread(void* arg) {
         
         /* Check for collision with other female */
         if (should_continue(local)) {
-            sem_wait(&shared->maze_locks[local->female_x][local->female_y]);
             int other = check_female_collision(shared, local->female_x, local->female_y, family_id);
-            sem_post(&shared->maze_locks[local->female_x][local->female_y]);
             
             if (other >= 0 && should_continue(local)) {
-                /* Check if other female is resting with 0 energy - STEAL without fight! */
-                if (shared->families[other].female_resting && 
-                    shared->families[other].female_energy <= 0 &&
-                    shared->families[other].female_collected > 0) {
+                int x = local->female_x, y = local->female_y;
+                int stolen = 0;
+                
+                /* Check if other female is resting with 0 energy - STEAL without fight!
+                 * The cell's lock stripe keeps two thieves in this cell from
+                 * both taking the same bananas */
+                sim_mutex_lock(maze_lock(shared, x, y));
+                if (family_status(shared, other)->female_resting && 
+                    family_status(shared, other)->female_energy <= 0 &&
+                    family_status(shared, other)->female_collected > 0) {
                     
                     /* Steal bananas without fighting - she has no energy to resist! */
-                    int stolen = shared->families[other].female_collected;
+                    stolen = family_status(shared, other)->female_collected;
                     
                     pthread_mutex_lock(&local->family_lock);
                     local->female_collected += stolen;
-                    shared->families[family_id].female_collected = local->female_collected;
-                    shared->families[family_id].bananas_from_female_fights += stolen;
+                    family_status(shared, family_id)->female_collected = local->female_collected;
+                    family_status(shared, family_id)->bananas_from_female_fights += stolen;
                     pthread_mutex_unlock(&local->family_lock);
                     
-                    shared->families[other].female_collected = 0;
-                    shared->families[other].bananas_lost_female_fights += stolen;
-                    
+                    family_status(shared, other)->female_collected = 0;
+                    family_status(shared, other)->bananas_lost_female_fights += stolen;
+                }
+                sim_mutex_unlock(maze_lock(shared, x, y));
+                
+                if (stolen > 0) {
                     add_shared_event(shared, "Female %d STOLE %d bananas from EXHAUSTED Female %d (no fight!)", 
                                      family_id, stolen, other);
-                } else if (shared->families[other].female_collected > 0 || local->female_collected > 0) {
+                    trace_record(shared, TRACE_FEMALE_STEAL, family_id, other, -1, x, y,
+                                 stolen, local->female_collected);
+                } else if (family_status(shared, other)->female_collected > 0 || local->female_collected > 0) {
                     /* Normal fight - both have energy */
                     female_fight(local, other);
                 }
@@ -473,10 +669,12 @@ void* female_thread(void* arg) {
             /* At exit - leave maze and deposit bananas */
             set_female_in_cell(shared, local->female_x, local->female_y, family_id, 0);
             local->female_in_maze = 0;
-            shared->families[family_id].female_in_maze = 0;
+            family_status(shared, family_id)->female_in_maze = 0;
             
             add_shared_event(shared, "Female %d exited maze at EXIT row 0, col %d", 
                              family_id, local->female_y);
+            trace_record(shared, TRACE_FEMALE_EXIT, family_id, -1, -1,
+                         local->female_x, local->female_y, local->female_collected, -1);
             
             if (local->female_collected > 0) {
                 /* Deposit to basket using thread-safe function */
@@ -485,28 +683,32 @@ void* female_thread(void* arg) {
                 
                 pthread_mutex_lock(&local->family_lock);
                 local->female_collected = 0;
-                shared->families[family_id].female_collected = 0;
-                shared->families[family_id].total_collected += collected;
+                family_status(shared, family_id)->female_collected = 0;
+                family_status(shared, family_id)->total_collected += collected;
                 pthread_mutex_unlock(&local->family_lock);
                 
                 add_shared_event(shared, "Female %d deposited %d bananas (basket=%d)", 
                                  family_id, collected, new_total);
+                trace_record(shared, TRACE_DEPOSIT, family_id, -1, -1, -1, -1, collected, new_total);
                 
                 /* Check winning threshold */
                 if (new_total >= config->winning_basket_threshold) {
-                    sem_wait(&shared->global_lock);
+                    sim_mutex_lock(&shared->global_lock);
                     shared->simulation_running = 0;
                     shared->termination_reason = TERM_BASKET_THRESHOLD;
+                    shared->termination_ms = sim_elapsed_ms(shared);
                     shared->winning_family = family_id;
-                    sem_post(&shared->global_lock);
+                    sim_mutex_unlock(&shared->global_lock);
+                    wake_all_families(shared);
                     add_shared_event(shared, "Family %d WINS! Basket threshold reached!", family_id);
+                    trace_record(shared, TRACE_TERMINATE, family_id, -1, -1, -1, -1, -1,
+                                 TERM_BASKET_THRESHOLD);
                 }
             } else {
                 add_shared_event(shared, "Female %d exited empty-handed", family_id);
             }
             
-            sleep_ms(300);  /* Brief rest before re-entering */
-            continue;
+            return park_step(step, 300, RESUME_LOOP, 0);  /* Brief rest before re-entering */
         }
         
         /* Collect bananas at current cell */
@@ -521,12 +723,14 @@ void* female_thread(void* arg) {
                 int taken = take_bananas(shared, local->female_x, local->female_y, to_take);
                 if (should_continue(local)) {
                     local->female_collected += taken;
-                    shared->families[family_id].female_collected = local->female_collected;
+                    family_status(shared, family_id)->female_collected = local->female_collected;
                     
                     /* Track collection from maze */
-                    shared->families[family_id].bananas_from_maze += taken;
+                    family_status(shared, family_id)->bananas_from_maze += taken;
                     add_shared_event(shared, "Female %d collected %d at (%d,%d), carrying=%d", 
                                      family_id, taken, local->female_x, local->female_y, local->female_collected);
+                    trace_record(shared, TRACE_COLLECT, family_id, -1, -1, local->female_x,
+                                 local->female_y, taken, local->female_collected);
                 }
             }
         }
@@ -541,31 +745,24 @@ void* female_thread(void* arg) {
         }
         
         if (direction >= 0) {
-            /* Remove from current cell */
-            set_female_in_cell(shared, local->female_x, local->female_y, family_id, 0);
-            
             /* Move */
-            int old_x = local->female_x, old_y = local->female_y;
             if (move_in_direction(shared, &local->female_x, &local->female_y, direction)) {
-                /* Add to new cell */
+                /* Relocate in the spatial index (leaves the old cell) */
                 set_female_in_cell(shared, local->female_x, local->female_y, family_id, 1);
                 
-                shared->families[family_id].female_x = local->female_x;
-                shared->families[family_id].female_y = local->female_y;
+                family_status(shared, family_id)->female_x = local->female_x;
+                family_status(shared, family_id)->female_y = local->female_y;
                 
                 /* Lose energy for moving */
                 pthread_mutex_lock(&local->family_lock);
                 local->female_energy -= config->female_move_energy_cost;
                 if (local->female_energy < 0) local->female_energy = 0;  /* Prevent negative */
-                shared->families[family_id].female_energy = local->female_energy;
+                family_status(shared, family_id)->female_energy = local->female_energy;
                 pthread_mutex_unlock(&local->family_lock);
-            } else {
-                /* Couldn't move, stay in place */
-                set_female_in_cell(shared, old_x, old_y, family_id, 1);
             }
         }
         
-        sleep_ms(300);  /* Movement delay */
+        return park_step(step, 300, RESUME_LOOP, 0);  /* Movement delay */
     }
     
     /* Cleanup: remove from maze if still there */
@@ -573,12 +770,11 @@ void* female_thread(void* arg) {
         set_female_in_cell(shared, local->female_x, local->female_y, family_id, 0);
     }
     
-    return NULL;
+    return 0;
 }
 
 
-void* male_thread(void* arg) {
-    FamilyLocal* local = (FamilyLocal*)arg;
+static int male_step(FamilyLocal* local, ActorStep* step) {
     SharedData* shared = local->shared;
     const SimConfig* config = local->config;
     int family_id = local->family_id;
@@ -586,10 +782,16 @@ void* male_thread(void* arg) {
     int left_neighbor, right_neighbor;
     get_neighbors(family_id, shared->num_families, &left_neighbor, &right_neighbor);
     
+    /* Fight over: settle it, then wait out the check interval */
+    if (step->resume == RESUME_MALE_FIGHT) {
+        settle_male_fight(local, step->resume_arg);
+        return park_step(step, 500, RESUME_LOOP, 0);
+    }
+    
     while (should_continue(local)) {
         /* SYNC energy from shared memory - another male might have decreased it! */
         pthread_mutex_lock(&local->family_lock);
-        local->male_energy = shared->families[family_id].male_energy;
+        local->male_energy = family_status(shared, family_id)->male_energy;
         pthread_mutex_unlock(&local->family_lock);
         
         /* Check energy level */
@@ -597,22 +799,31 @@ void* male_thread(void* arg) {
             /* Mark family as withdrawn */
             pthread_mutex_lock(&local->family_lock);
             local->should_withdraw = 1;
-            shared->families[family_id].is_active = 0;
+            family_status(shared, family_id)->is_active = 0;
             pthread_mutex_unlock(&local->family_lock);
+            note_change(shared);
             
             /* Update global withdrawn count */
-            sem_wait(&shared->global_lock);
+            int ends_run = 0;
+            sim_mutex_lock(&shared->global_lock);
             shared->withdrawn_count++;
             
             if (shared->withdrawn_count >= config->max_withdrawn_families) {
                 shared->simulation_running = 0;
                 shared->termination_reason = TERM_WITHDRAWN_THRESHOLD;
+                shared->termination_ms = sim_elapsed_ms(shared);
                 add_shared_event(shared, "Too many families withdrawn! Simulation ends!");
+                trace_record(shared, TRACE_TERMINATE, -1, -1, -1, -1, -1, -1,
+                             TERM_WITHDRAWN_THRESHOLD);
+                ends_run = 1;
             }
-            sem_post(&shared->global_lock);
+            sim_mutex_unlock(&shared->global_lock);
+            if (ends_run) wake_all_families(shared);
             
             add_shared_event(shared, "Family %d WITHDRAWN! Male energy=%d, basket=%d", 
                              family_id, local->male_energy, local->basket_bananas);
+            trace_record(shared, TRACE_WITHDRAW, family_id, -1, -1, -1, -1,
+                         local->basket_bananas, local->male_energy);
             break;
         }
         
@@ -632,65 +843,84 @@ void* male_thread(void* arg) {
         }
         
         /* Check left neighbor */
-        if (left_neighbor >= 0 && shared->families[left_neighbor].is_active && should_continue(local)) {
-            int their_bananas = shared->families[left_neighbor].basket_bananas;
+        if (left_neighbor >= 0 && family_status(shared, left_neighbor)->is_active && should_continue(local)) {
+            int their_bananas = family_status(shared, left_neighbor)->basket_bananas;
             float prob = calculate_fight_probability(my_bananas, their_bananas, config);
             
             if (random_chance(prob)) {
                 target = left_neighbor;
                 add_shared_event(shared, "Male %d decides to fight Male %d (prob=%.0f%%, baskets: %d vs %d)",
                                  family_id, left_neighbor, prob * 100, my_bananas, their_bananas);
+                trace_record(shared, TRACE_MALE_CHALLENGE, family_id, left_neighbor, -1, -1, -1,
+                             -1, (int)(prob * 100 + 0.5f));
             }
         }
         
         /* Check right neighbor if no fight with left */
-        if (target < 0 && right_neighbor >= 0 && shared->families[right_neighbor].is_active && should_continue(local)) {
-            int their_bananas = shared->families[right_neighbor].basket_bananas;
+        if (target < 0 && right_neighbor >= 0 && family_status(shared, right_neighbor)->is_active && should_continue(local)) {
+            int their_bananas = family_status(shared, right_neighbor)->basket_bananas;
             float prob = calculate_fight_probability(my_bananas, their_bananas, config);
             
             if (random_chance(prob)) {
                 target = right_neighbor;
                 add_shared_event(shared, "Male %d decides to fight Male %d (prob=%.0f%%, baskets: %d vs %d)",
                                  family_id, right_neighbor, prob * 100, my_bananas, their_bananas);
+                trace_record(shared, TRACE_MALE_CHALLENGE, family_id, right_neighbor, -1, -1, -1,
+                             -1, (int)(prob * 100 + 0.5f));
             }
         }
         
-        /* Execute fight if target found */
-        if (target >= 0 && should_continue(local)) {
-            male_fight(local, target);
+        /* Execute fight if target found; the step parks for its duration */
+        if (target >= 0 && should_continue(local) && male_fight(local, target, step)) {
+            return 1;
         }
         
-        sleep_ms(500);  /* Check interval */
+        return park_step(step, 500, RESUME_LOOP, 0);  /* Check interval */
     }
     
     /* Wake up babies so they can exit */
     pthread_mutex_lock(&local->family_lock);
     local->should_withdraw = 1;  /* Signal all threads to stop */
-    pthread_cond_broadcast(&local->fight_started);
-    pthread_cond_broadcast(&local->fight_ended);
     pthread_mutex_unlock(&local->family_lock);
+    wake_family(shared, local->family_id);
     
-    return NULL;
+    return 0;
 }
 
-void* baby_thread(void* arg) {
-    BabyArg* baby_arg = (BabyArg*)arg;
-    int baby_id = baby_arg->baby_id;
-    FamilyLocal* local = baby_arg->family;
+/*
+ * Wait for dad's current fight to end
+ * This limits a baby to ONE steal attempt per fight
+ * Returns 1 if the step parked (virtual time), 0 once the fight is over
+ */
+static int wait_for_fight_end(FamilyLocal* local, ActorStep* step) {
+    pthread_mutex_lock(&local->family_lock);
+    for (;;) {
+        uint32_t seen = family_event_seen(local);
+        
+        if (!local->male_fighting || !should_continue(local)) break;
+        if (wait_family_signal(local, seen, step, RESUME_BABY_FIGHT_END)) return 1;
+    }
+    pthread_mutex_unlock(&local->family_lock);
+    return 0;
+}
+
+static int baby_step(FamilyLocal* local, int baby_id, ActorStep* step) {
     SharedData* shared = local->shared;
     const SimConfig* config = local->config;
     int family_id = local->family_id;
     
+    if (step->resume == RESUME_BABY_FIGHT_END && wait_for_fight_end(local, step)) return 1;
+    
     while (should_continue(local)) {
         /* Wait for a fight to start */
         pthread_mutex_lock(&local->family_lock);
         
-        while (!local->male_fighting && should_continue(local)) {
-            /* Use timed wait to periodically check if we should exit */
-            struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_sec += 1;  /* 1 second timeout */
-            pthread_cond_timedwait(&local->fight_started, &local->family_lock, &ts);
+        for (;;) {
+            uint32_t seen = family_event_seen(local);
+            
+            if (local->male_fighting || !should_continue(local)) break;
+            /* Woken when dad starts a fight or the family stops */
+            if (wait_family_signal(local, seen, step, RESUME_LOOP)) return 1;
         }
         
         pthread_mutex_unlock(&local->family_lock);
@@ -707,8 +937,8 @@ void* baby_thread(void* arg) {
             int candidate = random_int(0, shared->num_families - 1);
             
             if (candidate != family_id && 
-                shared->families[candidate].is_active &&
-                shared->families[candidate].basket_bananas > 0) {
+                family_status(shared, candidate)->is_active &&
+                family_status(shared, candidate)->basket_bananas > 0) {
                 target = candidate;
             }
             attempts++;
@@ -721,26 +951,26 @@ void* baby_thread(void* arg) {
             
             if (!should_continue(local)) break;
             
-            sem_wait(&shared->basket_locks[first_lock]);
+            lock_basket(shared, first_lock);
             if (!should_continue(local)) {
-                sem_post(&shared->basket_locks[first_lock]);
+                sim_mutex_unlock(basket_lock(shared, first_lock));
                 break;
             }
             
-            sem_wait(&shared->basket_locks[second_lock]);
+            lock_basket(shared, second_lock);
             if (!should_continue(local)) {
-                sem_post(&shared->basket_locks[second_lock]);
-                sem_post(&shared->basket_locks[first_lock]);
+                sim_mutex_unlock(basket_lock(shared, second_lock));
+                sim_mutex_unlock(basket_lock(shared, first_lock));
                 break;
             }
             
-            int available = shared->families[target].basket_bananas;
+            int available = family_status(shared, target)->basket_bananas;
             if (available > 0) {
                 /* Baby steals 1-2 bananas (reduced from 1-3) */
                 int stolen = random_int(1, 2);
                 if (stolen > available) stolen = available;
                 
-                shared->families[target].basket_bananas -= stolen;
+                family_status(shared, target)->basket_bananas -= stolen;
                 
                 /* Decide: eat or give to dad? */
                 if (random_chance(0.5)) {
@@ -749,68 +979,134 @@ void* baby_thread(void* arg) {
                     
                     add_shared_event(shared, "Baby%d Fam%d stole %d from Fam%d & ATE (total eaten: %d)", 
                                      baby_id, family_id, stolen, target, local->baby_eaten[baby_id]);
+                    trace_record(shared, TRACE_BABY_EAT, family_id, target, baby_id, -1, -1,
+                                 stolen, local->baby_eaten[baby_id]);
                     
                     /* Check termination threshold */
                     if (local->baby_eaten[baby_id] >= config->baby_eaten_threshold) {
-                        sem_wait(&shared->global_lock);
+                        sim_mutex_lock(&shared->global_lock);
                         shared->simulation_running = 0;
                         shared->termination_reason = TERM_BABY_ATE_THRESHOLD;
+                        shared->termination_ms = sim_elapsed_ms(shared);
                         shared->winning_family = family_id;
-                        sem_post(&shared->global_lock);
+                        sim_mutex_unlock(&shared->global_lock);
+                        wake_all_families(shared);
                         
                         add_shared_event(shared, "Baby%d Fam%d ate too much! Simulation ends!", baby_id, family_id);
+                        trace_record(shared, TRACE_TERMINATE, family_id, -1, baby_id, -1, -1, -1,
+                                     TERM_BABY_ATE_THRESHOLD);
                     }
                 } else {
                     /* Give to dad's basket - read current value first! */
-                    local->basket_bananas = shared->families[family_id].basket_bananas;
+                    local->basket_bananas = family_status(shared, family_id)->basket_bananas;
                     local->basket_bananas += stolen;
-                    shared->families[family_id].basket_bananas = local->basket_bananas;
+                    family_status(shared, family_id)->basket_bananas = local->basket_bananas;
                     
                     add_shared_event(shared, "Baby%d Fam%d stole %d from Fam%d, gave to Dad (basket=%d)", 
                                      baby_id, family_id, stolen, target, local->basket_bananas);
+                    trace_record(shared, TRACE_BABY_GIVE, family_id, target, baby_id, -1, -1,
+                                 stolen, local->basket_bananas);
                 }
+                note_change(shared);
             }
             
-            sem_post(&shared->basket_locks[second_lock]);
-            sem_post(&shared->basket_locks[first_lock]);
+            sim_mutex_unlock(basket_lock(shared, second_lock));
+            sim_mutex_unlock(basket_lock(shared, first_lock));
         }
         
         /* IMPORTANT: Wait for THIS fight to end before looking for another opportunity */
-        /* This limits baby to ONE steal attempt per fight */
-        pthread_mutex_lock(&local->family_lock);
-        while (local->male_fighting && should_continue(local)) {
-            struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_sec += 1;
-            pthread_cond_timedwait(&local->fight_ended, &local->family_lock, &ts);
-        }
-        pthread_mutex_unlock(&local->family_lock);
+        if (wait_for_fight_end(local, step)) return 1;
     }
     
     /* Save baby's consumption to shared memory for final statistics */
-    shared->families[family_id].baby_bananas_eaten[baby_id] = local->baby_eaten[baby_id];
+    baby_bananas_eaten(shared, family_id)[baby_id] = local->baby_eaten[baby_id];
+    
+    return 0;
+}
+
+/*
+ * One step of a family thread (role is ROLE_FEMALE, ROLE_MALE or
+ * ROLE_BABY + baby_id)
+ */
+static int family_step(FamilyLocal* local, int role, ActorStep* step) {
+    switch (role) {
+        case ROLE_FEMALE: return female_step(local, step);
+        case ROLE_MALE:   return male_step(local, step);
+        default:          return baby_step(local, role - ROLE_BABY, step);
+    }
+}
+
+/*
+ * Body of a family thread: its steps back to back, parked in between
+ */
+static void run_family_thread(FamilyLocal* local, int role) {
+    SharedData* shared = local->shared;
+    int actor = sim_actor_id(shared, local->family_id, role);
+    ActorStep step;
+    
+    seed_thread_random(shared->seed, local->family_id, role);
+    replay_set_actor(actor);
+    step.resume = sim_actor_start(shared, actor);
+    if (step.resume == RESUME_EXITED) return;
+    step.resume_arg = actor_state(shared, actor)->resume_arg;
+    
+    while (family_step(local, role, &step)) {
+        family_park(local, actor, &step);
+    }
+    family_actor_exit(local);
+}
+
+void* female_thread(void* arg) {
+    run_family_thread((FamilyLocal*)arg, ROLE_FEMALE);
+    return NULL;
+}
+
+void* male_thread(void* arg) {
+    run_family_thread((FamilyLocal*)arg, ROLE_MALE);
+    return NULL;
+}
+
+void* baby_thread(void* arg) {
+    BabyArg* baby_arg = (BabyArg*)arg;
     
+    run_family_thread(baby_arg->family, ROLE_BABY + baby_arg->baby_id);
     return NULL;
 }
 
 /* ==================== Main Family Process ==================== */
 
+static void announce_family(const FamilyLocal* local) {
+    SharedData* shared = local->shared;
+    const SimConfig* config = local->config;
+    
+    if (shared->restored) {
+        add_shared_event(shared, "Family %d resumed (Male:%d, Female:%d, Basket:%d)",
+                         local->family_id, local->male_energy, local->female_energy,
+                         local->basket_bananas);
+    } else {
+        add_shared_event(shared, "Family %d started (Male:%d, Female:%d, Babies:%d)", 
+                         local->family_id, config->male_initial_energy,
+                         config->female_initial_energy, config->babies_per_family);
+    }
+    trace_record(shared, TRACE_FAMILY_START, local->family_id, -1, -1, -1, -1, -1, -1);
+}
+
 void run_family_process(int family_id, SharedData* shared, const SimConfig* config) {
     FamilyLocal local;
     pthread_t female_tid, male_tid;
-    pthread_t baby_tids[MAX_BABIES];
-    BabyArg baby_args[MAX_BABIES];
+    BabyArg* baby_args;
     int i;
     
-    /* Initialize random seed for this process */
-    init_random();
-    
     /* Initialize family local data */
     init_family_local(&local, family_id, shared, config);
+    announce_family(&local);
     
-    add_shared_event(shared, "Family %d started (Male:%d, Female:%d, Babies:%d)", 
-                     family_id, config->male_initial_energy, config->female_initial_energy, 
-                     config->babies_per_family);
+    baby_args = (BabyArg*)calloc((size_t)config->babies_per_family, sizeof(BabyArg));
+    if (baby_args == NULL && config->babies_per_family > 0) {
+        fprintf(stderr, "Failed to allocate baby threads\n");
+        cleanup_family_local(&local);
+        exit(1);
+    }
     
     /* Create female thread */
     if (pthread_create(&female_tid, NULL, female_thread, &local) != 0) {
@@ -833,8 +1129,11 @@ void run_family_process(int family_id, SharedData* shared, const SimConfig* conf
         baby_args[i].baby_id = i;
         baby_args[i].family = &local;
         
-        if (pthread_create(&baby_tids[i], NULL, baby_thread, &baby_args[i]) != 0) {
+        baby_args[i].started = 1;
+        if (pthread_create(&baby_args[i].tid, NULL, baby_thread, &baby_args[i]) != 0) {
             perror("Failed to create baby thread");
+            baby_args[i].started = 0;
+            sim_actor_exit(shared);  /* Release the clock slot reserved for it */
         }
     }
     
@@ -843,9 +1142,12 @@ void run_family_process(int family_id, SharedData* shared, const SimConfig* conf
     pthread_join(male_tid, NULL);
     
     for (i = 0; i < config->babies_per_family; i++) {
-        pthread_join(baby_tids[i], NULL);
+        if (baby_args[i].started) {
+            pthread_join(baby_args[i].tid, NULL);
+        }
     }
     
+    free(baby_args);
     cleanup_family_local(&local);
     
     /* Note: Shared memory and config cleanup handled in main.c child process code
@@ -853,3 +1155,40 @@ void run_family_process(int family_id, SharedData* shared, const SimConfig* conf
     exit(0);
 }
 
+/* ==================== Pool Execution ==================== */
+
+void start_family_tasks(FamilyLocal* local, int family_id, SharedData* shared,
+                        const SimConfig* config) {
+    int role;
+    
+    init_family_local(local, family_id, shared, config);
+    announce_family(local);
+    
+    /* Seed each thread's stream as the thread itself would; a restored
+     * run with an unchanged seed keeps the checkpointed streams */
+    if (!shared->restored || !shared->restore_rng) {
+        for (role = 0; role < ROLE_BABY + config->babies_per_family; role++) {
+            seed_thread_random(shared->seed, family_id, role);
+            random_get_state(actor_state(shared, sim_actor_id(shared, family_id, role))->rng);
+        }
+    }
+}
+
+void run_family_step(FamilyLocal* local, int role) {
+    SharedData* shared = local->shared;
+    int actor = sim_actor_id(shared, local->family_id, role);
+    ActorState* state = actor_state(shared, actor);
+    ActorStep step;
+    
+    /* Any worker may run the step: it brings the actor's stream along */
+    random_set_state(state->rng);
+    replay_set_actor(actor);
+    
+    step.resume = state->resume;
+    step.resume_arg = state->resume_arg;
+    if (family_step(local, role, &step)) {
+        family_park(local, actor, &step);
+    } else {
+        family_actor_exit(local);
+    }
+}
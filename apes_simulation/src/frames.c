@@ -0,0 +1,505 @@
+/*
+ * frames.c
+ * Headless frame recorder: software rasteriser and PPM/Y4M/raw writer
+ */
+
+#include "local.h"
+#include <math.h>
+
+#define FRAME_GRID_MIN 4                // Cell pixels from which grid lines are drawn
+#define FRAME_DETAIL_MIN 8              // Cell pixels from which rocks and bananas get their shapes
+#define FRAME_COLORS 6                  // Family colours, as in apes_viewer
+
+/* What a cell can show; every kind has a stamp on the maze floor and one
+ * on the exit row */
+enum {
+    STAMP_FLOOR = 0,
+    STAMP_ROCK,
+    STAMP_BANANA,
+    STAMP_APE,                          // + family % FRAME_COLORS
+    STAMP_KINDS = STAMP_APE + FRAME_COLORS
+};
+
+#define STAMP_NONE 0xFF                 // Cell not drawn yet
+
+typedef struct {
+    int fd;
+    int format;                         // FRAME_FORMAT_*
+    int interval_ms;
+    int cell;                           // Cell side in pixels
+    int rows, cols;
+    int width, height;                  // Frame size in pixels
+    long long next_ms;                  // When the next frame is due (-1 = at the first capture)
+    struct timespec start;              // Real mode: time zero
+    unsigned char* stamps;              // 2 * STAMP_KINDS stamps, 3 bytes per pixel in the output colour space
+    unsigned char* buffer;              // Frame header, then the picture
+    size_t header_len;
+    size_t frame_len;                   // Header and picture
+    uint8_t* kinds;                     // Per cell: stamp drawn in the picture (STAMP_NONE = none)
+    uint32_t* seen_counts;              // Our copies of the snapshot's counters (groups, then blocks)
+    uint32_t* counts;                   // The counters read by the current pass
+    int* changed;                       // Indices of the counters that moved in it
+    int full_scan;                      // 1 until the whole picture has been drawn
+    long frames;                        // Frames written
+    char path[TRACE_PATH_MAX];
+} FrameRecorder;
+
+/* The open recording; only the monitor (in the coordinating process) uses it */
+static FrameRecorder* g_frames = NULL;
+
+/* Colours of apes_viewer */
+static const float family_colors[FRAME_COLORS][3] = {
+    {1.0f, 0.3f, 0.3f},   /* Red */
+    {0.3f, 1.0f, 0.3f},   /* Green */
+    {0.3f, 0.5f, 1.0f},   /* Blue */
+    {1.0f, 0.6f, 0.1f},   /* Orange */
+    {0.8f, 0.3f, 1.0f},   /* Purple */
+    {0.1f, 0.9f, 0.9f},   /* Cyan */
+};
+static const float maze_bg[3] = {0.15f, 0.18f, 0.15f};
+static const float exit_bg[3] = {0.2f, 0.4f, 0.2f};
+static const float grid[3] = {0.3f, 0.35f, 0.3f};
+static const float rock[3] = {0.4f, 0.4f, 0.45f};
+static const float highlight[3] = {0.5f, 0.5f, 0.55f};
+static const float shadow[3] = {0.3f, 0.3f, 0.35f};
+static const float yellow[3] = {1.0f, 0.9f, 0.0f};
+static const float brown[3] = {0.5f, 0.3f, 0.0f};
+
+/* ==================== Rasteriser ==================== */
+
+/*
+ * Shapes are drawn into an RGB tile of size x size pixels, in pixel units
+ * with y up as in the viewer; a pixel is covered when its centre is inside
+ */
+
+static void put_pixel(unsigned char* tile, int size, int px, int py, const float* color) {
+    unsigned char* p = tile + ((size_t)(size - 1 - py) * size + px) * 3;
+    
+    p[0] = (unsigned char)(color[0] * 255.0f + 0.5f);
+    p[1] = (unsigned char)(color[1] * 255.0f + 0.5f);
+    p[2] = (unsigned char)(color[2] * 255.0f + 0.5f);
+}
+
+static void fill_rect(unsigned char* tile, int size, float x, float y, float w, float h,
+                      const float* color) {
+    for (int py = 0; py < size; py++) {
+        float cy = py + 0.5f;
+    
+        if (cy < y || cy >= y + h) continue;
+        for (int px = 0; px < size; px++) {
+            float cx = px + 0.5f;
+    
+            if (cx >= x && cx < x + w) put_pixel(tile, size, px, py, color);
+        }
+    }
+}
+
+static float edge(float ax, float ay, float bx, float by, float px, float py) {
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+static void fill_triangle(unsigned char* tile, int size, float x0, float y0, float x1, float y1,
+                          float x2, float y2, const float* color) {
+    for (int py = 0; py < size; py++) {
+        for (int px = 0; px < size; px++) {
+            float cx = px + 0.5f, cy = py + 0.5f;
+            float e0 = edge(x0, y0, x1, y1, cx, cy);
+            float e1 = edge(x1, y1, x2, y2, cx, cy);
+            float e2 = edge(x2, y2, x0, y0, cx, cy);
+    
+            /* Either winding */
+            if ((e0 >= 0 && e1 >= 0 && e2 >= 0) || (e0 <= 0 && e1 <= 0 && e2 <= 0)) {
+                put_pixel(tile, size, px, py, color);
+            }
+        }
+    }
+}
+
+static void fill_disc(unsigned char* tile, int size, float x, float y, float r, const float* color) {
+    for (int py = 0; py < size; py++) {
+        for (int px = 0; px < size; px++) {
+            float dx = px + 0.5f - x, dy = py + 0.5f - y;
+    
+            if (dx * dx + dy * dy <= r * r) put_pixel(tile, size, px, py, color);
+        }
+    }
+}
+
+/* Banana in the s x s square at (x, y): curved body and stem (viewer: put_banana) */
+static void draw_banana(unsigned char* tile, int size, float x, float y, float s) {
+    float r = s * 0.4f;
+    float cx = x + s * 0.3f;
+    float cy = y + s * 0.5f;
+    float px0 = cx + r * cosf(-0.35f), py0 = cy + r * sinf(-0.35f) * 0.5f;
+    
+    for (int i = 1; i < 10; i++) {
+        float a1 = (float)i / 10 * 3.14159f * 0.7f - 0.35f;
+        float a2 = (float)(i + 1) / 10 * 3.14159f * 0.7f - 0.35f;
+    
+        fill_triangle(tile, size, px0, py0, cx + r * cosf(a1), cy + r * sinf(a1) * 0.5f,
+                      cx + r * cosf(a2), cy + r * sinf(a2) * 0.5f, yellow);
+    }
+    fill_rect(tile, size, x + s * 0.1f, y + s * 0.45f, s * 0.15f, 1.0f, brown);
+}
+
+/* Monkey filling the cell in a family colour (viewer: put_monkey) */
+static void draw_monkey(unsigned char* tile, int size, const float* color) {
+    const float body[3] = {color[0] * 0.7f, color[1] * 0.5f, color[2] * 0.3f};
+    const float head[3] = {color[0] * 0.8f, color[1] * 0.6f, color[2] * 0.4f};
+    const float face[3] = {0.9f, 0.8f, 0.7f};
+    const float eyes[3] = {0.0f, 0.0f, 0.0f};
+    const float ears[3] = {color[0] * 0.6f, color[1] * 0.4f, color[2] * 0.3f};
+    float s = (float)size;
+    
+    fill_disc(tile, size, 0.5f * s, 0.4f * s, 0.35f * s, body);
+    fill_disc(tile, size, 0.5f * s, 0.75f * s, 0.25f * s, head);
+    fill_disc(tile, size, 0.5f * s, 0.7f * s, 0.15f * s, face);
+    fill_disc(tile, size, 0.42f * s, 0.78f * s, 0.05f * s, eyes);
+    fill_disc(tile, size, 0.58f * s, 0.78f * s, 0.05f * s, eyes);
+    fill_disc(tile, size, 0.25f * s, 0.8f * s, 0.1f * s, ears);
+    fill_disc(tile, size, 0.75f * s, 0.8f * s, 0.1f * s, ears);
+}
+
+/*
+ * One cell as the viewer draws it at this cell size: floor, then the
+ * rock, banana or ape, then the grid lines along its top and left
+ */
+static void draw_stamp(unsigned char* tile, int size, int exit_row, int kind) {
+    float s = (float)size;
+    
+    fill_rect(tile, size, 0.0f, 0.0f, s, s, exit_row ? exit_bg : maze_bg);
+    
+    if (kind == STAMP_ROCK) {
+        if (size >= FRAME_DETAIL_MIN) {
+            fill_rect(tile, size, 2.0f, 2.0f, s - 4.0f, s - 4.0f, rock);
+            fill_triangle(tile, size, 2.0f, s - 2.0f, 2.0f, 2.0f, s - 2.0f, 2.0f, highlight);
+            fill_triangle(tile, size, s - 2.0f, 2.0f, s - 2.0f, s - 2.0f, 2.0f, s - 2.0f, shadow);
+        } else {
+            fill_rect(tile, size, 0.0f, 0.0f, s, s, rock);
+        }
+    } else if (kind == STAMP_BANANA) {
+        if (size >= FRAME_DETAIL_MIN) {
+            draw_banana(tile, size, s * 0.2f, s * 0.2f, s * 0.6f);
+        } else {
+            /* A dot 0.6 of the cell wide, at least one pixel */
+            float w = s * 0.6f > 1.0f ? s * 0.6f : 1.0f;
+    
+            fill_rect(tile, size, (s - w) * 0.5f, (s - w) * 0.5f, w, w, yellow);
+        }
+    } else if (kind >= STAMP_APE) {
+        draw_monkey(tile, size, family_colors[kind - STAMP_APE]);
+    }
+    
+    if (size >= FRAME_GRID_MIN) {
+        fill_rect(tile, size, 0.0f, s - 1.0f, s, 1.0f, grid);
+        fill_rect(tile, size, 0.0f, 0.0f, 1.0f, s, grid);
+    }
+}
+
+/*
+ * Render every stamp in the output colour space: interleaved RGB, or for
+ * Y4M the Y, U and V planes of the tile one after another (BT.601)
+ * Returns 0 on success, -1 if out of memory
+ */
+static int build_stamps(FrameRecorder* rec) {
+    size_t area = (size_t)rec->cell * rec->cell;
+    unsigned char* tile = (unsigned char*)malloc(area * 3);
+    
+    if (tile == NULL) return -1;
+    
+    for (int s = 0; s < 2 * STAMP_KINDS; s++) {
+        unsigned char* stamp = rec->stamps + (size_t)s * area * 3;
+    
+        draw_stamp(tile, rec->cell, s >= STAMP_KINDS, s % STAMP_KINDS);
+        if (rec->format != FRAME_FORMAT_Y4M) {
+            memcpy(stamp, tile, area * 3);
+            continue;
+        }
+        for (size_t i = 0; i < area; i++) {
+            int r = tile[i * 3], g = tile[i * 3 + 1], b = tile[i * 3 + 2];
+    
+            stamp[i] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            stamp[area + i] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            stamp[2 * area + i] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    
+    free(tile);
+    return 0;
+}
+
+/* ==================== Picture ==================== */
+
+/*
+ * Stamp a cell shows in the snapshot: the same precedence as the viewer,
+ * where an ape covers the banana under it
+ */
+static int cell_stamp(const SharedData* shared, int row, int col) {
+    const SnapshotCell* cell = snapshot_cell(shared, row, col);
+    int ape = cell->ape;
+    int kind = STAMP_FLOOR;
+    
+    if (maze_cell(shared, row, col)->is_obstacle) {
+        kind = STAMP_ROCK;
+    } else if (ape >= 0) {
+        kind = STAMP_APE + ape % FRAME_COLORS;
+    } else if (cell->bananas > 0) {
+        kind = STAMP_BANANA;
+    }
+    return (row == 0 ? STAMP_KINDS : 0) + kind;
+}
+
+/*
+ * Copy a stamp into the picture at (row, col)
+ */
+static void blit_stamp(FrameRecorder* rec, int row, int col, int stamp_index) {
+    size_t area = (size_t)rec->cell * rec->cell;
+    const unsigned char* stamp = rec->stamps + (size_t)stamp_index * area * 3;
+    unsigned char* picture = rec->buffer + rec->header_len;
+    size_t x = (size_t)col * rec->cell;
+    size_t y = (size_t)row * rec->cell;
+    
+    if (rec->format == FRAME_FORMAT_Y4M) {
+        size_t plane = (size_t)rec->width * rec->height;
+    
+        for (int p = 0; p < 3; p++) {
+            for (int i = 0; i < rec->cell; i++) {
+                memcpy(picture + p * plane + (y + i) * rec->width + x,
+                       stamp + p * area + (size_t)i * rec->cell, rec->cell);
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < rec->cell; i++) {
+        memcpy(picture + ((y + i) * rec->width + x) * 3, stamp + (size_t)i * rec->cell * 3,
+               (size_t)rec->cell * 3);
+    }
+}
+
+/*
+ * Redraw the cells [first, last) whose stamp changed
+ */
+static void redraw_cells(FrameRecorder* rec, const SharedData* shared, int first, int last) {
+    for (int c = first; c < last; c++) {
+        int row = c / rec->cols, col = c % rec->cols;
+        int stamp_index = cell_stamp(shared, row, col);
+    
+        if (stamp_index == rec->kinds[c]) continue;
+        rec->kinds[c] = (uint8_t)stamp_index;
+        blit_stamp(rec, row, col, stamp_index);
+    }
+}
+
+/*
+ * Bring the picture up to the snapshot: everything the first time,
+ * afterwards only the blocks whose snapshot counter moved (as apes_viewer
+ * does). A pass a publish overlapped is done again; its counters are only
+ * taken over once one is not, and a cell redrawn from a torn read is
+ * redrawn again then.
+ */
+static void update_picture(FrameRecorder* rec, const SharedData* shared) {
+    int num_cells = rec->rows * rec->cols;
+    int groups = change_groups(shared);
+    uint32_t seq;
+    int n;
+    
+    do {
+        seq = snapshot_read_begin(shared);
+        n = snapshot_changed_counts(shared, rec->seen_counts, rec->counts, rec->changed,
+                                    rec->full_scan);
+        for (int i = 0; i < n; i++) {
+            int b = rec->changed[i] - groups;
+            int last_cell = (b + 1) << CHANGE_BLOCK_SHIFT;
+    
+            if (b < 0) continue;  /* A group: its blocks follow */
+            redraw_cells(rec, shared, b << CHANGE_BLOCK_SHIFT, last_cell < num_cells ? last_cell : num_cells);
+        }
+    } while (snapshot_read_retry(shared, seq));
+    
+    snapshot_commit_counts(rec->seen_counts, rec->counts, rec->changed, n);
+    rec->full_scan = 0;
+}
+
+/* ==================== Output ==================== */
+
+static int write_all(int fd, const void* data, size_t len) {
+    const char* bytes = (const char*)data;
+    
+    while (len > 0) {
+        ssize_t written = write(fd, bytes, len);
+    
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        bytes += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+/*
+ * Recording time: simulated under virtual time, else wall time since
+ * frames_open()
+ */
+static long long recorder_now_ms(const FrameRecorder* rec, const SharedData* shared) {
+    struct timespec now;
+    
+    if (shared->clock.mode == TIME_MODE_VIRTUAL) {
+        return __atomic_load_n(&shared->clock.now_ms, __ATOMIC_ACQUIRE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)(now.tv_sec - rec->start.tv_sec) * 1000 +
+           (now.tv_nsec - rec->start.tv_nsec) / 1000000;
+}
+
+static void free_recorder(FrameRecorder* rec) {
+    if (rec->fd >= 0) close(rec->fd);
+    free(rec->stamps);
+    free(rec->buffer);
+    free(rec->kinds);
+    free(rec->seen_counts);
+    free(rec->counts);
+    free(rec->changed);
+    free(rec);
+}
+
+/* ==================== Public API ==================== */
+
+int frames_open(const char* path, int format, int interval_ms, int cell_pixels,
+                const SharedData* shared) {
+    FrameRecorder* rec;
+    size_t pixels = (size_t)shared->maze_rows * shared->maze_cols * cell_pixels * cell_pixels;
+    size_t num_cells = (size_t)shared->maze_rows * shared->maze_cols;
+    size_t num_counts = (size_t)(change_groups(shared) + change_blocks(shared));
+    char header[64];
+    
+    if (g_frames != NULL) frames_close();
+    
+    if (pixels * 3 > FRAME_MAX_BYTES) {
+        fprintf(stderr, "Frames of %dx%d cells at %d pixels are too large, lower frame_cell_pixels\n",
+                shared->maze_cols, shared->maze_rows, cell_pixels);
+        return -1;
+    }
+    
+    rec = (FrameRecorder*)calloc(1, sizeof(FrameRecorder));
+    if (rec == NULL) {
+        fprintf(stderr, "Failed to allocate frame recorder\n");
+        return -1;
+    }
+    rec->fd = -1;
+    rec->format = format;
+    rec->interval_ms = interval_ms;
+    rec->cell = cell_pixels;
+    rec->rows = shared->maze_rows;
+    rec->cols = shared->maze_cols;
+    rec->width = rec->cols * cell_pixels;
+    rec->height = rec->rows * cell_pixels;
+    rec->next_ms = -1;
+    rec->full_scan = 1;
+    safe_strcpy(rec->path, path, sizeof(rec->path));
+    
+    /* Per-frame header */
+    if (format == FRAME_FORMAT_PPM) {
+        rec->header_len = (size_t)snprintf(header, sizeof(header), "P6\n%d %d\n255\n",
+                                           rec->width, rec->height);
+    } else if (format == FRAME_FORMAT_Y4M) {
+        rec->header_len = (size_t)snprintf(header, sizeof(header), "FRAME\n");
+    }
+    rec->frame_len = rec->header_len + pixels * 3;
+    
+    rec->stamps = (unsigned char*)malloc((size_t)2 * STAMP_KINDS * cell_pixels * cell_pixels * 3);
+    rec->buffer = (unsigned char*)malloc(rec->frame_len);
+    rec->kinds = (uint8_t*)malloc(num_cells);
+    rec->seen_counts = (uint32_t*)malloc(sizeof(uint32_t) * num_counts);
+    rec->counts = (uint32_t*)malloc(sizeof(uint32_t) * num_counts);
+    rec->changed = (int*)malloc(sizeof(int) * num_counts);
+    if (rec->stamps == NULL || rec->buffer == NULL || rec->kinds == NULL ||
+        rec->seen_counts == NULL || rec->counts == NULL || rec->changed == NULL ||
+        build_stamps(rec) != 0) {
+        fprintf(stderr, "Failed to allocate %zu bytes of frame buffers\n", rec->frame_len);
+        free_recorder(rec);
+        return -1;
+    }
+    memcpy(rec->buffer, header, rec->header_len);
+    memset(rec->kinds, STAMP_NONE, num_cells);
+    
+    rec->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (rec->fd < 0) {
+        perror("Failed to create frame file");
+        free_recorder(rec);
+        return -1;
+    }
+    
+    /* Y4M stream header: playback at the recording's pace */
+    if (format == FRAME_FORMAT_Y4M) {
+        int len = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F1000:%d Ip A1:1 C444\n",
+                           rec->width, rec->height, interval_ms);
+    
+        if (write_all(rec->fd, header, (size_t)len) != 0) {
+            perror("Failed to write frame file");
+            free_recorder(rec);
+            return -1;
+        }
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &rec->start);
+    g_frames = rec;
+    
+    log_event("Recording %s frames (%dx%d, every %d ms) to %s", frame_format_name(format),
+              rec->width, rec->height, interval_ms, path);
+    return 0;
+}
+
+void frames_capture(const SharedData* shared) {
+    FrameRecorder* rec = g_frames;
+    long long now;
+    
+    if (rec == NULL) return;
+    
+    now = recorder_now_ms(rec, shared);
+    if (rec->next_ms < 0) rec->next_ms = now;  /* First frame: the state right now */
+    if (now < rec->next_ms) return;
+    
+    update_picture(rec, shared);
+    
+    /* One frame per interval, so playback keeps the run's pace even when
+     * the caller was late */
+    while (rec->next_ms <= now) {
+        if (write_all(rec->fd, rec->buffer, rec->frame_len) != 0) {
+            perror("Failed to write frame, recording stopped");
+            frames_close();
+            return;
+        }
+        rec->frames++;
+        rec->next_ms += rec->interval_ms;
+    }
+}
+
+long frames_due_in_ms(const SharedData* shared) {
+    const FrameRecorder* rec = g_frames;
+    long long now;
+    
+    if (rec == NULL) return -1;
+    if (rec->next_ms < 0) return 0;
+    
+    now = recorder_now_ms(rec, shared);
+    return rec->next_ms > now ? (long)(rec->next_ms - now) : 0;
+}
+
+void frames_close(void) {
+    if (g_frames == NULL) return;
+    
+    log_event("Recorded %ld frames to %s", g_frames->frames, g_frames->path);
+    free_recorder(g_frames);
+    g_frames = NULL;
+}
+
+const char* frame_format_name(int format) {
+    switch (format) {
+        case FRAME_FORMAT_PPM: return "ppm";
+        case FRAME_FORMAT_Y4M: return "y4m";
+        case FRAME_FORMAT_RAW: return "raw";
+        default: return "unknown";
+    }
+}
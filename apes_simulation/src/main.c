@@ -1,163 +1,92 @@
 #include "local.h"
 
+/* Full repaint interval of the live display (ms) */
+#define DISPLAY_REPAINT_MS 5000
+
 /* Global variables for signal handling */
-static int shm_id = -1;
+static Simulation sim;
 static SharedData* shared = NULL;
-static pid_t* child_pids = NULL;
-static int num_children = 0;
 
 void signal_handler(int sig) { //  Signal handler for cleanup on Ctrl+C
 
-    int i;
-    
     printf("\n\nReceived signal %d, cleaning up...\n", sig);
     
-    /* Stop simulation */
-    if (shared != NULL) {
-        shared->simulation_running = 0;
-    }
-    
-    /* Kill child processes */
-    for (i = 0; i < num_children; i++) {
-        if (child_pids[i] > 0) {
-            kill(child_pids[i], SIGTERM);
-        }
-    }
+    /* Stop simulation and kill child processes */
+    stop_simulation(&sim);
     
-    /* Wait for children */
-    for (i = 0; i < num_children; i++) {
-        if (child_pids[i] > 0) {
-            waitpid(child_pids[i], NULL, 0);
-        }
-    }
-    
-    /* Cleanup shared memory */
-    if (shared != NULL) {
-        cleanup_maze(shared);
-        
-        /* Cleanup semaphores using wrapper */
-        cleanup_simulation_semaphores(shared->num_families, shared->maze_rows, shared->maze_cols);
-        
-        /* Cleanup event lock */
-        sem_destroy(&shared->event_lock);
-        
-        detach_shared_memory(shared);
-    }
-    
-    if (shm_id >= 0) {
-        destroy_shared_memory(shm_id);
-    }
-    
-    if (child_pids != NULL) {
-        free(child_pids);
-    }
+    /* Cleanup shared memory and keep a partial recording readable */
+    cleanup_simulation(&sim);
+    replay_close();
     
     printf("Cleanup complete. Exiting.\n");
     exit(0);
 }
 
-int init_shared_data(const SimConfig* config) {
-    int i;
-    
-    /* Create shared memory */
-    shm_id = create_shared_memory(sizeof(SharedData), SHM_KEY);
-    if (shm_id < 0) {
-        fprintf(stderr, "Failed to create shared memory\n");
-        return -1;
-    }
-    
-    /* Attach shared memory */
-    shared = (SharedData*)attach_shared_memory(shm_id);
-    if (shared == NULL) {
-        fprintf(stderr, "Failed to attach shared memory\n");
-        destroy_shared_memory(shm_id);
-        return -1;
-    }
-    
-    /* Initialize shared data */
-    memset(shared, 0, sizeof(SharedData));
-    
-    shared->num_families = config->num_families;
-    shared->withdrawn_count = 0;
-    shared->simulation_running = 1;
-    shared->termination_reason = TERM_RUNNING;
-    shared->winning_family = -1;
-    shared->start_time = 0;  /* Will be set when simulation actually starts */
-    
-    /* Initialize semaphores using cross-platform wrapper */
-    if (init_simulation_semaphores(shared, config->num_families,  
-                                    config->maze_rows, config->maze_cols) != 0) {
-        fprintf(stderr, "Failed to initialize semaphores\\n");
-        return -1;
-    }
-    
-    /* Initialize event buffer */
-    shared->event_head = 0;
-    memset(shared->recent_events, 0, sizeof(shared->recent_events));
-    if (sem_init(&shared->event_lock, 1, 1) != 0) {
-        fprintf(stderr, "Failed to initialize event lock\n");
-        return -1;
-    }
-    
-    /* Initialize family status */
-    for (i = 0; i < MAX_FAMILIES; i++) {
-        shared->families[i].is_active = 0;
-        shared->families[i].basket_bananas = 0;
-        shared->families[i].male_fighting = 0;
-    }
-    
-    log_event("Shared memory initialized (ID: %d)", shm_id);
-    
-    return 0;
-}
-void* monitor_thread(void* arg) {
-    const SimConfig* config = (const SimConfig*)arg;
-    
-    while (shared->simulation_running) {
-        /* Check timeout */
-        double elapsed = get_elapsed_seconds(shared->start_time);
-        
-        if (elapsed >= config->max_simulation_time_seconds) {
-            sem_wait(&shared->global_lock);
-            if (shared->simulation_running) {
-                shared->simulation_running = 0;
-                shared->termination_reason = TERM_TIMEOUT;
-                log_event("TIMEOUT! Simulation time exceeded %d seconds", 
-                         config->max_simulation_time_seconds);
-            }
-            sem_post(&shared->global_lock);
-            break;
-        }
-        
-        sleep_ms(500);  /* Check every 500ms */
+/*
+ * SIGUSR1: write a checkpoint at the next quiescent tick (virtual time)
+ */
+void checkpoint_handler(int sig) {
+    (void)sig;
+    if (shared != NULL) {
+        __atomic_store_n(&shared->checkpoint_pending, 1, __ATOMIC_RELEASE);
     }
-    
-    return NULL;
 }
 
+/*
+ * Live terminal display: each frame is a consistent copy of the published
+ * snapshot, composed off screen; only the cells that changed since the
+ * last one are sent, in one write()
+ */
 void* display_thread(void* arg) {
     const SimConfig* config = (const SimConfig*)arg;
+    Screen* screen = screen_create(STDOUT_FILENO);
+    int frames_per_repaint = DISPLAY_REPAINT_MS / config->display_refresh_ms;
+    size_t num_cells = (size_t)shared->maze_rows * (size_t)shared->maze_cols;
+    FamilyStatus* families = (FamilyStatus*)malloc(sizeof(FamilyStatus) * (size_t)shared->num_families);
+    SnapshotCell* cells = (SnapshotCell*)malloc(sizeof(SnapshotCell) * num_cells);
+    Snapshot status;
+    uint32_t seq;
+    int frame = 0;
     int i;
     
+    if (screen == NULL || families == NULL || cells == NULL) {
+        fprintf(stderr, "Failed to allocate the display frame\n");
+        screen_destroy(screen);
+        free(families);
+        free(cells);
+        return NULL;
+    }
+    
     while (shared->simulation_running) {
-        /* Move cursor to home and clear screen */
-        printf("\033[H\033[J");
+        /* Log lines written meanwhile may have scrolled the terminal */
+        if (frames_per_repaint > 0 && frame++ % frames_per_repaint == 0) {
+            screen_invalidate(screen);
+        }
         
-        double elapsed = get_elapsed_seconds(shared->start_time);
+        /* Copy the snapshot; a publish that overlaps the copy sends us
+         * round again, never the simulation */
+        do {
+            seq = snapshot_read_begin(shared);
+            memcpy(&status, &shared->snapshot, sizeof(Snapshot));
+            memcpy(families, snapshot_family(shared, 0), sizeof(FamilyStatus) * (size_t)shared->num_families);
+            memcpy(cells, snapshot_cell(shared, 0, 0), sizeof(SnapshotCell) * num_cells);
+        } while (snapshot_read_retry(shared, seq));
+        
+        screen_begin(screen);
         
         /* Header */
-        printf("================================================================================\n");
-        printf("  APES SIMULATION | Time: %.0fs/%ds | Bananas in maze: %d | Withdrawn: %d/%d\n",
-               elapsed, config->max_simulation_time_seconds,
-               shared->total_bananas_in_maze,
-               shared->withdrawn_count, config->max_withdrawn_families);
-        printf("================================================================================\n\n");
+        screen_printf(screen, SCREEN_PLAIN, "================================================================================\n");
+        screen_printf(screen, SCREEN_PLAIN, "  APES SIMULATION | Time: %.0fs/%ds | Bananas in maze: %d | Withdrawn: %d/%d\n",
+                      status.elapsed_ms / 1000.0, config->max_simulation_time_seconds,
+                      status.total_bananas_in_maze,
+                      status.withdrawn_count, config->max_withdrawn_families);
+        screen_printf(screen, SCREEN_PLAIN, "================================================================================\n\n");
         
         /* Family status - ALL families */
-        printf("FAMILY STATUS:\n");
-        printf("------------------------------------------------------------------------------\n");
+        screen_printf(screen, SCREEN_PLAIN, "FAMILY STATUS:\n");
+        screen_printf(screen, SCREEN_PLAIN, "------------------------------------------------------------------------------\n");
         for (i = 0; i < shared->num_families; i++) {
-            FamilyStatus* f = &shared->families[i];
+            const FamilyStatus* f = &families[i];
             
             /* Build status string */
             char status[32] = "";
@@ -193,43 +122,48 @@ void* display_thread(void* arg) {
             }
             
             /* Print ALL info for every family */
-            printf("[Family %d] %-15s | Basket: %2d | M:%3d F:%3d | %s\n",
-                   i, status, f->basket_bananas, f->male_energy, f->female_energy, female_loc);
+            screen_printf(screen, SCREEN_PLAIN, "[Family %d] %-15s | Basket: %2d | M:%3d F:%3d | %s\n",
+                          i, status, f->basket_bananas, f->male_energy, f->female_energy, female_loc);
         }
-        printf("------------------------------------------------------------------------------\n");
+        screen_printf(screen, SCREEN_PLAIN, "------------------------------------------------------------------------------\n");
         
         /* Show maze */
-        printf("\nMAZE (Row 0=Exit, Row %d=Entry):\n", config->maze_rows - 1);
-        print_maze_compact(shared);
+        screen_printf(screen, SCREEN_PLAIN, "\nMAZE (Row 0=Exit, Row %d=Entry):\n", config->maze_rows - 1);
+        draw_maze_compact(screen, shared, cells);
         
         /* Show recent events */
-        printf("\nRECENT EVENTS:\n");
-        printf("------------------------------------------------------------------------------\n");
+        screen_printf(screen, SCREEN_PLAIN, "\nRECENT EVENTS:\n");
+        screen_printf(screen, SCREEN_PLAIN, "------------------------------------------------------------------------------\n");
         
-        sem_wait(&shared->event_lock);
+        /* Newest MAX_EVENTS tickets; producers never wait for this reader */
+        uint64_t event_end = __atomic_load_n(&shared->event_next, __ATOMIC_ACQUIRE);
+        uint64_t ticket = (event_end > MAX_EVENTS) ? event_end - MAX_EVENTS : 0;
         int event_count = 0;
-        for (i = 0; i < MAX_EVENTS; i++) {
-            int idx = (shared->event_head + i) % MAX_EVENTS;
-            EventEntry* e = &shared->recent_events[idx];
+        for (; ticket < event_end; ticket++) {
+            EventEntry e;
             
-            if (e->message[0] != '\0') {
-                printf("[t=%5.1fs] %s\n", e->timestamp, e->message);
+            if (read_shared_event(shared, ticket, &e)) {
+                screen_printf(screen, SCREEN_PLAIN, "[t=%5.1fs] %s\n", e.timestamp, e.message);
                 event_count++;
             }
         }
-        sem_post(&shared->event_lock);
         
         if (event_count == 0) {
-            printf("(No events yet)\n");
+            screen_printf(screen, SCREEN_PLAIN, "(No events yet)\n");
+        } else {
+            screen_printf(screen, SCREEN_PLAIN, "(%llu events total)\n", (unsigned long long)event_end);
         }
-        printf("------------------------------------------------------------------------------\n");
+        screen_printf(screen, SCREEN_PLAIN, "------------------------------------------------------------------------------\n");
         
-        printf("\nPress Ctrl+C to stop simulation\n");
+        screen_printf(screen, SCREEN_PLAIN, "\nPress Ctrl+C to stop simulation\n");
         
-        fflush(stdout);
-        sleep_ms(1000);  /* Update display every 1 second */
+        screen_flush(screen);
+        sleep_ms(config->display_refresh_ms);
     }
     
+    screen_destroy(screen);
+    free(families);
+    free(cells);
     return NULL;
 }
 
@@ -269,7 +203,7 @@ void print_final_results(const SimConfig* config) {
             printf("Unknown                                               ║\n");
     }
     
-    double elapsed = get_elapsed_seconds(shared->start_time);
+    double elapsed = simulation_duration_seconds(shared);
     printf("║ Duration: %.1f seconds                                        ║\n", elapsed);
     
     printf("╠════════════════════════════════════════════════════════════════╣\n");
@@ -278,11 +212,11 @@ void print_final_results(const SimConfig* config) {
     
     /* Detailed per-family statistics */
     for (i = 0; i < shared->num_families; i++) {
-        FamilyStatus* f = &shared->families[i];
+        FamilyStatus* f = family_status(shared, i);
         int family_eaten = 0;
         
         for (j = 0; j < config->babies_per_family; j++) {
-            family_eaten += f->baby_bananas_eaten[j];
+            family_eaten += baby_bananas_eaten(shared, i)[j];
         }
         
         total_in_baskets += f->basket_bananas;
@@ -305,7 +239,7 @@ void print_final_results(const SimConfig* config) {
         
         for (j = 0; j < config->babies_per_family; j++) {
             printf("║     - Baby %d ate: %2d                                           ║\n",
-                   j, f->baby_bananas_eaten[j]);
+                   j, baby_bananas_eaten(shared, i)[j]);
         }
         
         /* Show basket calculation - CORRECT EQUATION */
@@ -388,10 +322,10 @@ void print_final_results(const SimConfig* config) {
         fprintf(log, "================================================================================\n");
         
         for (i = 0; i < shared->num_families; i++) {
-            FamilyStatus* f = &shared->families[i];
+            FamilyStatus* f = family_status(shared, i);
             int family_eaten = 0;
             for (j = 0; j < config->babies_per_family; j++) {
-                family_eaten += f->baby_bananas_eaten[j];
+                family_eaten += baby_bananas_eaten(shared, i)[j];
             }
             fprintf(log, "\nFamily %d (%s):\n", i, f->is_active ? "Active" : "Withdrawn");
             fprintf(log, "  COLLECTED (ways family gained bananas):\n");
@@ -405,7 +339,7 @@ void print_final_results(const SimConfig* config) {
             fprintf(log, "    In basket:        %3d  <- Bananas saved in family basket\n", f->basket_bananas);
             fprintf(log, "    Eaten by babies:  %3d  <- Bananas consumed by babies (removed from game)\n", family_eaten);
             for (j = 0; j < config->babies_per_family; j++) {
-                fprintf(log, "      Baby %d ate: %2d\n", j, f->baby_bananas_eaten[j]);
+                fprintf(log, "      Baby %d ate: %2d\n", j, baby_bananas_eaten(shared, i)[j]);
             }
             
             /* Calculate and explain the basket value - CORRECT EQUATION WITH FEMALE FIGHTS */
@@ -472,53 +406,157 @@ void print_final_results(const SimConfig* config) {
 int main(int argc, char* argv[]) {
     SimConfig* config;
     const char* config_file = "simulation.conf";
-    pthread_t monitor_tid, display_tid;
+    int time_mode = TIME_MODE_REAL;
+    char shm_name[SHM_NAME_LEN];
+    const char* record_file = NULL;
+    const char* replay_file = NULL;
+    const char* checkpoint_file = "simulation.ckpt";
+    const char* restore_file = NULL;
+    double checkpoint_at = -1.0;
+    int time_mode_given = 0;
+    CheckpointHeader checkpoint;
+    SimResult result;
+    pthread_t display_tid;
+    int status = 0;
     int i;
-    
+
     printf("\n=== APES COLLECTING BANANAS SIMULATION ===\n\n");
     
-    /* Parse command line arguments */
-    if (argc > 1) {
-        config_file = argv[1];
+    /* Each run gets its own segment name unless one is given */
+    snprintf(shm_name, sizeof(shm_name), SHM_NAME_PREFIX "%d", (int)getpid());
+    
+    /* Parse command line arguments:
+     * [config_file] [--time-mode=real|virtual|deterministic] [--shm-name=NAME]
+     * [--record=FILE | --replay=FILE] [--checkpoint=FILE] [--checkpoint-at=SECONDS]
+     * [--restore=FILE] */
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--time-mode=", 12) == 0) {
+            time_mode = parse_time_mode(argv[i] + 12);
+            if (time_mode < 0) {
+                fprintf(stderr, "Unknown time mode '%s' (expected real, virtual or deterministic)\n",
+                        argv[i] + 12);
+                return 1;
+            }
+            time_mode_given = 1;
+        } else if (strncmp(argv[i], "--record=", 9) == 0) {
+            record_file = argv[i] + 9;
+        } else if (strncmp(argv[i], "--replay=", 9) == 0) {
+            replay_file = argv[i] + 9;
+        } else if (strncmp(argv[i], "--checkpoint=", 13) == 0) {
+            checkpoint_file = argv[i] + 13;
+        } else if (strncmp(argv[i], "--checkpoint-at=", 16) == 0) {
+            checkpoint_at = atof(argv[i] + 16);
+        } else if (strncmp(argv[i], "--restore=", 10) == 0) {
+            restore_file = argv[i] + 10;
+        } else if (strncmp(argv[i], "--shm-name=", 11) == 0) {
+            const char* name = argv[i] + 11;
+            
+            /* POSIX shm names start with a single slash */
+            snprintf(shm_name, sizeof(shm_name), "%s%s", name[0] == '/' ? "" : "/", name);
+        } else {
+            config_file = argv[i];
+        }
+    }
+    
+    if (record_file != NULL && replay_file != NULL) {
+        fprintf(stderr, "--record and --replay cannot be combined\n");
+        return 1;
+    }
+    if (restore_file != NULL && (record_file != NULL || replay_file != NULL)) {
+        fprintf(stderr, "--restore cannot be combined with --record or --replay\n");
+        return 1;
+    }
+    if (strlen(checkpoint_file) >= CHECKPOINT_PATH_MAX) {
+        fprintf(stderr, "Checkpoint path too long (max %d characters)\n", CHECKPOINT_PATH_MAX - 1);
+        return 1;
     }
     
-    /* Load configuration */
-    config = load_config(config_file);
+    /* Load configuration (a replay uses the one embedded in the recording) */
+    if (replay_file != NULL) {
+        config = replay_load(replay_file);
+    } else {
+        config = load_config(config_file);
+    }
     if (config == NULL) {
-        fprintf(stderr, "Failed to load configuration from: %s\n", config_file);
+        fprintf(stderr, "Failed to load configuration from: %s\n",
+                replay_file != NULL ? replay_file : config_file);
         return 1;
     }
     
-    /* Initialize random seed */
-    init_random();
+    /* Record and replay need the reproducible schedule */
+    if (record_file != NULL || replay_file != NULL) {
+        time_mode = TIME_MODE_DETERMINISTIC;
+    }
+    
+    /* A restore keeps the checkpoint's seed and time mode unless overridden;
+     * a different seed= branches the run with fresh random streams */
+    if (restore_file != NULL) {
+        if (checkpoint_read_header(restore_file, &checkpoint) != 0) {
+            free_config(config);
+            return 1;
+        }
+        if (config->seed == 0) config->seed = checkpoint.seed;
+        if (!time_mode_given) time_mode = checkpoint.time_mode;
+    }
+    
+    /* Pooled apes are steps handed out by the virtual clock */
+    if (config->execution_mode == EXEC_MODE_POOL && time_mode == TIME_MODE_REAL) {
+        fprintf(stderr, "Note: execution_mode=pool runs under virtual time\n");
+        time_mode = TIME_MODE_VIRTUAL;
+    }
+    
+    /* Checkpoints are taken at a tick where every actor is parked */
+    if (checkpoint_at >= 0 && time_mode == TIME_MODE_REAL) {
+        fprintf(stderr, "--checkpoint-at needs --time-mode=virtual or deterministic\n");
+        free_config(config);
+        return 1;
+    }
+    if (record_file != NULL && replay_record_open(record_file, config_file,
+                                                  (uint64_t)config->record_max_records) != 0) {
+        free_config(config);
+        return 1;
+    }
     
     /* Set up signal handler */
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, time_mode == TIME_MODE_REAL ? SIG_IGN : checkpoint_handler);
     
-    /* Initialize shared memory */
-    if (init_shared_data(config) != 0) {
+    /* Initialize shared memory, locks and maze */
+    if (init_simulation(&sim, config, time_mode, shm_name) != 0) {
         fprintf(stderr, "Failed to initialize shared data\n");
+        cleanup_simulation(&sim);
         free_config(config);
         return 1;
     }
+    shared = sim.shared;
     
-    /* Initialize maze */
-    init_maze(shared, config);
-    
-    /* Allocate child PID array */
-    child_pids = (pid_t*)malloc(config->num_families * sizeof(pid_t));
-    if (child_pids == NULL) {
-        fprintf(stderr, "Failed to allocate memory for child PIDs\n");
-        signal_handler(0);
+    safe_strcpy(shared->checkpoint_path, checkpoint_file, sizeof(shared->checkpoint_path));
+    if (checkpoint_at >= 0) {
+        shared->checkpoint_at_ms = (long long)(checkpoint_at * 1000.0);
+    }
+    if (restore_file != NULL && checkpoint_restore(shared, restore_file) != 0) {
+        cleanup_simulation(&sim);
+        free_config(config);
         return 1;
     }
-    memset(child_pids, 0, config->num_families * sizeof(pid_t));
     
     printf("Starting simulation: %d families, %d bananas, %dx%d maze\n", 
            config->num_families, config->total_bananas, config->maze_rows, config->maze_cols);
     printf("Females enter from bottom row (row %d), exit at row 0\n", config->maze_rows - 1);
     printf("Female collection goal: %d bananas before heading to exit\n", config->female_collection_goal);
+    printf("Time mode: %s\n", time_mode_name(time_mode));
+    if (record_file != NULL) {
+        printf("Recording decisions to: %s (replay with --replay=%s)\n", record_file, record_file);
+    }
+    if (restore_file != NULL) {
+        printf("Restored from checkpoint: %s (t=%.1fs)\n", restore_file, checkpoint.now_ms / 1000.0);
+    }
+    if (time_mode != TIME_MODE_REAL) {
+        printf("Checkpoint: kill -USR1 %d writes %s\n", (int)getpid(), checkpoint_file);
+    }
+    printf("Seed: %u (reproduce with seed=%u)\n", shared->seed, shared->seed);
+    printf("Shared memory: %s (viewer: ./apes_viewer %s)\n", shm_name, shm_name);
     printf("Press Ctrl+C to stop\n\n");
     
     /* Show initial state (Time 0) */
@@ -532,39 +570,10 @@ int main(int argc, char* argv[]) {
     sleep_ms(1500);
     clear_screen();
     
-    /* NOW set start_time - this is when the simulation truly begins */
-    shared->start_time = time(NULL);
-    
-    /* Fork family processes */
-    for (i = 0; i < config->num_families; i++) {
-        pid_t pid = fork();
-        
-        if (pid < 0) {
-            perror("fork failed");
-            signal_handler(0);
-            return 1;
-        }
-        
-        if (pid == 0) {
-            /* Child process - run family */
-            free(child_pids);  /* Child doesn't need this */
-            
-            run_family_process(i, shared, config);
-            
-            /* Cleanup and exit child */
-            detach_shared_memory(shared);
-            free_config(config);
-            exit(0);
-        }
-        
-        /* Parent - save child PID */
-        child_pids[i] = pid;
-        num_children++;
-    }
-    
-    /* Start monitor thread */
-    if (pthread_create(&monitor_tid, NULL, monitor_thread, config) != 0) {
-        perror("Failed to create monitor thread");
+    /* Fork family processes and start the monitor */
+    if (start_simulation(&sim) != 0) {
+        signal_handler(0);
+        return 1;
     }
     
     /* Start display thread */
@@ -572,35 +581,27 @@ int main(int argc, char* argv[]) {
         perror("Failed to create display thread");
     }
     
-    /* Wait for all child processes to finish */
-    for (i = 0; i < config->num_families; i++) {
-        int status;
-        waitpid(child_pids[i], &status, 0);
-    }
+    /* Wait for all child processes to finish, then stop the monitor */
+    wait_simulation(&sim);
     
-    /* Stop threads */
-    shared->simulation_running = 0;
-    pthread_join(monitor_tid, NULL);
+    /* Stop display thread */
     pthread_join(display_tid, NULL);
     
     /* Print final results */
     print_final_results(config);
     
-    /* Cleanup */
-    cleanup_maze(shared);
-    
-    cleanup_simulation_semaphores(shared->num_families, shared->maze_rows, shared->maze_cols);
-    
-    /* Cleanup event lock */
-    sem_destroy(&shared->event_lock);
-    
-    detach_shared_memory(shared);
-    destroy_shared_memory(shm_id);
+    /* Store or check the outcome of a recorded run */
+    collect_simulation_result(&sim, &result);
+    if (replay_finish(&result) != 0) {
+        status = 1;
+    }
     
-    free(child_pids);
+    /* Cleanup */
+    cleanup_simulation(&sim);
+    replay_close();
     free_config(config);
     
     printf("Simulation complete!\n\n");
     
-    return 0;
+    return status;
 }
@@ -1,7 +1,322 @@
 #include "local.h"
 
+/* Row and column offsets of DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT */
+static const int dir_dx[4] = {-1, 1, 0, 0};
+static const int dir_dy[4] = {0, 0, -1, 1};
+
+/*
+ * Fill every cell's exit_dir from a multi-source BFS out of row 0
+ * Ties between equally short steps prefer UP, then LEFT/RIGHT, then DOWN
+ */
+static void build_exit_field(SharedData* shared) {
+    static const int preference[4] = {DIR_UP, DIR_LEFT, DIR_RIGHT, DIR_DOWN};
+    int rows = shared->maze_rows;
+    int cols = shared->maze_cols;
+    size_t cells = (size_t)rows * (size_t)cols;
+    int32_t* dist;
+    int32_t* queue;
+    size_t head = 0, tail = 0, c;
+    int i, d;
+    
+    dist = (int32_t*)malloc(cells * sizeof(int32_t));
+    queue = (int32_t*)malloc(cells * sizeof(int32_t));
+    if (dist == NULL || queue == NULL) {
+        /* Without the field every cell uses the greedy fallback */
+        fprintf(stderr, "Warning: no memory for the exit distance field\n");
+        for (c = 0; c < cells; c++) {
+            maze_cell(shared, 0, 0)[c].exit_dir = EXIT_DIR_NONE;
+        }
+        free(dist);
+        free(queue);
+        return;
+    }
+    
+    for (c = 0; c < cells; c++) dist[c] = -1;
+    
+    /* Every passable exit cell is a source at distance 0 */
+    for (i = 0; i < cols; i++) {
+        if (!maze_cell(shared, 0, i)->is_obstacle) {
+            dist[i] = 0;
+            queue[tail++] = i;
+        }
+    }
+    
+    while (head < tail) {
+        int cur = queue[head++];
+        int x = cur / cols, y = cur % cols;
+        
+        for (d = 0; d < 4; d++) {
+            int nx = x + dir_dx[d], ny = y + dir_dy[d];
+            int next = nx * cols + ny;
+            
+            if (is_passable(shared, nx, ny) && dist[next] < 0) {
+                dist[next] = dist[cur] + 1;
+                queue[tail++] = next;
+            }
+        }
+    }
+    
+    /* Point each reachable cell at a neighbour one step closer */
+    for (c = 0; c < cells; c++) {
+        int x = (int)(c / (size_t)cols), y = (int)(c % (size_t)cols);
+        MazeCell* cell = maze_cell(shared, x, y);
+        
+        cell->exit_dir = EXIT_DIR_NONE;
+        if (dist[c] <= 0) continue;
+        
+        for (i = 0; i < 4; i++) {
+            int nx = x + dir_dx[preference[i]], ny = y + dir_dy[preference[i]];
+            
+            if (is_valid_cell(shared, nx, ny) && dist[nx * cols + ny] == dist[c] - 1) {
+                cell->exit_dir = (uint8_t)preference[i];
+                break;
+            }
+        }
+    }
+    
+    free(dist);
+    free(queue);
+}
+
+/* ==================== Banana Distance Field ==================== */
+
+/*
+ * Scratch for update_banana_field, allocated on first use by each process
+ * and only touched under banana_field_lock
+ */
+static int32_t* g_field_queue = NULL;       // Candidate cells, each queued once
+static int32_t* g_field_seeds = NULL;       // Affected cells with a finite bound, sorted
+static int32_t* g_field_bfs = NULL;         // Relaxation queue
+static uint8_t* g_field_mark = NULL;        // FIELD_* state per cell
+static size_t g_field_cells = 0;
+
+#define FIELD_QUEUED    1                   // Candidate, not yet decided
+#define FIELD_AFFECTED  2                   // Lost its route to the removed source
+#define FIELD_SUPPORTED 3                   // Still has a route of the same length
+
+static int field_scratch(size_t cells) {
+    if (g_field_cells >= cells) return 0;
+    
+    free(g_field_queue);
+    free(g_field_seeds);
+    free(g_field_bfs);
+    free(g_field_mark);
+    g_field_queue = (int32_t*)malloc(cells * sizeof(int32_t));
+    g_field_seeds = (int32_t*)malloc(cells * sizeof(int32_t));
+    g_field_bfs = (int32_t*)malloc(cells * sizeof(int32_t));
+    g_field_mark = (uint8_t*)calloc(cells, 1);
+    if (g_field_queue == NULL || g_field_seeds == NULL || g_field_bfs == NULL ||
+        g_field_mark == NULL) {
+        g_field_cells = 0;
+        return -1;
+    }
+    g_field_cells = cells;
+    return 0;
+}
+
+static int32_t load_dist(const int32_t* field, int cell) {
+    return __atomic_load_n(&field[cell], __ATOMIC_RELAXED);
+}
+
+static void store_dist(int32_t* field, int cell, int32_t value) {
+    __atomic_store_n(&field[cell], value, __ATOMIC_RELAXED);
+}
+
+static const int32_t* g_sort_field;
+
+static int compare_by_dist(const void* a, const void* b) {
+    int32_t da = g_sort_field[*(const int32_t*)a];
+    int32_t db = g_sort_field[*(const int32_t*)b];
+    
+    return (da > db) - (da < db);
+}
+
+void build_banana_field(SharedData* shared) {
+    int rows = shared->maze_rows;
+    int cols = shared->maze_cols;
+    size_t cells = (size_t)rows * (size_t)cols;
+    int32_t* field = banana_dist(shared, 0, 0);
+    int32_t* queue;
+    size_t head = 0, tail = 0, c;
+    int d;
+    
+    queue = (int32_t*)malloc(cells * sizeof(int32_t));
+    
+    /* Every cell holding bananas is a source at distance 0 */
+    for (c = 0; c < cells; c++) {
+        field[c] = BANANA_DIST_NONE;
+        if (maze_cell(shared, 0, 0)[c].bananas > 0) {
+            field[c] = 0;
+            if (queue != NULL) queue[tail++] = (int32_t)c;
+        }
+    }
+    if (queue == NULL) {
+        /* Sources only: exploration falls back to the neighbour counts */
+        fprintf(stderr, "Warning: no memory for the banana distance field\n");
+        return;
+    }
+    
+    while (head < tail) {
+        int cur = queue[head++];
+        int x = cur / cols, y = cur % cols;
+        
+        for (d = 0; d < 4; d++) {
+            int nx = x + dir_dx[d], ny = y + dir_dy[d];
+            int next = nx * cols + ny;
+            
+            if (is_passable(shared, nx, ny) && field[next] == BANANA_DIST_NONE) {
+                field[next] = field[cur] + 1;
+                queue[tail++] = next;
+            }
+        }
+    }
+    
+    free(queue);
+}
+
+void build_female_index(SharedData* shared) {
+    size_t cells = (size_t)shared->maze_rows * (size_t)shared->maze_cols;
+    int32_t* heads = cell_occupant(shared, 0, 0);
+    size_t c;
+    int f;
+    
+    for (c = 0; c < cells; c++) {
+        heads[c] = -1;
+    }
+    
+    /* Pushing families in descending order leaves every list ascending */
+    for (f = shared->num_families - 1; f >= 0; f--) {
+        int32_t cell = *female_cell(shared, f);
+        
+        if (cell < 0 || (size_t)cell >= cells) {
+            *female_cell(shared, f) = -1;
+            *female_next(shared, f) = -1;
+            continue;
+        }
+        *female_next(shared, f) = heads[cell];
+        heads[cell] = f;
+    }
+}
+
+/*
+ * Repair the field after the cell at `source` ran out of bananas
+ * Only the cells whose every shortest route led through that cell are
+ * touched: they are found level by level, reset, and re-solved from the
+ * unaffected cells around them. Caller holds banana_field_lock.
+ */
+static void remove_banana_source(SharedData* shared, int source) {
+    int cols = shared->maze_cols;
+    int32_t* field = banana_dist(shared, 0, 0);
+    size_t head = 0, tail = 0, num_seeds = 0, bfs_head = 0, bfs_tail = 0, i;
+    int d;
+    
+    if (field_scratch((size_t)shared->maze_rows * (size_t)cols) != 0) {
+        fprintf(stderr, "Warning: no memory to update the banana distance field\n");
+        return;
+    }
+    
+    /* Phase 1: collect the affected cells in increasing distance order.
+     * A candidate is affected unless some unaffected neighbour one step
+     * closer still supports it; FIFO order settles every closer cell first */
+    g_field_queue[tail++] = source;
+    g_field_mark[source] = FIELD_QUEUED;
+    while (head < tail) {
+        int cur = g_field_queue[head++];
+        int x = cur / cols, y = cur % cols;
+        int32_t dist = load_dist(field, cur);
+        int supported = 0;
+        
+        if (cur != source) {
+            for (d = 0; d < 4 && !supported; d++) {
+                int nx = x + dir_dx[d], ny = y + dir_dy[d];
+                int next = nx * cols + ny;
+                
+                supported = is_passable(shared, nx, ny) &&
+                            load_dist(field, next) == dist - 1 &&
+                            g_field_mark[next] != FIELD_AFFECTED;
+            }
+        }
+        if (supported) {
+            g_field_mark[cur] = FIELD_SUPPORTED;
+            continue;
+        }
+        
+        g_field_mark[cur] = FIELD_AFFECTED;
+        
+        for (d = 0; d < 4; d++) {
+            int nx = x + dir_dx[d], ny = y + dir_dy[d];
+            int next = nx * cols + ny;
+            
+            if (is_passable(shared, nx, ny) && g_field_mark[next] == 0 &&
+                load_dist(field, next) == dist + 1) {
+                g_field_mark[next] = FIELD_QUEUED;
+                g_field_queue[tail++] = next;
+            }
+        }
+    }
+    
+    /* Phase 2: bound each affected cell by its unaffected neighbours */
+    for (i = 0; i < tail; i++) {
+        int cur = g_field_queue[i];
+        int x = cur / cols, y = cur % cols;
+        int32_t best = BANANA_DIST_NONE;
+        
+        if (g_field_mark[cur] != FIELD_AFFECTED) continue;
+        
+        for (d = 0; d < 4; d++) {
+            int nx = x + dir_dx[d], ny = y + dir_dy[d];
+            int next = nx * cols + ny;
+            
+            if (is_passable(shared, nx, ny) && g_field_mark[next] != FIELD_AFFECTED) {
+                int32_t n = load_dist(field, next);
+                if (n != BANANA_DIST_NONE && n + 1 < best) best = n + 1;
+            }
+        }
+        
+        store_dist(field, cur, best);
+        if (best != BANANA_DIST_NONE) g_field_seeds[num_seeds++] = cur;
+    }
+    
+    /* Phase 3: unit-weight Dijkstra inside the affected region, merging the
+     * sorted seeds with the FIFO of relaxed cells */
+    g_sort_field = field;
+    qsort(g_field_seeds, num_seeds, sizeof(int32_t), compare_by_dist);
+    i = 0;
+    while (i < num_seeds || bfs_head < bfs_tail) {
+        int cur;
+        int x, y;
+        
+        if (bfs_head == bfs_tail ||
+            (i < num_seeds && load_dist(field, g_field_seeds[i]) <=
+                              load_dist(field, g_field_bfs[bfs_head]))) {
+            cur = g_field_seeds[i++];
+        } else {
+            cur = g_field_bfs[bfs_head++];
+        }
+        x = cur / cols;
+        y = cur % cols;
+        
+        for (d = 0; d < 4; d++) {
+            int nx = x + dir_dx[d], ny = y + dir_dy[d];
+            int next = nx * cols + ny;
+            
+            if (is_passable(shared, nx, ny) && g_field_mark[next] == FIELD_AFFECTED &&
+                load_dist(field, cur) + 1 < load_dist(field, next)) {
+                store_dist(field, next, load_dist(field, cur) + 1);
+                g_field_bfs[bfs_tail++] = next;
+            }
+        }
+    }
+    
+    for (i = 0; i < tail; i++) {
+        g_field_mark[g_field_queue[i]] = 0;
+    }
+}
+
+/* ==================== Maze Setup ==================== */
+
 void init_maze(SharedData* shared, const SimConfig* config) {
-    int i, j, k;
+    int i, j;
     int bananas_placed = 0;
     int target_bananas = config->total_bananas;
     
@@ -11,15 +326,13 @@ void init_maze(SharedData* shared, const SimConfig* config) {
     /* Initialize all cells */
     for (i = 0; i < config->maze_rows; i++) {
         for (j = 0; j < config->maze_cols; j++) {
-            MazeCell* cell = &shared->maze[i][j];
-            
-            /* Clear female tracking */
-            for (k = 0; k < MAX_FAMILIES; k++) {
-                cell->females_in_cell[k] = 0;
-            }
+            MazeCell* cell = maze_cell(shared, i, j);
             
             /* Note: Semaphores are initialized by sem_wrapper */
             
+            /* No female in the cell yet */
+            *cell_occupant(shared, i, j) = -1;
+            
             /* First row (row 0) is the exit - no obstacles */
             if (i == 0) {
                 cell->is_obstacle = 0;
@@ -42,7 +355,7 @@ void init_maze(SharedData* shared, const SimConfig* config) {
     for (i = 1; i < config->maze_rows; i++) {
         int has_passage = 0;
         for (j = 0; j < config->maze_cols; j++) {
-            if (!shared->maze[i][j].is_obstacle) {
+            if (!maze_cell(shared, i, j)->is_obstacle) {
                 has_passage = 1;
                 break;
             }
@@ -50,7 +363,7 @@ void init_maze(SharedData* shared, const SimConfig* config) {
         if (!has_passage) {
             /* Clear a random cell in this row */
             int clear_col = random_int(0, config->maze_cols - 1);
-            shared->maze[i][clear_col].is_obstacle = 0;
+            maze_cell(shared, i, clear_col)->is_obstacle = 0;
         }
     }
     
@@ -59,7 +372,7 @@ void init_maze(SharedData* shared, const SimConfig* config) {
         int row = random_int(1, config->maze_rows - 1);
         int col = random_int(0, config->maze_cols - 1);
         
-        MazeCell* cell = &shared->maze[row][col];
+        MazeCell* cell = maze_cell(shared, row, col);
         
         if (!cell->is_obstacle && cell->bananas < config->max_bananas_per_cell) {
             cell->bananas++;
@@ -69,6 +382,9 @@ void init_maze(SharedData* shared, const SimConfig* config) {
     
     shared->total_bananas_in_maze = target_bananas;
     
+    build_exit_field(shared);
+    build_banana_field(shared);
+    
     log_event("Maze initialized: %dx%d with %d bananas", 
               config->maze_rows, config->maze_cols, target_bananas);
 }
@@ -88,21 +404,14 @@ void print_maze(const SharedData* shared) {
     for (i = 0; i < shared->maze_rows; i++) {
         printf("%2d |", i);
         for (j = 0; j < shared->maze_cols; j++) {
-            const MazeCell* cell = &shared->maze[i][j];
+            const MazeCell* cell = maze_cell(shared, i, j);
             
             if (cell->is_obstacle) {
                 printf("███");
             } else {
                 /* Check if any female is here */
-                int female_here = -1;
-                int k;
-                for (k = 0; k < shared->num_families; k++) {
-                    if (cell->females_in_cell[k]) {
-                        female_here = k;
-                        break;
-                    }
-                }
-                
+                int female_here = first_female(shared, i, j);
+
                 if (female_here >= 0) {
                     printf(" F%d", female_here);
                 } else if (cell->bananas > 0) {
@@ -145,7 +454,7 @@ void print_maze_colored(const SharedData* shared) {
     for (i = 0; i < shared->maze_rows; i++) {
         printf("%2d │", i);
         for (j = 0; j < shared->maze_cols; j++) {
-            const MazeCell* cell = &shared->maze[i][j];
+            const MazeCell* cell = maze_cell(shared, i, j);
             
             if (cell->is_obstacle) {
                 set_color(COLOR_WHITE);
@@ -153,15 +462,8 @@ void print_maze_colored(const SharedData* shared) {
                 reset_color();
             } else {
                 /* Check if any female is here */
-                int female_here = -1;
-                int k;
-                for (k = 0; k < shared->num_families; k++) {
-                    if (cell->females_in_cell[k]) {
-                        female_here = k;
-                        break;
-                    }
-                }
-                
+                int female_here = first_female(shared, i, j);
+
                 if (female_here >= 0) {
                     set_color(COLOR_MAGENTA);
                     printf(" F%d", female_here);
@@ -186,118 +488,106 @@ void print_maze_colored(const SharedData* shared) {
     printf("─\n");
 }
 
-void print_maze_compact(const SharedData* shared) {
+void draw_maze_compact(Screen* screen, const SharedData* shared, const SnapshotCell* cells) {
     int i, j;
     
     /* Family colors for females */
-    const char* family_colors[] = {
-        "\033[91m",  /* Red */
-        "\033[92m",  /* Green */
-        "\033[94m",  /* Blue */
-        "\033[95m",  /* Magenta */
-        "\033[96m",  /* Cyan */
-        "\033[93m",  /* Yellow */
+    const int family_colors[] = {
+        SCREEN_RED,
+        SCREEN_GREEN,
+        SCREEN_BLUE,
+        SCREEN_MAGENTA,
+        SCREEN_CYAN,
+        SCREEN_YELLOW,
     };
     int num_colors = 6;
     
     /* Top border */
-    printf("   ┌");
+    screen_printf(screen, SCREEN_PLAIN, "   ┌");
     for (j = 0; j < shared->maze_cols; j++) {
-        printf("──");
+        screen_printf(screen, SCREEN_PLAIN, "──");
     }
-    printf("┐\n");
+    screen_printf(screen, SCREEN_PLAIN, "┐\n");
     
     for (i = 0; i < shared->maze_rows; i++) {
-        printf("%2d │", i);
+        screen_printf(screen, SCREEN_PLAIN, "%2d │", i);
         for (j = 0; j < shared->maze_cols; j++) {
-            const MazeCell* cell = &shared->maze[i][j];
+            const SnapshotCell* cell = &cells[(size_t)i * (size_t)shared->maze_cols + (size_t)j];
             
-            if (cell->is_obstacle) {
-                printf("\033[47m  \033[0m");  /* White background block */
+            if (maze_cell(shared, i, j)->is_obstacle) {
+                screen_printf(screen, SCREEN_WALL, "  ");  /* White background block */
             } else {
                 /* Check if any female is here */
-                int female_here = -1;
-                int k;
-                for (k = 0; k < shared->num_families; k++) {
-                    if (cell->females_in_cell[k]) {
-                        female_here = k;
-                        break;
-                    }
-                }
-                
+                int female_here = cell->ape;
+
                 if (female_here >= 0) {
                     /* Female ape - show with family color */
-                    printf("%s", family_colors[female_here % num_colors]);
-                    printf("🐒");
-                    printf("\033[0m");
+                    screen_printf(screen, family_colors[female_here % num_colors], "🐒");
                 } else if (cell->bananas > 0) {
                     /* Bananas - yellow */
-                    printf("\033[93m");
                     if (cell->bananas >= 5) {
-                        printf("🍌");
+                        screen_printf(screen, SCREEN_YELLOW, "🍌");
                     } else {
-                        printf("%d ", cell->bananas);
+                        screen_printf(screen, SCREEN_YELLOW, "%d ", cell->bananas);
                     }
-                    printf("\033[0m");
                 } else {
                     /* Empty cell */
-                    printf("· ");
+                    screen_printf(screen, SCREEN_PLAIN, "· ");
                 }
             }
         }
-        printf("│\n");
+        screen_printf(screen, SCREEN_PLAIN, "│\n");
     }
     
     /* Bottom border */
-    printf("   └");
+    screen_printf(screen, SCREEN_PLAIN, "   └");
     for (j = 0; j < shared->maze_cols; j++) {
-        printf("──");
+        screen_printf(screen, SCREEN_PLAIN, "──");
     }
-    printf("┘\n");
+    screen_printf(screen, SCREEN_PLAIN, "┘\n");
 }
 
 int get_bananas_at(SharedData* shared, int x, int y) {
-    int bananas;
-    
     if (!is_valid_cell(shared, x, y)) return 0;
     
-    sem_wait(&shared->maze_locks[x][y]);
-    bananas = shared->maze[x][y].bananas;
-    sem_post(&shared->maze_locks[x][y]);
-    
-    return bananas;
+    return __atomic_load_n(&maze_cell(shared, x, y)->bananas, __ATOMIC_ACQUIRE);
 }
 
 int take_bananas(SharedData* shared, int x, int y, int count) {
-    int taken = 0;
-    
-    if (!is_valid_cell(shared, x, y)) return 0;
+    int32_t* bananas;
+    int32_t current;
+    int taken;
     
-    sem_wait(&shared->maze_locks[x][y]);
+    if (!is_valid_cell(shared, x, y) || count <= 0) return 0;
     
-    MazeCell* cell = &shared->maze[x][y];
+    bananas = &maze_cell(shared, x, y)->bananas;
+    current = __atomic_load_n(bananas, __ATOMIC_ACQUIRE);
     
-    if (cell->bananas >= count) {
-        taken = count;
-    } else {
-        taken = cell->bananas;
-    }
-    
-    cell->bananas -= taken;
+    /* Retry until no other female changed the cell between load and swap
+     * (a failed CAS refreshes current) */
+    do {
+        if (current <= 0) return 0;
+        taken = (current >= count) ? count : current;
+    } while (!__atomic_compare_exchange_n(bananas, &current, current - taken, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
     
     /* Update global count */
-    sem_wait(&shared->global_lock);
-    shared->total_bananas_in_maze -= taken;
-    sem_post(&shared->global_lock);
-    
-    sem_post(&shared->maze_locks[x][y]);
+    __atomic_fetch_sub(&shared->total_bananas_in_maze, taken, __ATOMIC_RELAXED);
+    mark_cell_changed(shared, x, y);
+    
+    /* The CAS that empties a cell is unique, so each source is removed once */
+    if (current == taken) {
+        sim_mutex_lock(&shared->banana_field_lock);
+        remove_banana_source(shared, x * shared->maze_cols + y);
+        sim_mutex_unlock(&shared->banana_field_lock);
+    }
     
     return taken;
 }
 
 int is_obstacle(const SharedData* shared, int x, int y) {
     if (!is_valid_cell(shared, x, y)) return 1;
-    return shared->maze[x][y].is_obstacle;
+    return maze_cell(shared, x, y)->is_obstacle;
 }
 
 int is_valid_cell(const SharedData* shared, int x, int y) {
@@ -332,7 +622,13 @@ int get_random_start_position(const SharedData* shared, int* x, int* y) {
 }
 
 int get_direction_to_exit(const SharedData* shared, int x, int y) {
-    /* Priority: UP (towards exit(row0)), then sideways, then down */
+    /* Downhill step of the precomputed shortest-path field */
+    if (is_valid_cell(shared, x, y)) {
+        int dir = maze_cell(shared, x, y)->exit_dir;
+        if (dir != EXIT_DIR_NONE) return dir;
+    }
+    
+    /* No path to row 0: priority UP (towards exit(row0)), then sideways, then down */
     
     /* Try UP first */
     if (is_passable(shared, x - 1, y)) {
@@ -363,10 +659,8 @@ int get_direction_to_exit(const SharedData* shared, int x, int y) {
  */
 int get_direction_to_explore(const SharedData* shared, int x, int y) {
     int directions[4] = {DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT};
-    int dx[4] = {-1, 1, 0, 0};
-    int dy[4] = {0, 0, -1, 1};
     int best_dir = -1;
-    int best_bananas = -1;
+    long long best_rank = 0;
     int i;
     
     /* Shuffle directions for randomness */
@@ -380,18 +674,20 @@ int get_direction_to_explore(const SharedData* shared, int x, int y) {
     /* Check each direction */
     for (i = 0; i < 4; i++) {
         int dir = directions[i];
-        int nx = x + dx[dir];
-        int ny = y + dy[dir];
+        int nx = x + dir_dx[dir];
+        int ny = y + dir_dy[dir];
         
         if (is_passable(shared, nx, ny)) {
-            int bananas = shared->maze[nx][ny].bananas;
+            int bananas = __atomic_load_n(&maze_cell(shared, nx, ny)->bananas, __ATOMIC_RELAXED);
             
-            /* Prefer cells with bananas */
-            if (bananas > best_bananas) {
-                best_bananas = bananas;
-                best_dir = dir;
-            } else if (best_dir < 0) {
-                /* Accept any passable cell if nothing better */
+            /* Prefer the fullest neighbour, else the one closest to any
+             * banana (downhill on the distance field); any passable cell
+             * is accepted if nothing better */
+            long long rank = bananas > 0 ? -(long long)bananas :
+                             __atomic_load_n(banana_dist(shared, nx, ny), __ATOMIC_RELAXED);
+            
+            if (best_dir < 0 || rank < best_rank) {
+                best_rank = rank;
                 best_dir = dir;
             }
         }
@@ -424,32 +720,97 @@ int move_in_direction(const SharedData* shared, int* x, int* y, int direction) {
 }
 
 
+/*
+ * Unlink a female from the occupant list of (x, y)
+ * Caller holds the cell's lock stripe
+ */
+static void unlink_female(SharedData* shared, int x, int y, int family_id) {
+    int32_t* link = cell_occupant(shared, x, y);
+    
+    while (*link >= 0 && *link != family_id) {
+        link = female_next(shared, *link);
+    }
+    if (*link == family_id) {
+        __atomic_store_n(link, *female_next(shared, family_id), __ATOMIC_RELEASE);
+    }
+}
+
+/*
+ * Link a female into the occupant list of (x, y), keeping it sorted by
+ * family id so the head is the lowest one
+ * Caller holds the cell's lock stripe
+ */
+static void link_female(SharedData* shared, int x, int y, int family_id) {
+    int32_t* link = cell_occupant(shared, x, y);
+    
+    while (*link >= 0 && *link < family_id) {
+        link = female_next(shared, *link);
+    }
+    __atomic_store_n(female_next(shared, family_id), *link, __ATOMIC_RELAXED);
+    __atomic_store_n(link, family_id, __ATOMIC_RELEASE);
+}
+
 void set_female_in_cell(SharedData* shared, int x, int y, int family_id, int present) {
+    int32_t cell, current;
+    int cx = -1, cy = -1;
+    sim_mutex_t* first = NULL;
+    sim_mutex_t* second = NULL;
+    
     if (!is_valid_cell(shared, x, y)) return;
-    if (family_id < 0 || family_id >= MAX_FAMILIES) return;
+    if (family_id < 0 || family_id >= shared->num_families) return;
+    
+    cell = x * shared->maze_cols + y;
+    current = *female_cell(shared, family_id);
+    if (present ? current == cell : current != cell) return;
+    
+    /* Hold the stripes of the cell she leaves and the one she enters
+     * together, lower stripe first (once if they share one), so a move
+     * takes her from one cell to the other in a single step */
+    if (current >= 0) {
+        cx = current / shared->maze_cols;
+        cy = current % shared->maze_cols;
+        first = maze_lock(shared, cx, cy);
+    }
+    if (present) {
+        second = maze_lock(shared, x, y);
+        if (first == NULL || first == second) {
+            first = second;
+            second = NULL;
+        } else if (second < first) {
+            sim_mutex_t* swap = first;
+            first = second;
+            second = swap;
+        }
+    }
     
-    sem_wait(&shared->maze_locks[x][y]);
-    shared->maze[x][y].females_in_cell[family_id] = present;
-    sem_post(&shared->maze_locks[x][y]);
+    sim_mutex_lock(first);
+    if (second != NULL) sim_mutex_lock(second);
+    if (current >= 0) unlink_female(shared, cx, cy, family_id);
+    if (present) link_female(shared, x, y, family_id);
+    __atomic_store_n(female_cell(shared, family_id), present ? cell : -1, __ATOMIC_RELEASE);
+    if (second != NULL) sim_mutex_unlock(second);
+    sim_mutex_unlock(first);
+    
+    if (current >= 0) mark_cell_changed(shared, cx, cy);
+    if (present) mark_cell_changed(shared, x, y);
 }
 
 int check_female_collision(const SharedData* shared, int x, int y, int my_family_id) {
-    int other_female = -1;
-    int k;
+    sim_mutex_t* lock;
+    int other;
     
     if (!is_valid_cell(shared, x, y)) return -1;
     
-    /* Note: Caller should hold the cell lock for thread safety */
-    const MazeCell* cell = &shared->maze[x][y];
-    
-    for (k = 0; k < shared->num_families; k++) {
-        if (k != my_family_id && cell->females_in_cell[k]) {
-            other_female = k;
-            break;
-        }
-    }
+    /* Under the cell's stripe no move is half done, so the list holds
+     * exactly the females in the cell; it is sorted, so the first other
+     * one is the lowest */
+    lock = maze_lock(shared, x, y);
+    sim_mutex_lock(lock);
+    other = *cell_occupant(shared, x, y);
+    if (other == my_family_id) other = *female_next(shared, other);
+    sim_mutex_unlock(lock);
     
-    return other_female;
+    return other;
 }
 
 void cleanup_maze(SharedData* shared) {
@@ -0,0 +1,224 @@
+/*
+ * pool.c
+ * Work-stealing worker pool running clock actors as tasks
+ */
+
+#include "local.h"
+
+/*
+ * One worker's queued tasks (actor ids) in a ring: the owner pops the
+ * newest from the tail, thieves take the oldest from the head
+ */
+typedef struct {
+    sim_mutex_t lock;
+    int* tasks;
+    unsigned int head, tail;            // Tasks in [head, tail), slot = index & mask
+} TaskDeque;
+
+struct Pool {
+    SharedData* shared;
+    PoolStepFn step;
+    void* step_arg;
+    int num_workers;
+    int started;                        // Workers created
+    int next_worker_id;                 // Handed out as workers start (atomic)
+    unsigned int mask;                  // Ring slots per deque - 1 (power of two)
+    TaskDeque* deques;
+    pthread_t* threads;
+    int next_deque;                     // Round-robin release target (clock lock held)
+    int queued;                         // Tasks in all deques (atomic)
+    int sleepers;                       // Workers waiting for tasks (atomic)
+    int done;                           // 1 once every actor has exited
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+};
+
+/*
+ * Clock release hook: queue a due actor's step
+ * Called with the clock lock held, which serializes the round-robin
+ */
+static void pool_release(int actor, void* arg) {
+    Pool* pool = (Pool*)arg;
+    TaskDeque* deque = &pool->deques[pool->next_deque];
+    
+    pool->next_deque = (pool->next_deque + 1) % pool->num_workers;
+    
+    sim_mutex_lock(&deque->lock);
+    deque->tasks[deque->tail & pool->mask] = actor;
+    __atomic_store_n(&deque->tail, deque->tail + 1, __ATOMIC_RELEASE);
+    sim_mutex_unlock(&deque->lock);
+    
+    /* Workers count themselves as sleepers before they recheck queued */
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->idle_lock);
+        pthread_cond_signal(&pool->idle_cond);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+}
+
+/*
+ * Take a task: from the worker's own deque first, else steal from the
+ * others in turn
+ * Returns 1 with *actor set, 0 if every deque was empty
+ */
+static int take_task(Pool* pool, int id, int* actor) {
+    int i;
+    
+    for (i = 0; i < pool->num_workers; i++) {
+        TaskDeque* deque = &pool->deques[(id + i) % pool->num_workers];
+        int found = 0;
+        
+        /* Skip empty deques without touching their lock */
+        if (__atomic_load_n(&deque->head, __ATOMIC_ACQUIRE) ==
+            __atomic_load_n(&deque->tail, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        
+        sim_mutex_lock(&deque->lock);
+        if (deque->head != deque->tail) {
+            if (i == 0) {
+                *actor = deque->tasks[(deque->tail - 1) & pool->mask];
+                __atomic_store_n(&deque->tail, deque->tail - 1, __ATOMIC_RELEASE);
+            } else {
+                *actor = deque->tasks[deque->head & pool->mask];
+                __atomic_store_n(&deque->head, deque->head + 1, __ATOMIC_RELEASE);
+            }
+            found = 1;
+        }
+        sim_mutex_unlock(&deque->lock);
+        
+        if (found) {
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void pool_finish(Pool* pool) {
+    pthread_mutex_lock(&pool->idle_lock);
+    __atomic_store_n(&pool->done, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+}
+
+static void* pool_worker(void* arg) {
+    Pool* pool = (Pool*)arg;
+    int id = __atomic_fetch_add(&pool->next_worker_id, 1, __ATOMIC_RELAXED);
+    int actor, done;
+    
+    for (;;) {
+        if (take_task(pool, id, &actor)) {
+            pool->step(actor, pool->step_arg);
+            
+            /* The last actor to exit ends the run */
+            if (__atomic_load_n(&pool->shared->clock.num_actors, __ATOMIC_ACQUIRE) == 0) {
+                pool_finish(pool);
+            }
+            continue;
+        }
+        
+        /* Nothing queued: the running steps will release the next batch */
+        pthread_mutex_lock(&pool->idle_lock);
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 && !pool->done) {
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        }
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        done = pool->done;
+        pthread_mutex_unlock(&pool->idle_lock);
+        
+        if (done) break;
+    }
+    
+    return NULL;
+}
+
+static void free_pool(Pool* pool) {
+    int i;
+    
+    if (pool->deques != NULL) {
+        for (i = 0; i < pool->num_workers; i++) {
+            free(pool->deques[i].tasks);
+        }
+    }
+    free(pool->deques);
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle_cond);
+    free(pool);
+}
+
+Pool* pool_start(SharedData* shared, int num_workers, PoolStepFn step, void* arg) {
+    Pool* pool;
+    unsigned int slots = 1;
+    int i;
+    
+    if (num_workers < 1) num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_workers < 1) num_workers = 1;
+    
+    pool = (Pool*)calloc(1, sizeof(Pool));
+    if (pool == NULL) {
+        fprintf(stderr, "Failed to allocate worker pool\n");
+        return NULL;
+    }
+    pool->shared = shared;
+    pool->step = step;
+    pool->step_arg = arg;
+    pool->num_workers = num_workers;
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+    
+    /* An actor is queued at most once, so any one deque can hold them all */
+    while (slots < (unsigned int)shared->clock.num_actors) slots <<= 1;
+    pool->mask = slots - 1;
+    
+    pool->deques = (TaskDeque*)calloc((size_t)num_workers, sizeof(TaskDeque));
+    pool->threads = (pthread_t*)calloc((size_t)num_workers, sizeof(pthread_t));
+    if (pool->deques == NULL || pool->threads == NULL) {
+        fprintf(stderr, "Failed to allocate worker pool\n");
+        free_pool(pool);
+        return NULL;
+    }
+    for (i = 0; i < num_workers; i++) {
+        sim_mutex_init(&pool->deques[i].lock);
+        pool->deques[i].tasks = (int*)malloc(slots * sizeof(int));
+        if (pool->deques[i].tasks == NULL) {
+            fprintf(stderr, "Failed to allocate worker pool\n");
+            free_pool(pool);
+            return NULL;
+        }
+    }
+    
+    for (i = 0; i < num_workers; i++) {
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0) {
+            perror("Failed to create pool worker");
+            pool_finish(pool);
+            while (pool->started > 0) {
+                pthread_join(pool->threads[--pool->started], NULL);
+            }
+            free_pool(pool);
+            return NULL;
+        }
+        pool->started++;
+    }
+    
+    log_event("Pool execution: %d workers, %d actors", num_workers, shared->clock.num_actors);
+    sim_clock_start_pool(shared, pool_release, pool);
+    return pool;
+}
+
+int pool_finished(const Pool* pool) {
+    return __atomic_load_n(&pool->done, __ATOMIC_ACQUIRE);
+}
+
+void pool_wait(Pool* pool) {
+    int i;
+    
+    for (i = 0; i < pool->started; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    sim_clock_start_pool(pool->shared, NULL, NULL);
+    free_pool(pool);
+}
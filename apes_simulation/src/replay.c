@@ -0,0 +1,377 @@
+/*
+ * replay.c
+ * Decision log for deterministic record and replay
+ */
+
+#include "local.h"
+
+#define REPLAY_OFF 0
+#define REPLAY_RECORDING 1
+#define REPLAY_REPLAYING 2
+
+/*
+ * Replay position, shared by every family process
+ * Deterministic mode runs one actor at a time, so decisions are consumed
+ * in the same global order they were recorded in
+ */
+typedef struct {
+    uint64_t cursor;                    // Next recorded decision to consume
+    uint64_t diverged_at;               // Index of the first mismatch
+    int diverged;                       // 1 once the run left the recording
+} ReplayProgress;
+
+/* Open recording; the mappings are inherited by the family processes */
+static int g_mode = REPLAY_OFF;
+static ReplayHeader* g_log = NULL;
+static size_t g_log_size = 0;
+static int g_log_fd = -1;
+static uint64_t g_log_count = 0;        // Replaying: decisions available
+static ReplayProgress* g_progress = NULL;
+static SharedData* g_shared = NULL;
+
+/* Clock actor of the calling thread (-1 = not an actor) */
+static __thread int t_actor = -1;
+
+static const char* replay_kind_name(int kind) {
+    switch (kind) {
+        case REPLAY_RNG:         return "rng";
+        case REPLAY_BASKET_LOCK: return "basket_lock";
+        case REPLAY_FIGHT:       return "fight";
+        default:                 return "?";
+    }
+}
+
+static ReplayRecord* replay_records(void) {
+    return (ReplayRecord*)(g_log + 1);
+}
+
+static long long replay_now_ms(void) {
+    return g_shared != NULL ? __atomic_load_n(&g_shared->clock.now_ms, __ATOMIC_ACQUIRE) : 0;
+}
+
+/* ==================== Recording ==================== */
+
+int replay_record_open(const char* path, const char* config_file, uint64_t max_records) {
+    ReplayHeader* header;
+    FILE* file;
+    size_t size, len = 0;
+    int fd;
+    
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Failed to create recording");
+        return -1;
+    }
+    
+    /* Sparse until written; trimmed to the decisions made at close */
+    size = sizeof(ReplayHeader) + (size_t)max_records * sizeof(ReplayRecord);
+    if (ftruncate(fd, (off_t)size) != 0) {
+        perror("Failed to size recording");
+        close(fd);
+        return -1;
+    }
+    
+    header = (ReplayHeader*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) {
+        perror("Failed to map recording");
+        close(fd);
+        return -1;
+    }
+    
+    /* Embed the config text so the replay does not depend on the file */
+    file = fopen(config_file, "r");
+    if (file != NULL) {
+        len = fread(header->config_text, 1, REPLAY_CONFIG_MAX, file);
+        fclose(file);
+        if (len == REPLAY_CONFIG_MAX) {
+            fprintf(stderr, "Config file '%s' is too large to record (max %d bytes)\n",
+                    config_file, REPLAY_CONFIG_MAX - 1);
+            munmap(header, size);
+            close(fd);
+            return -1;
+        }
+    }
+    header->config_text[len] = '\0';
+    header->config_len = (uint32_t)len;
+    
+    memcpy(header->magic, REPLAY_MAGIC, sizeof(header->magic));
+    header->version = REPLAY_VERSION;
+    header->record_size = sizeof(ReplayRecord);
+    header->capacity = max_records;
+    header->next = 0;
+    
+    g_mode = REPLAY_RECORDING;
+    g_log = header;
+    g_log_size = size;
+    g_log_fd = fd;
+    return 0;
+}
+
+static void replay_log(int kind, uint64_t value) {
+    uint64_t slot = __atomic_fetch_add(&g_log->next, 1, __ATOMIC_RELAXED);
+    ReplayRecord* rec;
+    
+    if (slot >= g_log->capacity) {
+        /* A replay could not get past this point: end the run here (the
+         * males wake their babies as they exit, as after a signal) */
+        if (slot == g_log->capacity) {
+            fprintf(stderr, "Error: recording full after %llu decisions (raise record_max_records), "
+                    "stopping the run\n", (unsigned long long)g_log->capacity);
+            if (g_shared != NULL) {
+                __atomic_store_n(&g_shared->simulation_running, 0, __ATOMIC_RELEASE);
+            }
+        }
+        return;
+    }
+    
+    rec = &replay_records()[slot];
+    rec->value = value;
+    rec->time_ms = replay_now_ms();
+    rec->actor = t_actor;
+    rec->kind = kind;
+}
+
+/* ==================== Replaying ==================== */
+
+SimConfig* replay_load(const char* path) {
+    const ReplayHeader* header;
+    SimConfig* config;
+    struct stat st;
+    int fd;
+    
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open recording");
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ReplayHeader)) {
+        fprintf(stderr, "%s: not a recording (too short)\n", path);
+        close(fd);
+        return NULL;
+    }
+    
+    header = (const ReplayHeader*)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) {
+        perror("Failed to map recording");
+        return NULL;
+    }
+    
+    if (memcmp(header->magic, REPLAY_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != REPLAY_VERSION || header->record_size != sizeof(ReplayRecord) ||
+        header->config_len >= REPLAY_CONFIG_MAX || header->config_text[header->config_len] != '\0') {
+        fprintf(stderr, "%s: not a version %d recording\n", path, REPLAY_VERSION);
+        munmap((void*)header, (size_t)st.st_size);
+        return NULL;
+    }
+    
+    config = load_config_text(header->config_text);
+    if (config == NULL) {
+        munmap((void*)header, (size_t)st.st_size);
+        return NULL;
+    }
+    config->seed = header->seed;
+    
+    /* Progress is written by whichever family process is running */
+    g_progress = (ReplayProgress*)mmap(NULL, sizeof(ReplayProgress), PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (g_progress == MAP_FAILED) {
+        perror("Failed to map replay state");
+        g_progress = NULL;
+        free_config(config);
+        munmap((void*)header, (size_t)st.st_size);
+        return NULL;
+    }
+    memset(g_progress, 0, sizeof(ReplayProgress));
+    
+    g_log_count = ((size_t)st.st_size - sizeof(ReplayHeader)) / sizeof(ReplayRecord);
+    if (header->next < g_log_count) g_log_count = header->next;
+    
+    g_mode = REPLAY_REPLAYING;
+    g_log = (ReplayHeader*)header;
+    g_log_size = (size_t)st.st_size;
+    
+    printf("Replaying %s: seed %u, %llu decisions\n", path, header->seed,
+           (unsigned long long)g_log_count);
+    return config;
+}
+
+/*
+ * Report the first mismatch, then let the run continue unchecked
+ */
+static void replay_diverge(uint64_t index, const ReplayRecord* expected, int kind, uint64_t value) {
+    int was = 0;
+    
+    if (!__atomic_compare_exchange_n(&g_progress->diverged, &was, 1, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+    g_progress->diverged_at = index;
+    
+    if (expected == NULL) {
+        fprintf(stderr, "Replay diverged at decision %llu (t=%lld ms): recording ended, "
+                        "actor %d made %s=%llu\n",
+                (unsigned long long)index, replay_now_ms(), t_actor,
+                replay_kind_name(kind), (unsigned long long)value);
+    } else {
+        fprintf(stderr, "Replay diverged at decision %llu (t=%lld ms): recorded actor %d %s=%llu "
+                        "at t=%lld ms, got actor %d %s=%llu\n",
+                (unsigned long long)index, replay_now_ms(),
+                expected->actor, replay_kind_name(expected->kind),
+                (unsigned long long)expected->value, (long long)expected->time_ms,
+                t_actor, replay_kind_name(kind), (unsigned long long)value);
+    }
+}
+
+/*
+ * Consume the next recorded decision if it matches
+ * Returns it, or NULL once the run has diverged
+ */
+static const ReplayRecord* replay_expect(int kind, uint64_t value, int check_value) {
+    const ReplayRecord* rec;
+    uint64_t index;
+    
+    if (__atomic_load_n(&g_progress->diverged, __ATOMIC_ACQUIRE)) return NULL;
+    
+    index = __atomic_fetch_add(&g_progress->cursor, 1, __ATOMIC_ACQ_REL);
+    if (index >= g_log_count) {
+        replay_diverge(index, NULL, kind, value);
+        return NULL;
+    }
+    
+    rec = &replay_records()[index];
+    if (rec->kind != kind || rec->actor != t_actor || (check_value && rec->value != value)) {
+        replay_diverge(index, rec, kind, value);
+        return NULL;
+    }
+    return rec;
+}
+
+/* ==================== Hooks ==================== */
+
+void replay_attach(SharedData* shared) {
+    if (g_mode == REPLAY_OFF) return;
+    
+    g_shared = shared;
+    if (g_mode == REPLAY_RECORDING) {
+        g_log->seed = shared->seed;
+    }
+}
+
+void replay_set_actor(int actor) {
+    t_actor = actor;
+}
+
+uint64_t replay_rng(uint64_t drawn) {
+    const ReplayRecord* rec;
+    
+    if (g_mode == REPLAY_OFF || t_actor < 0) return drawn;
+    
+    if (g_mode == REPLAY_RECORDING) {
+        replay_log(REPLAY_RNG, drawn);
+        return drawn;
+    }
+    
+    /* Serve the recorded draw, so a changed generator still replays */
+    rec = replay_expect(REPLAY_RNG, drawn, 0);
+    return rec != NULL ? rec->value : drawn;
+}
+
+void replay_decision(int kind, int value) {
+    if (g_mode == REPLAY_OFF || t_actor < 0) return;
+    
+    if (g_mode == REPLAY_RECORDING) {
+        replay_log(kind, (uint64_t)(int64_t)value);
+    } else {
+        replay_expect(kind, (uint64_t)(int64_t)value, 1);
+    }
+}
+
+/* ==================== Outcome ==================== */
+
+static int compare_field(const char* name, long long recorded, long long replayed) {
+    if (recorded == replayed) return 0;
+    fprintf(stderr, "  %-18s recorded %lld, replayed %lld\n", name, recorded, replayed);
+    return 1;
+}
+
+int replay_finish(const SimResult* result) {
+    const SimResult* recorded;
+    int differs = 0;
+    int i;
+    
+    if (g_mode == REPLAY_RECORDING) {
+        /* A run stopped by a full recording has no outcome worth keeping */
+        if (g_log->next > g_log->capacity) {
+            fprintf(stderr, "Recording incomplete: the run needed more than %llu decisions\n",
+                    (unsigned long long)g_log->capacity);
+            return -1;
+        }
+        g_log->result = *result;
+        g_log->has_result = 1;
+        printf("Recorded %llu decisions\n", (unsigned long long)g_log->next);
+        return 0;
+    }
+    if (g_mode != REPLAY_REPLAYING) return 0;
+    
+    if (!g_progress->diverged && g_progress->cursor < g_log_count) {
+        fprintf(stderr, "Replay diverged: run ended after %llu of %llu recorded decisions\n",
+                (unsigned long long)g_progress->cursor, (unsigned long long)g_log_count);
+        g_progress->diverged = 1;
+        g_progress->diverged_at = g_progress->cursor;
+    }
+    
+    if (g_log->has_result) {
+        recorded = &g_log->result;
+        differs |= compare_field("termination_reason", recorded->termination_reason, result->termination_reason);
+        differs |= compare_field("winning_family", recorded->winning_family, result->winning_family);
+        differs |= compare_field("best_family", recorded->best_family, result->best_family);
+        differs |= compare_field("duration_ms", (long long)(recorded->duration_seconds * 1000.0),
+                                 (long long)(result->duration_seconds * 1000.0));
+        differs |= compare_field("remaining_bananas", recorded->remaining_bananas, result->remaining_bananas);
+        differs |= compare_field("withdrawn_count", recorded->withdrawn_count, result->withdrawn_count);
+        differs |= compare_field("total_eaten", recorded->total_eaten, result->total_eaten);
+        for (i = 0; i < result->num_families && i < SIM_RESULT_BASKETS; i++) {
+            char name[32];
+            
+            snprintf(name, sizeof(name), "basket_%d", i);
+            differs |= compare_field(name, recorded->baskets[i], result->baskets[i]);
+        }
+    } else {
+        fprintf(stderr, "Warning: recording has no final outcome (interrupted run)\n");
+    }
+    
+    if (g_progress->diverged || differs) {
+        printf("Replay FAILED: %s\n", differs ? "outcome differs from the recording"
+                                              : "decisions diverged, outcome identical");
+        return -1;
+    }
+    printf("Replay OK: %llu decisions and the final outcome match the recording\n",
+           (unsigned long long)g_log_count);
+    return 0;
+}
+
+void replay_close(void) {
+    uint64_t used;
+    
+    if (g_mode == REPLAY_OFF) return;
+    
+    if (g_mode == REPLAY_RECORDING) {
+        used = g_log->next < g_log->capacity ? g_log->next : g_log->capacity;
+        munmap(g_log, g_log_size);
+        if (ftruncate(g_log_fd, (off_t)(sizeof(ReplayHeader) + used * sizeof(ReplayRecord))) != 0) {
+            perror("Failed to trim recording");
+        }
+        close(g_log_fd);
+        g_log_fd = -1;
+    } else {
+        munmap(g_log, g_log_size);
+        munmap(g_progress, sizeof(ReplayProgress));
+        g_progress = NULL;
+    }
+    
+    g_mode = REPLAY_OFF;
+    g_log = NULL;
+    g_log_size = 0;
+    g_shared = NULL;
+}
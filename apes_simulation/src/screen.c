@@ -0,0 +1,310 @@
+/*
+ * screen.c
+ * Frame-buffer terminal renderer: diffs frames and sends one write each
+ */
+
+#include "local.h"
+
+/* One terminal column; a wide glyph's second column is a continuation
+ * cell (width 0). Fully assigned, padding included, so cells compare
+ * with memcmp */
+typedef struct {
+    char glyph[4];                      // UTF-8 bytes
+    uint8_t len;                        // Bytes used in glyph
+    uint8_t width;                      // Terminal columns: 1, 2 or 0 (continuation)
+    uint8_t color;                      // SCREEN_*
+    uint8_t pad;
+} ScreenCell;
+
+struct Screen {
+    int fd;
+    int cols;                           // Grid width
+    int max_rows;                       // Rows a frame may use
+    int cap_rows;                       // Rows allocated in both grids
+    int used_rows;                      // Rows written in the frame being composed
+    ScreenCell* cells;                  // Frame being composed
+    ScreenCell* shown;                  // Frame on the terminal
+    int row, col;                       // Compose cursor
+    int repaint;                        // 1 = shown is unknown, clear and redraw
+    char* out;                          // Update sent by screen_flush()
+    size_t out_len, out_cap;
+};
+
+/* Indexed by SCREEN_* */
+static const char* screen_sgr[SCREEN_NUM_COLORS] = {
+    "\033[0m",
+    "\033[0;91m",
+    "\033[0;92m",
+    "\033[0;94m",
+    "\033[0;95m",
+    "\033[0;96m",
+    "\033[0;93m",
+    "\033[0;47m",
+};
+
+static const ScreenCell blank_cell = { { ' ', 0, 0, 0 }, 1, 1, SCREEN_PLAIN, 0 };
+
+/* ==================== Grid ==================== */
+
+static void blank_rows(ScreenCell* cells, int cols, int from_row, int to_row) {
+    size_t i;
+    
+    for (i = (size_t)from_row * cols; i < (size_t)to_row * cols; i++) {
+        cells[i] = blank_cell;
+    }
+}
+
+/*
+ * Make room for row in both grids; new rows are blank on the terminal too
+ * Returns 0 on success, -1 if out of memory
+ */
+static int grow_rows(Screen* screen, int row) {
+    int cap = screen->cap_rows > 0 ? screen->cap_rows : 64;
+    ScreenCell* cells;
+    ScreenCell* shown;
+    
+    while (cap <= row) cap *= 2;
+    if (cap > screen->max_rows) cap = screen->max_rows;
+    
+    cells = realloc(screen->cells, (size_t)cap * screen->cols * sizeof(ScreenCell));
+    if (cells == NULL) return -1;
+    screen->cells = cells;
+    shown = realloc(screen->shown, (size_t)cap * screen->cols * sizeof(ScreenCell));
+    if (shown == NULL) return -1;
+    screen->shown = shown;
+    
+    blank_rows(screen->cells, screen->cols, screen->cap_rows, cap);
+    blank_rows(screen->shown, screen->cols, screen->cap_rows, cap);
+    screen->cap_rows = cap;
+    return 0;
+}
+
+/*
+ * Size the grid to the terminal (or the defaults when fd is not one)
+ */
+static void fit_terminal(Screen* screen) {
+    struct winsize ws;
+    int cols = SCREEN_DEFAULT_COLS;
+    int max_rows = SCREEN_MAX_ROWS;
+    
+    if (ioctl(screen->fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 1) {
+        cols = ws.ws_col;
+        max_rows = ws.ws_row - 1;       /* Keep the last line free: no scrolling */
+    }
+    if (cols == screen->cols && max_rows == screen->max_rows) return;
+    
+    free(screen->cells);
+    free(screen->shown);
+    screen->cells = NULL;
+    screen->shown = NULL;
+    screen->cap_rows = 0;
+    screen->cols = cols;
+    screen->max_rows = max_rows;
+    screen->repaint = 1;
+}
+
+/*
+ * Columns a code point takes: the emoji blocks are double width, every
+ * other glyph the display uses is single width
+ */
+static int glyph_width(uint32_t code) {
+    return (code >= 0x1F300 && code <= 0x1FAFF) ? 2 : 1;
+}
+
+/*
+ * Place one glyph at the compose cursor
+ */
+static void put_glyph(Screen* screen, const char* bytes, int len, int width, int color) {
+    ScreenCell* cell;
+    
+    if (screen->row >= screen->max_rows || screen->col + width > screen->cols) return;
+    if (screen->row >= screen->cap_rows && grow_rows(screen, screen->row) != 0) return;
+    
+    cell = &screen->cells[(size_t)screen->row * screen->cols + screen->col];
+    *cell = blank_cell;
+    memcpy(cell->glyph, bytes, len);
+    cell->len = (uint8_t)len;
+    cell->width = (uint8_t)width;
+    cell->color = (uint8_t)color;
+    if (width == 2) {
+        cell[1] = blank_cell;
+        cell[1].len = 0;
+        cell[1].width = 0;
+        cell[1].color = (uint8_t)color;
+    }
+    
+    screen->col += width;
+    if (screen->row + 1 > screen->used_rows) screen->used_rows = screen->row + 1;
+}
+
+/* ==================== Output Buffer ==================== */
+
+static void out_append(Screen* screen, const char* bytes, size_t len) {
+    if (screen->out_len + len > screen->out_cap) {
+        size_t cap = screen->out_cap > 0 ? screen->out_cap : 4096;
+        char* out;
+    
+        while (cap < screen->out_len + len) cap *= 2;
+        out = realloc(screen->out, cap);
+        if (out == NULL) return;
+        screen->out = out;
+        screen->out_cap = cap;
+    }
+    memcpy(screen->out + screen->out_len, bytes, len);
+    screen->out_len += len;
+}
+
+static void out_move(Screen* screen, int row, int col) {
+    char seq[32];
+    int len = snprintf(seq, sizeof(seq), "\033[%d;%dH", row + 1, col + 1);
+    
+    out_append(screen, seq, (size_t)len);
+}
+
+/* ==================== Public API ==================== */
+
+Screen* screen_create(int fd) {
+    Screen* screen = calloc(1, sizeof(Screen));
+    
+    if (screen == NULL) return NULL;
+    screen->fd = fd;
+    fit_terminal(screen);
+    return screen;
+}
+
+void screen_destroy(Screen* screen) {
+    if (screen == NULL) return;
+    free(screen->cells);
+    free(screen->shown);
+    free(screen->out);
+    free(screen);
+}
+
+void screen_begin(Screen* screen) {
+    fit_terminal(screen);
+    blank_rows(screen->cells, screen->cols, 0, screen->cap_rows);
+    screen->used_rows = 0;
+    screen->row = 0;
+    screen->col = 0;
+}
+
+void screen_printf(Screen* screen, int color, const char* format, ...) {
+    char text[1024];
+    va_list args;
+    int len, i, k;
+    
+    va_start(args, format);
+    len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len < 0) return;
+    if (len >= (int)sizeof(text)) len = (int)sizeof(text) - 1;
+    
+    for (i = 0; i < len; ) {
+        unsigned char lead = (unsigned char)text[i];
+        uint32_t code = lead;
+        int bytes = 1;
+    
+        if (lead == '\n') {
+            screen->row++;
+            screen->col = 0;
+            i++;
+            continue;
+        }
+        if (lead < 0x20) {
+            i++;
+            continue;
+        }
+    
+        /* Decode one UTF-8 sequence (malformed bytes pass through alone) */
+        if (lead >= 0xF0) {
+            bytes = 4;
+            code = lead & 0x07;
+        } else if (lead >= 0xE0) {
+            bytes = 3;
+            code = lead & 0x0F;
+        } else if (lead >= 0xC0) {
+            bytes = 2;
+            code = lead & 0x1F;
+        }
+        if (i + bytes > len) bytes = len - i;
+        for (k = 1; k < bytes; k++) {
+            code = (code << 6) | ((unsigned char)text[i + k] & 0x3F);
+        }
+    
+        put_glyph(screen, text + i, bytes, glyph_width(code), color);
+        i += bytes;
+    }
+}
+
+void screen_invalidate(Screen* screen) {
+    screen->repaint = 1;
+}
+
+long screen_flush(Screen* screen) {
+    int cur_row = -1, cur_col = -1;
+    int color = SCREEN_PLAIN;
+    int changed = 0;
+    int row, col;
+    
+    screen->out_len = 0;
+    if (screen->repaint) {
+        out_append(screen, "\033[0m\033[H\033[2J", 11);
+        blank_rows(screen->shown, screen->cols, 0, screen->cap_rows);
+        screen->repaint = 0;
+        changed = 1;
+    }
+    
+    for (row = 0; row < screen->cap_rows; row++) {
+        ScreenCell* next = &screen->cells[(size_t)row * screen->cols];
+        ScreenCell* prev = &screen->shown[(size_t)row * screen->cols];
+    
+        if (memcmp(next, prev, (size_t)screen->cols * sizeof(ScreenCell)) == 0) continue;
+    
+        for (col = 0; col < screen->cols; col++) {
+            const ScreenCell* cell = &next[col];
+    
+            if (cell->width == 0) continue;  /* Sent with its wide glyph */
+            if (memcmp(cell, &prev[col], cell->width * sizeof(ScreenCell)) == 0) continue;
+    
+            if (row != cur_row || col != cur_col) out_move(screen, row, col);
+            if (cell->color != color) {
+                color = cell->color;
+                out_append(screen, screen_sgr[color], strlen(screen_sgr[color]));
+            }
+            out_append(screen, cell->glyph, cell->len);
+            cur_row = row;
+            cur_col = col + cell->width;
+        }
+        memcpy(prev, next, (size_t)screen->cols * sizeof(ScreenCell));
+        changed = 1;
+    }
+    
+    if (!changed) return 0;
+    
+    /* Leave the terminal plain, with the cursor below the frame */
+    if (color != SCREEN_PLAIN) {
+        out_append(screen, screen_sgr[SCREEN_PLAIN], strlen(screen_sgr[SCREEN_PLAIN]));
+    }
+    out_move(screen, screen->used_rows, 0);
+    
+    /* Keep earlier stdio output ahead of the frame */
+    fflush(stdout);
+    
+    {
+        const char* bytes = screen->out;
+        size_t left = screen->out_len;
+    
+        while (left > 0) {
+            ssize_t written = write(screen->fd, bytes, left);
+    
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                screen->repaint = 1;
+                return -1;
+            }
+            bytes += written;
+            left -= (size_t)written;
+        }
+    }
+    return (long)screen->out_len;
+}
@@ -1,190 +1,161 @@
 /*
  * sem_wrapper.c
- * Cross-platform semaphore implementation
+ * Cross-platform process-shared mutex and event channel implementation
  */
 
 #include "local.h"
 
-#ifdef __APPLE__
-/* Named semaphore storage for macOS */
-sem_t* maze_lock_ptrs[MAX_ROWS][MAX_COLS];
-sem_t* basket_lock_ptrs[MAX_FAMILIES];
-sem_t* global_lock_ptr = NULL;
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#else
+#include <sched.h>
+#endif
 
-int init_simulation_semaphores(void* shared_data_ptr, int num_families, int rows, int cols) {
-    char sem_name[64];
-    int i, j;
-    
-    (void)shared_data_ptr;  /* Unused on macOS */
-    
-    /* Initialize global lock */
-    snprintf(sem_name, sizeof(sem_name), "/apes_global_%d", getpid());
-    sem_unlink(sem_name);  /* Remove if exists from previous run */
-    global_lock_ptr = sem_open(sem_name, O_CREAT | O_EXCL, 0644, 1);
-    if (global_lock_ptr == SEM_FAILED) {
-        perror("Failed to create global semaphore");
-        return -1;
-    }
-    
-    /* Initialize basket locks */
-    for (i = 0; i < num_families; i++) {
-        snprintf(sem_name, sizeof(sem_name), "/apes_basket_%d_%d", getpid(), i);
-        sem_unlink(sem_name);
-        basket_lock_ptrs[i] = sem_open(sem_name, O_CREAT | O_EXCL, 0644, 1);
-        if (basket_lock_ptrs[i] == SEM_FAILED) {
-            perror("Failed to create basket semaphore");
-            return -1;
-        }
-    }
-    
-    /* Initialize maze locks */
-    for (i = 0; i < rows; i++) {
-        for (j = 0; j < cols; j++) {
-            snprintf(sem_name, sizeof(sem_name), "/apes_maze_%d_%d_%d", getpid(), i, j);
-            sem_unlink(sem_name);
-            maze_lock_ptrs[i][j] = sem_open(sem_name, O_CREAT | O_EXCL, 0644, 1);
-            if (maze_lock_ptrs[i][j] == SEM_FAILED) {
-                perror("Failed to create maze semaphore");
-                return -1;
-            }
-        }
-    }
-    
-    return 0;
-}
+/* ==================== Platform Helpers ==================== */
 
-void cleanup_simulation_semaphores(int num_families, int rows, int cols) {
-    char sem_name[64];
-    int i, j;
-    
-    /* Close and unlink global lock */
-    if (global_lock_ptr != NULL) {
-        sem_close(global_lock_ptr);
-        snprintf(sem_name, sizeof(sem_name), "/apes_global_%d", getpid());
-        sem_unlink(sem_name);
-    }
-    
-    /* Close and unlink basket locks */
-    for (i = 0; i < num_families; i++) {
-        if (basket_lock_ptrs[i] != NULL) {
-            sem_close(basket_lock_ptrs[i]);
-            snprintf(sem_name, sizeof(sem_name), "/apes_basket_%d_%d", getpid(), i);
-            sem_unlink(sem_name);
-        }
-    }
-    
-    /* Close and unlink maze locks */
-    for (i = 0; i < rows; i++) {
-        for (j = 0; j < cols; j++) {
-            if (maze_lock_ptrs[i][j] != NULL) {
-                sem_close(maze_lock_ptrs[i][j]);
-                snprintf(sem_name, sizeof(sem_name), "/apes_maze_%d_%d_%d", getpid(), i, j);
-                sem_unlink(sem_name);
-            }
-        }
-    }
+/* Hint to the CPU that we are busy-waiting */
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
 }
 
-int sem_wait_wrapper(sem_t* sem, int row, int col, int is_maze) {
-    (void)sem;  /* Unused on macOS */
-    if (is_maze) {
-        return sem_wait(maze_lock_ptrs[row][col]);
-    }
-    return -1;
+#ifdef __linux__
+/*
+ * Shared (not FUTEX_PRIVATE) futexes: waiters may be in other processes
+ * mapping the same segment
+ */
+static void futex_wait(uint32_t* addr, uint32_t expected) {
+    syscall(SYS_futex, addr, FUTEX_WAIT, expected, NULL, NULL, 0);
 }
 
-int sem_post_wrapper(sem_t* sem, int row, int col, int is_maze) {
-    (void)sem;  /* Unused on macOS */
-    if (is_maze) {
-        return sem_post(maze_lock_ptrs[row][col]);
-    }
-    return -1;
+static void futex_wake_one(uint32_t* addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
 }
 
-int sem_wait_basket(sem_t* sem, int family_id) {
-    (void)sem;  /* Unused on macOS */
-    return sem_wait(basket_lock_ptrs[family_id]);
+static void futex_wake_all(uint32_t* addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
 }
-
-int sem_post_basket(sem_t* sem, int family_id) {
-    (void)sem;  /* Unused on macOS */
-    return sem_post(basket_lock_ptrs[family_id]);
+#else
+/* No portable futex: give up the CPU and let the caller re-check */
+static void futex_wait(uint32_t* addr, uint32_t expected) {
+    (void)addr; (void)expected;
+    sched_yield();
 }
 
-int sem_wait_global(sem_t* sem) {
-    (void)sem;  /* Unused on macOS */
-    return sem_wait(global_lock_ptr);
+static void futex_wake_one(uint32_t* addr) {
+    (void)addr;
 }
 
-int sem_post_global(sem_t* sem) {
-    (void)sem;  /* Unused on macOS */
-    return sem_post(global_lock_ptr);
+static void futex_wake_all(uint32_t* addr) {
+    (void)addr;
 }
+#endif
 
-#else
-/* Linux: Use unnamed semaphores directly */
+/* ==================== Mutex ==================== */
 
-int init_simulation_semaphores(void* shared_data_ptr, int num_families, int rows, int cols) {
-    SharedData* shared = (SharedData*)shared_data_ptr;
-    int i, j;
+int sim_mutex_init(sim_mutex_t* mutex) {
+    mutex->state = 0;
+    mutex->spin = 0;
+    return 0;
+}
+
+void sim_mutex_lock(sim_mutex_t* mutex) {
+    uint32_t c = 0;
+    int32_t spin;
+    int max_spin, i;
     
-    /* Initialize global lock */
-    if (sem_init(&shared->global_lock, 1, 1) != 0) {
-        perror("Failed to init global semaphore");
-        return -1;
+    /* Fast path: uncontended acquire */
+    if (__atomic_compare_exchange_n(&mutex->state, &c, 1, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
     }
     
-    /* Initialize basket locks */
-    for (i = 0; i < num_families; i++) {
-        if (sem_init(&shared->basket_locks[i], 1, 1) != 0) {
-            perror("Failed to init basket semaphore");
-            return -1;
-        }
-    }
+    /* Adaptive spin: the holder usually releases within a few hundred
+     * cycles, so try a little longer than it took last time */
+    spin = __atomic_load_n(&mutex->spin, __ATOMIC_RELAXED);
+    max_spin = 2 * spin + 10;
+    if (max_spin > SIM_MUTEX_MAX_SPIN) max_spin = SIM_MUTEX_MAX_SPIN;
     
-    /* Initialize maze locks */
-    for (i = 0; i < rows; i++) {
-        for (j = 0; j < cols; j++) {
-            sem_init(&shared->maze_locks[i][j], 1, 1);
+    for (i = 0; i < max_spin; i++) {
+        cpu_relax();
+        c = 0;
+        if (__atomic_load_n(&mutex->state, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&mutex->state, &c, 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&mutex->spin, spin + (i - spin) / 8, __ATOMIC_RELAXED);
+            return;
         }
     }
+    __atomic_store_n(&mutex->spin, spin + (max_spin - spin) / 8, __ATOMIC_RELAXED);
     
-    return 0;
+    /* Slow path: mark the lock contended and sleep until it is released */
+    c = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    while (c != 0) {
+        futex_wait(&mutex->state, 2);
+        c = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
 }
 
-void cleanup_simulation_semaphores(int num_families, int rows, int cols) {
-    /* Linux cleanup handled elsewhere */
-    (void)num_families;
-    (void)rows;
-    (void)cols;
+void sim_mutex_unlock(sim_mutex_t* mutex) {
+    /* Only pay for a wake syscall when someone may be sleeping */
+    if (__atomic_exchange_n(&mutex->state, 0, __ATOMIC_RELEASE) == 2) {
+        futex_wake_one(&mutex->state);
+    }
 }
 
-int sem_wait_wrapper(sem_t* sem, int row, int col, int is_maze) {
-    (void)row; (void)col; (void)is_maze;
-    return sem_wait(sem);
-}
+/* ==================== Event Channel ==================== */
 
-int sem_post_wrapper(sem_t* sem, int row, int col, int is_maze) {
-    (void)row; (void)col; (void)is_maze;
-    return sem_post(sem);
+void sim_event_init(sim_event_t* event) {
+    event->generation = 0;
+    event->waiters = 0;
 }
 
-int sem_wait_basket(sem_t* sem, int family_id) {
-    (void)family_id;
-    return sem_wait(sem);
+uint32_t sim_event_read(const sim_event_t* event) {
+    return __atomic_load_n(&event->generation, __ATOMIC_ACQUIRE);
 }
 
-int sem_post_basket(sem_t* sem, int family_id) {
-    (void)family_id;
-    return sem_post(sem);
+void sim_event_wait(sim_event_t* event, uint32_t seen) {
+    __atomic_fetch_add(&event->waiters, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&event->generation, __ATOMIC_SEQ_CST) == seen) {
+        futex_wait(&event->generation, seen);
+    }
+    __atomic_fetch_sub(&event->waiters, 1, __ATOMIC_RELAXED);
 }
 
-int sem_wait_global(sem_t* sem) {
-    return sem_wait(sem);
+void sim_event_signal(sim_event_t* event) {
+    __atomic_fetch_add(&event->generation, 1, __ATOMIC_SEQ_CST);
+    
+    /* Only pay for a wake syscall when someone may be sleeping */
+    if (__atomic_load_n(&event->waiters, __ATOMIC_SEQ_CST) != 0) {
+        futex_wake_all(&event->generation);
+    }
 }
 
-int sem_post_global(sem_t* sem) {
-    return sem_post(sem);
-}
+/* ==================== Simulation Locks ==================== */
 
-#endif
+int init_simulation_locks(void* shared_data_ptr, int num_families, int num_stripes) {
+    SharedData* shared = (SharedData*)shared_data_ptr;
+    sim_mutex_t* stripes = (sim_mutex_t*)((char*)shared + shared->maze_locks_offset);
+    int i;
+    
+    /* Initialize global lock */
+    sim_mutex_init(&shared->global_lock);
+    sim_mutex_init(&shared->banana_field_lock);
+    
+    /* Initialize basket locks and family event channels */
+    for (i = 0; i < num_families; i++) {
+        sim_mutex_init(basket_lock(shared, i));
+        sim_event_init(family_event(shared, i));
+    }
+    
+    /* Initialize maze lock stripes */
+    for (i = 0; i < num_stripes; i++) {
+        sim_mutex_init(&stripes[i]);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * sim_clock.c
+ * Discrete-event clock: real-time sleeps or a shared virtual timeline
+ */
+
+#include "local.h"
+
+/* Pool execution: due actors are handed to this instead of being woken */
+static void (*g_release)(int actor, void* arg) = NULL;
+static void* g_release_arg = NULL;
+
+/* ==================== Wakeup Heap ==================== */
+
+static int entry_before(const ClockEntry* a, const ClockEntry* b) {
+    if (a->wake_ms != b->wake_ms) return a->wake_ms < b->wake_ms;
+    return a->actor < b->actor;
+}
+
+static void heap_push(SharedData* shared, long long wake_ms, int actor) {
+    SimClock* clock = &shared->clock;
+    ClockEntry* heap = clock_heap(shared);
+    int i = clock->heap_size++;
+
+    heap[i].wake_ms = wake_ms;
+    heap[i].actor = actor;
+
+    /* Sift up */
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!entry_before(&heap[i], &heap[parent])) break;
+
+        ClockEntry tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static ClockEntry heap_pop(SharedData* shared) {
+    SimClock* clock = &shared->clock;
+    ClockEntry* heap = clock_heap(shared);
+    ClockEntry top = heap[0];
+    int i = 0;
+
+    heap[0] = heap[--clock->heap_size];
+
+    /* Sift down */
+    for (;;) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int smallest = i;
+
+        if (left < clock->heap_size && entry_before(&heap[left], &heap[smallest])) {
+            smallest = left;
+        }
+        if (right < clock->heap_size && entry_before(&heap[right], &heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) break;
+
+        ClockEntry tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+
+    return top;
+}
+
+/*
+ * Jump to the earliest pending wakeup and release every actor due then
+ * Serial clocks release only the first one: the rest follow, in actor
+ * order, each time the running actor parks again or exits
+ * Caller holds clock->lock and has checked that all actors are waiting,
+ * which is also the one moment a checkpoint can be taken
+ */
+static void advance_clock(SharedData* shared) {
+    SimClock* clock = &shared->clock;
+    
+    if (clock->heap_size == 0) return;
+    checkpoint_poll(shared);
+    
+    long long next = clock_heap(shared)[0].wake_ms;
+    __atomic_store_n(&clock->now_ms, next, __ATOMIC_RELEASE);
+    
+    while (clock->heap_size > 0 && clock_heap(shared)[0].wake_ms == next) {
+        ClockEntry entry = heap_pop(shared);
+        clock->num_waiting--;
+        if (g_release != NULL) {
+            g_release(entry.actor, g_release_arg);
+        } else {
+            sem_post(clock_wake(shared, entry.actor));
+        }
+        if (clock->serial) break;
+    }
+}
+
+/* ==================== Public API ==================== */
+
+int init_sim_clock(SharedData* shared, int mode, int num_actors) {
+    SimClock* clock = &shared->clock;
+    int i;
+
+    /* Deterministic mode is the virtual clock with one actor running at a time */
+    clock->mode = (mode == TIME_MODE_DETERMINISTIC) ? TIME_MODE_VIRTUAL : mode;
+    clock->serial = (mode == TIME_MODE_DETERMINISTIC);
+    clock->now_ms = 0;
+    clock->num_actors = num_actors;
+    clock->num_waiting = 0;
+    clock->heap_size = 0;
+
+    sim_mutex_init(&clock->lock);
+
+    for (i = 0; i < num_actors; i++) {
+        if (sem_init(clock_wake(shared, i), 1, 0) != 0) {
+            perror("Failed to init actor wakeup semaphore");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void cleanup_sim_clock(SharedData* shared) {
+    int i;
+
+    for (i = 0; i < sim_actor_slots(shared); i++) {
+        sem_destroy(clock_wake(shared, i));
+    }
+}
+
+int parse_time_mode(const char* name) {
+    if (strcmp(name, "real") == 0) return TIME_MODE_REAL;
+    if (strcmp(name, "virtual") == 0) return TIME_MODE_VIRTUAL;
+    if (strcmp(name, "deterministic") == 0) return TIME_MODE_DETERMINISTIC;
+    return -1;
+}
+
+const char* time_mode_name(int mode) {
+    switch (mode) {
+        case TIME_MODE_REAL:          return "real";
+        case TIME_MODE_VIRTUAL:       return "virtual";
+        case TIME_MODE_DETERMINISTIC: return "deterministic";
+        default:                      return "unknown";
+    }
+}
+
+int sim_actor_id(const SharedData* shared, int family_id, int role) {
+    return 1 + family_id * shared->actors_per_family + role;
+}
+
+int sim_actor_slots(const SharedData* shared) {
+    return 1 + shared->num_families * shared->actors_per_family;
+}
+
+void sim_sleep_ms(SharedData* shared, int actor, int milliseconds) {
+    sim_park_ms(shared, actor, milliseconds, RESUME_LOOP, 0);
+}
+
+void sim_park_ms(SharedData* shared, int actor, int milliseconds, int resume, int resume_arg) {
+    SimClock* clock = &shared->clock;
+    ActorState* state = actor_state(shared, actor);
+    
+    if (clock->mode != TIME_MODE_VIRTUAL) {
+        sleep_ms(milliseconds);
+        return;
+    }
+    
+    /* Published before parking: a checkpoint only runs once all are parked */
+    random_get_state(state->rng);
+    state->resume = resume;
+    state->resume_arg = resume_arg;
+    
+    sim_mutex_lock(&clock->lock);
+    heap_push(shared, clock->now_ms + milliseconds, actor);
+    clock->num_waiting++;
+    if (clock->num_waiting == clock->num_actors) {
+        advance_clock(shared);
+    }
+    sim_mutex_unlock(&clock->lock);
+    
+    /* A pooled actor's next step is a task, not a blocked thread */
+    if (g_release != NULL) return;
+    
+    while (sem_wait(clock_wake(shared, actor)) != 0 && errno == EINTR) {
+        /* Retry if interrupted by a signal */
+    }
+}
+
+void sim_park_event(SharedData* shared, int actor, int resume,
+                    const uint32_t* generation, uint32_t seen) {
+    SimClock* clock = &shared->clock;
+    ActorState* state = actor_state(shared, actor);
+    
+    if (clock->mode != TIME_MODE_VIRTUAL) return;
+    
+    random_get_state(state->rng);
+    state->resume = resume;
+    state->resume_arg = 0;
+    
+    sim_mutex_lock(&clock->lock);
+    if (generation != NULL && __atomic_load_n(generation, __ATOMIC_ACQUIRE) != seen) {
+        /* The event fired since the caller checked: due right away */
+        heap_push(shared, clock->now_ms, actor);
+    } else {
+        state->event_wait = 1;
+    }
+    clock->num_waiting++;
+    if (clock->num_waiting == clock->num_actors) {
+        advance_clock(shared);
+    }
+    sim_mutex_unlock(&clock->lock);
+    
+    if (g_release != NULL) return;
+    
+    while (sem_wait(clock_wake(shared, actor)) != 0 && errno == EINTR) {
+        /* Retry if interrupted by a signal */
+    }
+}
+
+void sim_wake_actor(SharedData* shared, int actor) {
+    SimClock* clock = &shared->clock;
+    ActorState* state = actor_state(shared, actor);
+    
+    if (clock->mode != TIME_MODE_VIRTUAL) return;
+    
+    /* Still counted as waiting: it now just has a wakeup at this tick */
+    sim_mutex_lock(&clock->lock);
+    if (state->event_wait) {
+        state->event_wait = 0;
+        heap_push(shared, clock->now_ms, actor);
+    }
+    sim_mutex_unlock(&clock->lock);
+}
+
+int sim_actor_start(SharedData* shared, int actor) {
+    ActorState* state = actor_state(shared, actor);
+    int resume = state->resume;
+    
+    if (shared->restored) {
+        if (!state->live) return RESUME_EXITED;
+        if (shared->restore_rng) random_set_state(state->rng);
+        
+        /* Sleep out the wakeup pending at the checkpoint; like the serial
+         * start below, nobody runs until every actor has re-parked.
+         * Parking keeps the resume point for a checkpoint taken meanwhile */
+        if (state->event_wait) {
+            state->event_wait = 0;
+            sim_park_event(shared, actor, resume, NULL, 0);
+        } else {
+            sim_park_ms(shared, actor, (int)(state->wake_ms - shared->clock.now_ms),
+                        resume, state->resume_arg);
+        }
+        return resume;
+    }
+    
+    /* Park at the current tick: no actor runs until all have arrived,
+     * then they take their first turns in actor order */
+    if (shared->clock.serial) {
+        sim_sleep_ms(shared, actor, 0);
+    }
+    return RESUME_LOOP;
+}
+
+/*
+ * Pool execution: an actor's first step is due now, or in a restored run at
+ * the wakeup pending at the checkpoint (actors that had exited get none,
+ * actors parked on an event stay parked)
+ * Returns 1 if the actor waits on the clock, 0 if it had exited
+ * Caller holds clock->lock
+ */
+static int queue_first_step(SharedData* shared, int actor) {
+    const ActorState* state = actor_state(shared, actor);
+    
+    if (!shared->restored) {
+        heap_push(shared, shared->clock.now_ms, actor);
+    } else if (!state->live) {
+        return 0;
+    } else if (!state->event_wait) {
+        heap_push(shared, state->wake_ms, actor);
+    }
+    return 1;
+}
+
+void sim_clock_start_pool(SharedData* shared, void (*release)(int actor, void* arg), void* arg) {
+    SimClock* clock = &shared->clock;
+    int family, role;
+    
+    g_release = release;
+    g_release_arg = arg;
+    if (release == NULL) return;
+    
+    sim_mutex_lock(&clock->lock);
+    clock->num_waiting = queue_first_step(shared, ACTOR_MONITOR);
+    for (family = 0; family < shared->num_families; family++) {
+        for (role = 0; role < ROLE_BABY + shared->babies_per_family; role++) {
+            clock->num_waiting += queue_first_step(shared, sim_actor_id(shared, family, role));
+        }
+    }
+    if (clock->num_actors > 0 && clock->num_waiting == clock->num_actors) {
+        advance_clock(shared);
+    }
+    sim_mutex_unlock(&clock->lock);
+}
+
+void sim_actor_exit(SharedData* shared) {
+    SimClock* clock = &shared->clock;
+
+    if (clock->mode != TIME_MODE_VIRTUAL) return;
+
+    sim_mutex_lock(&clock->lock);
+    clock->num_actors--;
+    if (clock->num_actors > 0 && clock->num_waiting == clock->num_actors) {
+        advance_clock(shared);
+    }
+    sim_mutex_unlock(&clock->lock);
+}
+
+double sim_elapsed_seconds(const SharedData* shared) {
+    if (shared->clock.mode == TIME_MODE_VIRTUAL) {
+        return __atomic_load_n(&shared->clock.now_ms, __ATOMIC_ACQUIRE) / 1000.0;
+    }
+    return get_elapsed_seconds(shared->start_time);
+}
+
+long long sim_elapsed_ms(const SharedData* shared) {
+    if (shared->clock.mode == TIME_MODE_VIRTUAL) {
+        return __atomic_load_n(&shared->clock.now_ms, __ATOMIC_ACQUIRE);
+    }
+    return (long long)(get_elapsed_seconds(shared->start_time) * 1000.0);
+}
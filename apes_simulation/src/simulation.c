@@ -0,0 +1,643 @@
+/*
+ * simulation.c
+ * Setup, execution and teardown of a single simulation run
+ */
+
+#include "local.h"
+
+/* Alignment of the variable-length regions after SharedData (cache line) */
+#define SHM_REGION_ALIGN 64
+
+static size_t align_region(size_t offset) {
+    return (offset + SHM_REGION_ALIGN - 1) & ~(size_t)(SHM_REGION_ALIGN - 1);
+}
+
+/*
+ * Lay out the segment for the config's maze and families: SharedData, then
+ * the cells, the banana distance field, the cells' occupant list heads, the
+ * change counters and the striped cell lock table, then the per-family
+ * arrays, then the per-actor clock arrays, then the event ring, then the
+ * snapshot's families, females' cells, cells and change counters. Fills in
+ * layout's offsets and sizes.
+ * Returns the total size in bytes.
+ */
+static size_t shared_data_layout(const SimConfig* config, SharedData* layout) {
+    size_t cells = (size_t)config->maze_rows * (size_t)config->maze_cols;
+    size_t families = (size_t)config->num_families;
+    size_t babies = families * (size_t)config->babies_per_family;
+    size_t slots;
+    
+    memset(layout, 0, sizeof(SharedData));
+    layout->maze_rows = config->maze_rows;
+    layout->maze_cols = config->maze_cols;
+    layout->num_families = config->num_families;
+    layout->babies_per_family = config->babies_per_family;
+    layout->actors_per_family = 2 + config->babies_per_family;
+    slots = (size_t)sim_actor_slots(layout);
+    
+    layout->maze_offset = align_region(sizeof(SharedData));
+    layout->banana_dist_offset = align_region(layout->maze_offset + cells * sizeof(MazeCell));
+    layout->occupant_offset = align_region(layout->banana_dist_offset + cells * sizeof(int32_t));
+    layout->change_counts_offset = align_region(layout->occupant_offset + cells * sizeof(int32_t));
+    layout->maze_locks_offset = align_region(layout->change_counts_offset +
+                                             (size_t)(change_groups(layout) + change_blocks(layout)) *
+                                             sizeof(uint32_t));
+    layout->families_offset = align_region(layout->maze_locks_offset +
+                                           (size_t)config->maze_lock_stripes * sizeof(sim_mutex_t));
+    layout->baby_eaten_offset = align_region(layout->families_offset + families * sizeof(FamilyStatus));
+    layout->female_cell_offset = align_region(layout->baby_eaten_offset + babies * sizeof(int32_t));
+    layout->female_next_offset = align_region(layout->female_cell_offset + families * sizeof(int32_t));
+    layout->family_state_offset = align_region(layout->female_next_offset + families * sizeof(int32_t));
+    layout->baby_state_offset = align_region(layout->family_state_offset + families * sizeof(FamilyState));
+    layout->basket_locks_offset = align_region(layout->baby_state_offset + babies * sizeof(int32_t));
+    layout->family_events_offset = align_region(layout->basket_locks_offset +
+                                                families * sizeof(sim_mutex_t));
+    layout->actor_state_offset = align_region(layout->family_events_offset +
+                                              families * sizeof(sim_event_t));
+    layout->clock.heap_offset = align_region(layout->actor_state_offset + slots * sizeof(ActorState));
+    layout->clock.wake_offset = align_region(layout->clock.heap_offset + slots * sizeof(ClockEntry));
+    layout->events_offset = align_region(layout->clock.wake_offset + slots * sizeof(sem_t));
+    layout->snapshot.families_offset = align_region(layout->events_offset +
+                                                    (size_t)config->event_ring_capacity * sizeof(EventEntry));
+    layout->snapshot.female_cell_offset = align_region(layout->snapshot.families_offset +
+                                                       families * sizeof(FamilyStatus));
+    layout->snapshot.cells_offset = align_region(layout->snapshot.female_cell_offset +
+                                                 families * sizeof(int32_t));
+    layout->snapshot.change_counts_offset = align_region(layout->snapshot.cells_offset +
+                                                         cells * sizeof(SnapshotCell));
+    return layout->snapshot.change_counts_offset +
+           (size_t)(change_groups(layout) + change_blocks(layout)) * sizeof(uint32_t);
+}
+
+size_t shared_data_size(const SimConfig* config) {
+    SharedData layout;
+    
+    return shared_data_layout(config, &layout);
+}
+
+static int init_shared_data(Simulation* sim, int time_mode, const char* shm_name) {
+    const SimConfig* config = sim->config;
+    SharedData* shared;
+    SharedData layout;
+    int i;
+    
+    /* Create and map shared memory sized for this maze */
+    if (shm_name != NULL) {
+        safe_strcpy(sim->shm_name, shm_name, sizeof(sim->shm_name));
+    }
+    sim->shm_size = shared_data_layout(config, &layout);
+    shared = (SharedData*)create_shared_memory(shm_name, &sim->shm_size, config->shm_hugepages);
+    if (shared == NULL) {
+        fprintf(stderr, "Failed to create shared memory\n");
+        sim->shm_name[0] = '\0';
+        return -1;
+    }
+    sim->shared = shared;
+    
+    /* Initialize shared data: the region offsets and sizes come from the
+     * layout, as every accessor depends on them */
+    memset(shared, 0, sim->shm_size);
+    memcpy(shared, &layout, sizeof(SharedData));
+    shared->maze_lock_stripes = config->maze_lock_stripes;
+    shared->maze_rows = config->maze_rows;
+    shared->maze_cols = config->maze_cols;
+    
+    shared->withdrawn_count = 0;
+    shared->simulation_running = 1;
+    shared->termination_reason = TERM_RUNNING;
+    shared->winning_family = -1;
+    shared->termination_ms = -1;
+    shared->start_time = 0;  /* Will be set when simulation actually starts */
+    
+    /* Initialize process-shared locks */
+    if (init_simulation_locks(shared, config->num_families,
+                              config->maze_lock_stripes) != 0) {
+        fprintf(stderr, "Failed to initialize locks\n");
+        return -1;
+    }
+    
+    /* Event ring: zeroed slots (seq = 0) read as "not yet written" */
+    shared->event_capacity = config->event_ring_capacity;
+    shared->event_next = 0;
+    
+    /* No checkpoint until one is requested (see checkpoint.h) */
+    shared->checkpoint_at_ms = -1;
+    safe_strcpy(shared->checkpoint_path, "simulation.ckpt", sizeof(shared->checkpoint_path));
+    
+    /* Initialize clock: the monitor plus every family thread is an actor */
+    if (init_sim_clock(shared, time_mode, sim_actor_slots(shared)) != 0) {
+        fprintf(stderr, "Failed to initialize simulation clock\n");
+        return -1;
+    }
+    
+    /* Initialize family status */
+    for (i = 0; i < shared->num_families; i++) {
+        family_status(shared, i)->is_active = 0;
+        family_status(shared, i)->basket_bananas = 0;
+        family_status(shared, i)->male_fighting = 0;
+        *female_cell(shared, i) = -1;
+        *female_next(shared, i) = -1;
+    }
+    
+    log_event("Shared memory initialized (%s, %zu bytes)",
+              shm_name != NULL ? shm_name : "private", sim->shm_size);
+    
+    return 0;
+}
+
+/* ==================== Snapshot ==================== */
+
+/*
+ * Bump the snapshot counters of the block and group of cell
+ * Only the monitor writes them; readers load them atomically
+ */
+static void mark_snapshot_changed(SharedData* shared, int32_t cell) {
+    int block = cell >> CHANGE_BLOCK_SHIFT;
+    uint32_t* group_count = snapshot_change_count(shared, block >> CHANGE_GROUP_SHIFT);
+    uint32_t* block_count = snapshot_change_count(shared, change_groups(shared) + block);
+    
+    __atomic_store_n(group_count, *group_count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(block_count, *block_count + 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Move family f's female from cell old to cell to in the snapshot (-1 =
+ * not in the maze), keeping each cell's ape the lowest family there
+ */
+static void move_snapshot_female(SharedData* shared, int f, int32_t old, int32_t to) {
+    int cols = shared->maze_cols;
+    
+    *snapshot_female_cell(shared, f) = to;
+    if (old >= 0) {
+        SnapshotCell* left = snapshot_cell(shared, old / cols, old % cols);
+        
+        if (left->ape == f) {
+            left->ape = -1;
+            for (int g = 0; g < shared->num_families; g++) {
+                if (*snapshot_female_cell(shared, g) == old) {
+                    left->ape = g;
+                    break;
+                }
+            }
+        }
+        mark_snapshot_changed(shared, old);
+    }
+    if (to >= 0) {
+        SnapshotCell* entered = snapshot_cell(shared, to / cols, to % cols);
+        
+        if (entered->ape < 0 || f < entered->ape) entered->ape = f;
+        mark_snapshot_changed(shared, to);
+    }
+}
+
+/*
+ * Copy what the observers draw into the snapshot under its sequence lock:
+ * the run's status, every family, the females' cells and the bananas of
+ * the blocks whose live change counter moved since the last publish
+ */
+static void publish_snapshot(Simulation* sim) {
+    SharedData* shared = sim->shared;
+    Snapshot* snapshot = &shared->snapshot;
+    const MazeCell* cells = maze_cell(shared, 0, 0);
+    SnapshotCell* copies = snapshot_cell(shared, 0, 0);
+    int num_cells = shared->maze_rows * shared->maze_cols;
+    int groups = change_groups(shared);
+    int blocks = change_blocks(shared);
+    uint32_t* seen_blocks = sim->snapshot_seen + groups;
+    
+    /* Odd while the copy is under way; the fence keeps the copy after it */
+    __atomic_store_n(&snapshot->seq, snapshot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    
+    /* The generation first: anything it announces is in this copy or later */
+    snapshot->change_generation = __atomic_load_n(&shared->change_generation, __ATOMIC_ACQUIRE);
+    snapshot->elapsed_ms = sim_elapsed_ms(shared);
+    snapshot->simulation_running = shared->simulation_running;
+    snapshot->termination_reason = shared->termination_reason;
+    snapshot->withdrawn_count = shared->withdrawn_count;
+    snapshot->total_bananas_in_maze = shared->total_bananas_in_maze;
+    memcpy(snapshot_family(shared, 0), family_status(shared, 0),
+           sizeof(FamilyStatus) * (size_t)shared->num_families);
+    
+    for (int f = 0; f < shared->num_families; f++) {
+        int32_t old = *snapshot_female_cell(shared, f);
+        int32_t cell = __atomic_load_n(female_cell(shared, f), __ATOMIC_RELAXED);
+        
+        if (cell != old) move_snapshot_female(shared, f, old, cell);
+    }
+    
+    for (int g = 0; g < groups; g++) {
+        uint32_t count = __atomic_load_n(change_group(shared, g), __ATOMIC_ACQUIRE);
+        int last_block = (g + 1) << CHANGE_GROUP_SHIFT;
+        
+        if (count == sim->snapshot_seen[g]) continue;
+        sim->snapshot_seen[g] = count;
+        
+        if (last_block > blocks) last_block = blocks;
+        for (int b = g << CHANGE_GROUP_SHIFT; b < last_block; b++) {
+            int last_cell = (b + 1) << CHANGE_BLOCK_SHIFT;
+            
+            count = __atomic_load_n(change_block(shared, b), __ATOMIC_ACQUIRE);
+            if (count == seen_blocks[b]) continue;
+            seen_blocks[b] = count;
+            
+            if (last_cell > num_cells) last_cell = num_cells;
+            for (int c = b << CHANGE_BLOCK_SHIFT; c < last_cell; c++) {
+                copies[c].bananas = __atomic_load_n(&cells[c].bananas, __ATOMIC_RELAXED);
+            }
+            mark_snapshot_changed(shared, b << CHANGE_BLOCK_SHIFT);
+        }
+    }
+    
+    __atomic_store_n(&snapshot->seq, snapshot->seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Fill the snapshot from the maze as it is now and publish it the first
+ * time; until then its seq is 0 and readers wait
+ * Returns 0 on success, -1 if out of memory
+ */
+static int init_snapshot(Simulation* sim) {
+    SharedData* shared = sim->shared;
+    int num_counts = change_groups(shared) + change_blocks(shared);
+    int num_cells = shared->maze_rows * shared->maze_cols;
+    
+    sim->snapshot_seen = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)num_counts);
+    if (sim->snapshot_seen == NULL) {
+        fprintf(stderr, "Failed to allocate snapshot counters\n");
+        return -1;
+    }
+    
+    /* Counters before the copy: a cell that changes during it is copied
+     * again at the next publish */
+    for (int k = 0; k < num_counts; k++) {
+        sim->snapshot_seen[k] = __atomic_load_n(change_group(shared, k), __ATOMIC_ACQUIRE);
+    }
+    for (int c = 0; c < num_cells; c++) {
+        snapshot_cell(shared, 0, 0)[c].bananas =
+            __atomic_load_n(&maze_cell(shared, 0, 0)[c].bananas, __ATOMIC_RELAXED);
+        snapshot_cell(shared, 0, 0)[c].ape = -1;
+    }
+    for (int f = 0; f < shared->num_families; f++) {
+        *snapshot_female_cell(shared, f) = -1;
+    }
+    
+    /* Places the females that are already in the maze (restored runs) */
+    publish_snapshot(sim);
+    return 0;
+}
+
+/* ==================== Monitor ==================== */
+
+/*
+ * One check of the monitor: publish the snapshot, then write any recorded
+ * frames that are due
+ * Returns 1 to check again after monitor_sleep_ms(), 0 once the run is over
+ */
+static int monitor_step(Simulation* sim) {
+    SharedData* shared = sim->shared;
+    const SimConfig* config = sim->config;
+    
+    /* Also once the run is over, so observers see how it ended */
+    publish_snapshot(sim);
+    if (!shared->simulation_running) return 0;
+    
+    frames_capture(shared);
+    
+    /* Check timeout (simulated seconds under virtual time) */
+    double elapsed = sim_elapsed_seconds(shared);
+    
+    if (elapsed >= config->max_simulation_time_seconds) {
+        sim_mutex_lock(&shared->global_lock);
+        if (shared->simulation_running) {
+            shared->simulation_running = 0;
+            shared->termination_reason = TERM_TIMEOUT;
+            /* The monitor checks every SNAPSHOT_INTERVAL_MS: report the limit, not the check */
+            shared->termination_ms = config->max_simulation_time_seconds * 1000LL;
+            log_event("TIMEOUT! Simulation time exceeded %d seconds",
+                     config->max_simulation_time_seconds);
+            trace_record(shared, TRACE_TERMINATE, -1, -1, -1, -1, -1, -1, TERM_TIMEOUT);
+        }
+        sim_mutex_unlock(&shared->global_lock);
+        wake_all_families(shared);
+        publish_snapshot(sim);
+        return 0;
+    }
+    
+    return 1;
+}
+
+/*
+ * Milliseconds until the monitor's next check: every SNAPSHOT_INTERVAL_MS,
+ * sooner when the frame recorder is due
+ */
+static int monitor_sleep_ms(const SharedData* shared) {
+    long due = frames_due_in_ms(shared);
+    
+    if (due < 0 || due >= SNAPSHOT_INTERVAL_MS) return SNAPSHOT_INTERVAL_MS;
+    return due > 0 ? (int)due : 1;
+}
+
+static void* monitor_thread(void* arg) {
+    Simulation* sim = (Simulation*)arg;
+    SharedData* shared = sim->shared;
+    
+    if (sim_actor_start(shared, ACTOR_MONITOR) == RESUME_EXITED) return NULL;
+    
+    while (monitor_step(sim)) {
+        sim_sleep_ms(shared, ACTOR_MONITOR, monitor_sleep_ms(shared));
+    }
+    
+    sim_actor_exit(shared);
+    return NULL;
+}
+
+/*
+ * Pool execution: the task of one clock actor
+ * Parking only queues the actor's next step, so none of this blocks
+ */
+static void run_actor_step(int actor, void* arg) {
+    Simulation* sim = (Simulation*)arg;
+    
+    if (actor == ACTOR_MONITOR) {
+        if (monitor_step(sim)) {
+            sim_sleep_ms(sim->shared, ACTOR_MONITOR, monitor_sleep_ms(sim->shared));
+        } else {
+            sim_actor_exit(sim->shared);
+        }
+        return;
+    }
+    
+    /* Inverse of sim_actor_id() */
+    run_family_step(&sim->families[(actor - 1) / sim->shared->actors_per_family],
+                    (actor - 1) % sim->shared->actors_per_family);
+}
+
+/*
+ * Pool execution: set up every family in this process and start the workers
+ * Returns 0 on success, -1 on failure
+ */
+static int start_pool(Simulation* sim) {
+    const SimConfig* config = sim->config;
+    int i;
+    
+    sim->families = (FamilyLocal*)calloc(config->num_families, sizeof(FamilyLocal));
+    if (sim->families == NULL) {
+        fprintf(stderr, "Failed to allocate memory for families\n");
+        return -1;
+    }
+    for (i = 0; i < config->num_families; i++) {
+        start_family_tasks(&sim->families[i], i, sim->shared, config);
+    }
+    
+    sim->pool = pool_start(sim->shared, config->pool_workers, run_actor_step, sim);
+    if (sim->pool == NULL) {
+        return -1;
+    }
+    return 0;
+}
+
+int init_simulation(Simulation* sim, const SimConfig* config, int time_mode, const char* shm_name) {
+    memset(sim, 0, sizeof(Simulation));
+    sim->config = config;
+
+    if (init_shared_data(sim, time_mode, shm_name) != 0) {
+        return -1;
+    }
+    
+    /* Seed before the maze is generated so a fixed seed gives a fixed maze;
+     * family threads derive their own streams from the same seed */
+    sim->shared->seed = (config->seed != 0) ? config->seed : make_random_seed();
+    seed_random(sim->shared->seed);
+    replay_attach(sim->shared);
+
+    init_maze(sim->shared, config);
+    
+    /* Open the trace before forking so every family inherits the mapping */
+    if (config->trace_file[0] != '\0' &&
+        trace_open(config->trace_file, (uint64_t)config->trace_max_records,
+                   sim->shared, config->babies_per_family) != 0) {
+        return -1;
+    }
+    
+    /* Frames are drawn and written by the monitor, in this process only */
+    if (config->frame_file[0] != '\0' &&
+        frames_open(config->frame_file, config->frame_format, config->frame_interval_ms,
+                    config->frame_cell_pixels, sim->shared) != 0) {
+        return -1;
+    }
+
+    /* Allocate child PID array */
+    sim->child_pids = (pid_t*)calloc(config->num_families, sizeof(pid_t));
+    if (sim->child_pids == NULL) {
+        fprintf(stderr, "Failed to allocate memory for child PIDs\n");
+        return -1;
+    }
+    
+    return 0;
+}
+
+int start_simulation(Simulation* sim) {
+    const SimConfig* config = sim->config;
+    int i;
+    
+    /* NOW set start_time - this is when the simulation truly begins
+     * (a restored run continues from the checkpoint's time) */
+    sim->shared->start_time = time(NULL) - (time_t)(sim->shared->clock.now_ms / 1000);
+    
+    /* Observers read the snapshot from here on */
+    if (init_snapshot(sim) != 0) {
+        return -1;
+    }
+    
+    if (config->execution_mode == EXEC_MODE_POOL) {
+        return start_pool(sim);
+    }
+    
+    /* Fork family processes */
+    for (i = 0; i < config->num_families; i++) {
+        pid_t pid = fork();
+        
+        if (pid < 0) {
+            perror("fork failed");
+            return -1;
+        }
+        
+        if (pid == 0) {
+            /* Child process - run family */
+            free(sim->child_pids);  /* Child doesn't need this */
+            sim->child_pids = NULL;
+            
+            run_family_process(i, sim->shared, config);
+            
+            /* Cleanup and exit child */
+            detach_shared_memory(sim->shared, sim->shm_size);
+            exit(0);
+        }
+        
+        /* Parent - save child PID */
+        sim->child_pids[i] = pid;
+        sim->num_children++;
+    }
+    
+    /* Start monitor thread */
+    if (pthread_create(&sim->monitor_tid, NULL, monitor_thread, sim) != 0) {
+        perror("Failed to create monitor thread");
+        return -1;
+    }
+    sim->monitor_started = 1;
+    
+    return 0;
+}
+
+void wait_simulation(Simulation* sim) {
+    int i;
+    
+    /* Pooled actors: the workers stop once the last one has exited */
+    if (sim->pool != NULL) {
+        pool_wait(sim->pool);
+        sim->pool = NULL;
+    }
+    
+    /* Wait for all child processes to finish */
+    for (i = 0; i < sim->num_children; i++) {
+        int status;
+        waitpid(sim->child_pids[i], &status, 0);
+        sim->child_pids[i] = 0;
+    }
+    
+    /* Stop monitor */
+    sim->shared->simulation_running = 0;
+    if (sim->monitor_started) {
+        pthread_join(sim->monitor_tid, NULL);
+        sim->monitor_started = 0;
+    }
+}
+
+void stop_simulation(Simulation* sim) {
+    int i;
+    
+    /* Stop simulation */
+    if (sim->shared != NULL) {
+        sim->shared->simulation_running = 0;
+        /* Real time only: under virtual time waking takes the clock lock,
+         * which a signal handler must not; each male wakes its babies
+         * when it next steps and exits */
+        if (sim->shared->clock.mode == TIME_MODE_REAL) {
+            wake_all_families(sim->shared);
+        }
+    }
+    
+    /* Pooled actors exit at their next step; wait without joining, as
+     * this may interrupt wait_simulation() */
+    if (sim->pool != NULL) {
+        while (!pool_finished(sim->pool)) {
+            sleep_ms(10);
+        }
+    }
+    
+    if (sim->child_pids == NULL) return;
+    
+    /* Kill child processes */
+    for (i = 0; i < sim->num_children; i++) {
+        if (sim->child_pids[i] > 0) {
+            kill(sim->child_pids[i], SIGTERM);
+        }
+    }
+    
+    /* Wait for children */
+    for (i = 0; i < sim->num_children; i++) {
+        if (sim->child_pids[i] > 0) {
+            waitpid(sim->child_pids[i], NULL, 0);
+            sim->child_pids[i] = 0;
+        }
+    }
+}
+
+double simulation_duration_seconds(const SharedData* shared) {
+    /* The clock keeps running while the actors drain after the stop */
+    if (shared->termination_ms >= 0) return shared->termination_ms / 1000.0;
+    return sim_elapsed_seconds(shared);
+}
+
+void collect_simulation_result(const Simulation* sim, SimResult* result) {
+    const SharedData* shared = sim->shared;
+    const SimConfig* config = sim->config;
+    int i, j;
+    int max_basket = 0;
+    
+    memset(result, 0, sizeof(SimResult));
+    result->seed = shared->seed;
+    result->completed = 1;
+    result->termination_reason = shared->termination_reason;
+    result->winning_family = shared->winning_family;
+    result->best_family = -1;
+    result->duration_seconds = simulation_duration_seconds(shared);
+    result->remaining_bananas = shared->total_bananas_in_maze;
+    result->withdrawn_count = shared->withdrawn_count;
+    result->num_families = shared->num_families;
+    
+    for (i = 0; i < shared->num_families; i++) {
+        const FamilyStatus* f = family_status(shared, i);
+        
+        if (i < SIM_RESULT_BASKETS) {
+            result->baskets[i] = f->basket_bananas;
+        }
+        for (j = 0; j < config->babies_per_family; j++) {
+            result->total_eaten += baby_bananas_eaten(shared, i)[j];
+        }
+        
+        /* Same rule as the final report: strictly largest basket wins */
+        if (f->basket_bananas > max_basket) {
+            max_basket = f->basket_bananas;
+            result->best_family = i;
+        }
+    }
+}
+
+void cleanup_simulation(Simulation* sim) {
+    SharedData* shared = sim->shared;
+    int i;
+    
+    trace_close();
+    frames_close();
+    
+    if (shared != NULL) {
+        cleanup_maze(shared);
+        
+        /* sim_mutex_t locks need no teardown; the clock still owns semaphores */
+        cleanup_sim_clock(shared);
+        
+        detach_shared_memory(shared, sim->shm_size);
+        sim->shared = NULL;
+    }
+    
+    if (sim->shm_name[0] != '\0') {
+        destroy_shared_memory(sim->shm_name);
+        sim->shm_name[0] = '\0';
+    }
+
+    free(sim->child_pids);
+    sim->child_pids = NULL;
+    free(sim->snapshot_seen);
+    sim->snapshot_seen = NULL;
+    
+    if (sim->families != NULL) {
+        for (i = 0; i < sim->config->num_families; i++) {
+            cleanup_family_local(&sim->families[i]);
+        }
+        free(sim->families);
+        sim->families = NULL;
+    }
+}
+
+const char* termination_reason_name(int reason) {
+    switch (reason) {
+        case TERM_RUNNING:             return "running";
+        case TERM_WITHDRAWN_THRESHOLD: return "withdrawn";
+        case TERM_BASKET_THRESHOLD:    return "basket";
+        case TERM_BABY_ATE_THRESHOLD:  return "baby_ate";
+        case TERM_TIMEOUT:             return "timeout";
+        default:                       return "unknown";
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * trace.c
+ * Binary event trace writer (memory-mapped, append-only)
+ */
+
+#include "local.h"
+
+/* Mapping of the open trace; inherited by the family processes */
+static TraceHeader* g_trace = NULL;
+static size_t g_trace_size = 0;
+static int g_trace_fd = -1;
+static struct timespec g_trace_start;
+
+int trace_open(const char* path, uint64_t max_records, const SharedData* shared,
+               int babies_per_family) {
+    TraceHeader* header;
+    size_t size;
+    int fd;
+    
+    if (g_trace != NULL) trace_close();
+    
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Failed to create trace file");
+        return -1;
+    }
+    
+    /* The file is sparse until written, so a generous capacity is cheap */
+    size = sizeof(TraceHeader) + (size_t)max_records * sizeof(TraceRecord);
+    if (ftruncate(fd, (off_t)size) != 0) {
+        perror("Failed to size trace file");
+        close(fd);
+        return -1;
+    }
+    
+    header = (TraceHeader*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) {
+        perror("Failed to map trace file");
+        close(fd);
+        return -1;
+    }
+    
+    memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+    header->version = TRACE_VERSION;
+    header->record_size = sizeof(TraceRecord);
+    header->capacity = max_records;
+    header->next = 0;
+    header->seed = shared->seed;
+    header->num_families = shared->num_families;
+    header->babies_per_family = babies_per_family;
+    header->maze_rows = shared->maze_rows;
+    header->maze_cols = shared->maze_cols;
+    header->time_mode = shared->clock.serial ? TIME_MODE_DETERMINISTIC : shared->clock.mode;
+    
+    clock_gettime(CLOCK_MONOTONIC, &g_trace_start);
+    g_trace = header;
+    g_trace_size = size;
+    g_trace_fd = fd;
+    
+    log_event("Tracing to %s (up to %llu records)", path, (unsigned long long)max_records);
+    return 0;
+}
+
+void trace_record(const SharedData* shared, int type, int family, int other, int baby,
+                  int row, int col, int amount, int value) {
+    TraceRecord* rec;
+    struct timespec now;
+    uint64_t slot, real_ns;
+    
+    if (g_trace == NULL) return;
+    
+    slot = __atomic_fetch_add(&g_trace->next, 1, __ATOMIC_RELAXED);
+    if (slot >= g_trace->capacity) return;  /* Full: counted in next, not stored */
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    real_ns = (uint64_t)(now.tv_sec - g_trace_start.tv_sec) * 1000000000ull +
+              (uint64_t)(now.tv_nsec - g_trace_start.tv_nsec);
+    
+    rec = (TraceRecord*)(g_trace + 1) + slot;
+    if (shared->clock.mode == TIME_MODE_VIRTUAL) {
+        rec->sim_time_us = __atomic_load_n(&shared->clock.now_ms, __ATOMIC_ACQUIRE) * 1000ull;
+    } else {
+        rec->sim_time_us = real_ns / 1000;
+    }
+    rec->real_time_ns = real_ns;
+    rec->family = family;
+    rec->other = other;
+    rec->baby = baby;
+    rec->row = row;
+    rec->col = col;
+    rec->amount = amount;
+    rec->value = value;
+    
+    /* Publish: a non-zero type marks the record complete */
+    __atomic_store_n(&rec->type, (uint8_t)type, __ATOMIC_RELEASE);
+}
+
+void trace_close(void) {
+    uint64_t used;
+    
+    if (g_trace == NULL) return;
+    
+    used = g_trace->next < g_trace->capacity ? g_trace->next : g_trace->capacity;
+    if (g_trace->next > g_trace->capacity) {
+        fprintf(stderr, "Warning: trace full, %llu records dropped\n",
+                (unsigned long long)(g_trace->next - g_trace->capacity));
+    }
+    
+    munmap(g_trace, g_trace_size);
+    if (ftruncate(g_trace_fd, (off_t)(sizeof(TraceHeader) + used * sizeof(TraceRecord))) != 0) {
+        perror("Failed to trim trace file");
+    }
+    close(g_trace_fd);
+    
+    g_trace = NULL;
+    g_trace_size = 0;
+    g_trace_fd = -1;
+}
@@ -0,0 +1,300 @@
+/*
+ * trace_tool.c
+ * apes_trace: decode, filter and summarise a binary event trace
+ *
+ * Usage: apes_trace <trace_file> [--summary] [--csv] [--type=name[,name...]]
+ *                   [--family=N] [--from=seconds] [--to=seconds] [--limit=N]
+ *
+ * The trace is mapped read-only, so even millions of records decode in a
+ * single pass without copying. Records still being written are skipped.
+ */
+
+#include "local.h"
+
+/* Per-family totals gathered by --summary */
+typedef struct {
+    long long events;
+    long long collected;
+    long long deposited;
+    long long female_fights_won, female_fights_lost;
+    long long female_fight_gain, female_fight_loss;
+    long long steals, stolen_bananas;
+    long long male_fights_won, male_fights_lost;
+    long long male_fight_gain, male_fight_loss;
+    long long baby_eaten, baby_given, lost_to_babies;
+} FamilyTotals;
+
+typedef struct {
+    int csv;
+    int summary;
+    int family;                         // -1 = all
+    double from, to;                    // Simulated seconds
+    long long limit;                    // -1 = no limit
+    unsigned int type_mask;             // Bit per TRACE_* type, 0 = all
+} TraceFilter;
+
+static void print_usage(const char* prog) {
+    int t;
+    
+    fprintf(stderr, "Usage: %s <trace_file> [--summary] [--csv] [--type=name[,name...]]\n"
+                    "       [--family=N] [--from=seconds] [--to=seconds] [--limit=N]\n", prog);
+    fprintf(stderr, "  Types:");
+    for (t = 1; t < TRACE_TYPE_COUNT; t++) {
+        fprintf(stderr, " %s", trace_type_name(t));
+    }
+    fprintf(stderr, "\n");
+}
+
+/*
+ * Parse a comma-separated list of type names into a bit mask
+ * Returns 0 on success, -1 on an unknown name
+ */
+static int parse_type_list(char* list, unsigned int* mask) {
+    char* name;
+    
+    for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+        int t;
+        
+        for (t = 1; t < TRACE_TYPE_COUNT; t++) {
+            if (strcmp(name, trace_type_name(t)) == 0) break;
+        }
+        if (t == TRACE_TYPE_COUNT) {
+            fprintf(stderr, "Unknown trace type '%s'\n", name);
+            return -1;
+        }
+        *mask |= 1u << t;
+    }
+    return 0;
+}
+
+static int record_matches(const TraceRecord* r, const TraceFilter* filter) {
+    double t = r->sim_time_us / 1e6;
+    
+    if (filter->type_mask != 0 && !(filter->type_mask & (1u << r->type))) return 0;
+    if (filter->family >= 0 && r->family != filter->family && r->other != filter->family) return 0;
+    if (t < filter->from || t > filter->to) return 0;
+    return 1;
+}
+
+static void print_record(const TraceRecord* r, int csv) {
+    if (csv) {
+        printf("%.3f,%.6f,%s,%d,%d,%d,%d,%d,%d,%d\n",
+               r->sim_time_us / 1e6, r->real_time_ns / 1e9, trace_type_name(r->type),
+               r->family, r->other, r->baby, r->row, r->col, r->amount, r->value);
+        return;
+    }
+    
+    printf("[t=%9.3fs] %-16s fam=%d", r->sim_time_us / 1e6, trace_type_name(r->type), r->family);
+    if (r->other >= 0) printf(" other=%d", r->other);
+    if (r->baby >= 0) printf(" baby=%d", r->baby);
+    if (r->row >= 0) printf(" cell=(%d,%d)", r->row, r->col);
+    if (r->amount >= 0) printf(" amount=%d", r->amount);
+    if (r->value >= 0) printf(" value=%d", r->value);
+    printf("\n");
+}
+
+static void add_to_totals(FamilyTotals* totals, int num_families, const TraceRecord* r) {
+    FamilyTotals* f;
+    FamilyTotals* o;
+    
+    if (r->family < 0 || r->family >= num_families) return;
+    f = &totals[r->family];
+    o = (r->other >= 0 && r->other < num_families) ? &totals[r->other] : NULL;
+    f->events++;
+    
+    switch (r->type) {
+        case TRACE_COLLECT:
+            f->collected += r->amount;
+            break;
+        case TRACE_DEPOSIT:
+            f->deposited += r->amount;
+            break;
+        case TRACE_FEMALE_FIGHT:
+            f->female_fights_won++;
+            f->female_fight_gain += r->amount;
+            if (o != NULL) {
+                o->female_fights_lost++;
+                o->female_fight_loss += r->amount;
+            }
+            break;
+        case TRACE_FEMALE_STEAL:
+            f->steals++;
+            f->stolen_bananas += r->amount;
+            if (o != NULL) o->female_fight_loss += r->amount;
+            break;
+        case TRACE_MALE_FIGHT:
+            f->male_fights_won++;
+            f->male_fight_gain += r->amount;
+            if (o != NULL) {
+                o->male_fights_lost++;
+                o->male_fight_loss += r->amount;
+            }
+            break;
+        case TRACE_BABY_EAT:
+            f->baby_eaten += r->amount;
+            if (o != NULL) o->lost_to_babies += r->amount;
+            break;
+        case TRACE_BABY_GIVE:
+            f->baby_given += r->amount;
+            if (o != NULL) o->lost_to_babies += r->amount;
+            break;
+        default:
+            break;
+    }
+}
+
+static void print_summary(const TraceHeader* header, const long long* type_counts,
+                          const FamilyTotals* totals, long long matched, long long incomplete) {
+    int i;
+    
+    printf("\nSUMMARY (%lld records", matched);
+    if (incomplete > 0) printf(", %lld incomplete", incomplete);
+    printf(")\n");
+    printf("------------------------------------------------------------------------------\n");
+    for (i = 1; i < TRACE_TYPE_COUNT; i++) {
+        if (type_counts[i] > 0) {
+            printf("  %-18s %10lld\n", trace_type_name(i), type_counts[i]);
+        }
+    }
+    
+    printf("\n%-4s %8s %8s %13s %13s %11s %13s %9s\n", "Fam", "Events", "Maze",
+           "Deposited", "F.fights W/L", "F.net", "M.fights W/L", "M.net");
+    for (i = 0; i < header->num_families; i++) {
+        const FamilyTotals* f = &totals[i];
+        
+        printf("%-4d %8lld %8lld %13lld %6lld/%-6lld %11lld %6lld/%-6lld %9lld\n",
+               i, f->events, f->collected, f->deposited,
+               f->female_fights_won, f->female_fights_lost,
+               f->female_fight_gain + f->stolen_bananas - f->female_fight_loss,
+               f->male_fights_won, f->male_fights_lost,
+               f->male_fight_gain - f->male_fight_loss);
+    }
+    
+    printf("\n%-4s %8s %10s %10s %14s\n", "Fam", "Steals", "Baby ate", "Baby gave", "Lost to babies");
+    for (i = 0; i < header->num_families; i++) {
+        const FamilyTotals* f = &totals[i];
+        
+        printf("%-4d %8lld %10lld %10lld %14lld\n",
+               i, f->steals, f->baby_eaten, f->baby_given, f->lost_to_babies);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    TraceFilter filter = { 0, 0, -1, 0.0, 1e300, -1, 0 };
+    long long type_counts[TRACE_TYPE_COUNT] = {0};
+    FamilyTotals* totals = NULL;
+    const TraceHeader* header;
+    const TraceRecord* records;
+    struct stat st;
+    uint64_t count, i;
+    long long matched = 0, incomplete = 0;
+    int fd, a;
+    
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    for (a = 2; a < argc; a++) {
+        if (strcmp(argv[a], "--summary") == 0) {
+            filter.summary = 1;
+        } else if (strcmp(argv[a], "--csv") == 0) {
+            filter.csv = 1;
+        } else if (strncmp(argv[a], "--type=", 7) == 0) {
+            if (parse_type_list(argv[a] + 7, &filter.type_mask) != 0) return 1;
+        } else if (strncmp(argv[a], "--family=", 9) == 0) {
+            filter.family = atoi(argv[a] + 9);
+        } else if (strncmp(argv[a], "--from=", 7) == 0) {
+            filter.from = atof(argv[a] + 7);
+        } else if (strncmp(argv[a], "--to=", 5) == 0) {
+            filter.to = atof(argv[a] + 5);
+        } else if (strncmp(argv[a], "--limit=", 8) == 0) {
+            filter.limit = atoll(argv[a] + 8);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    fd = open(argv[1], O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open trace file");
+        return 1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        fprintf(stderr, "%s: not a trace file (too short)\n", argv[1]);
+        close(fd);
+        return 1;
+    }
+    
+    header = (const TraceHeader*)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) {
+        perror("Failed to map trace file");
+        return 1;
+    }
+    
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != TRACE_VERSION || header->record_size != sizeof(TraceRecord) ||
+        header->num_families < 0) {
+        fprintf(stderr, "%s: not a version %d trace file\n", argv[1], TRACE_VERSION);
+        munmap((void*)header, (size_t)st.st_size);
+        return 1;
+    }
+    
+    /* A live or truncated trace may hold fewer slots than were reserved */
+    records = (const TraceRecord*)(header + 1);
+    count = ((size_t)st.st_size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+    if (header->next < count) count = header->next;
+    
+    if (!filter.csv) {
+        printf("# trace %s: seed=%u families=%d babies=%d maze=%dx%d time_mode=%s records=%llu",
+               argv[1], header->seed, header->num_families, header->babies_per_family,
+               header->maze_rows, header->maze_cols,
+               header->time_mode == TIME_MODE_REAL ? "real" :
+               header->time_mode == TIME_MODE_VIRTUAL ? "virtual" : "deterministic",
+               (unsigned long long)count);
+        if (header->next > count) {
+            printf(" dropped=%llu", (unsigned long long)(header->next - count));
+        }
+        printf("\n");
+    } else if (!filter.summary) {
+        printf("sim_time_s,real_time_s,type,family,other,baby,row,col,amount,value\n");
+    }
+    
+    if (filter.summary) {
+        totals = (FamilyTotals*)calloc((size_t)header->num_families + 1, sizeof(FamilyTotals));
+        if (totals == NULL) {
+            fprintf(stderr, "Failed to allocate family totals\n");
+            munmap((void*)header, (size_t)st.st_size);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        const TraceRecord* r = &records[i];
+        
+        if (r->type == TRACE_NONE || r->type >= TRACE_TYPE_COUNT) {
+            incomplete++;
+            continue;
+        }
+        if (!record_matches(r, &filter)) continue;
+        
+        matched++;
+        if (filter.summary) {
+            type_counts[r->type]++;
+            add_to_totals(totals, header->num_families, r);
+        } else {
+            print_record(r, filter.csv);
+            if (filter.limit >= 0 && matched >= filter.limit) break;
+        }
+    }
+    
+    if (filter.summary) {
+        print_summary(header, type_counts, totals, matched, incomplete);
+    }
+    
+    free(totals);
+    munmap((void*)header, (size_t)st.st_size);
+    return 0;
+}
@@ -2,18 +2,117 @@
 
 /* ==================== Random Functions ==================== */
 
-void init_random(void) {
-    srand(time(NULL) ^ getpid());
+/*
+ * xoshiro256** state, one per thread: no shared lock (unlike rand()) and
+ * every actor draws from its own reproducible stream
+ */
+static __thread uint64_t rng_state[4];
+
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t random_next(void) {
+    uint64_t* s = rng_state;
+    
+    /* A thread that was never seeded gets a fresh stream */
+    if ((s[0] | s[1] | s[2] | s[3]) == 0) {
+        seed_thread_random(make_random_seed(), -1, 0);
+    }
+    
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    
+    /* Record/replay sees (or supplies) every draw an actor makes */
+    return replay_rng(result);
+}
+
+/*
+ * Uniform integer in [0, range) without modulo bias (Lemire's method)
+ */
+static uint32_t random_below(uint32_t range) {
+    uint64_t m = (random_next() >> 32) * (uint64_t)range;
+    uint32_t low = (uint32_t)m;
+    
+    if (low < range) {
+        uint32_t threshold = (uint32_t)-range % range;
+        while (low < threshold) {
+            m = (random_next() >> 32) * (uint64_t)range;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+unsigned int make_random_seed(void) {
+    struct timespec ts;
+    uint64_t x;
+    unsigned int seed;
+    
+    clock_gettime(CLOCK_REALTIME, &ts);
+    x = ((uint64_t)ts.tv_sec << 32) ^ (uint64_t)ts.tv_nsec ^ ((uint64_t)getpid() << 16);
+    do {
+        seed = (unsigned int)splitmix64(&x);
+    } while (seed == 0);  /* 0 means "pick one" in the config */
+    
+    return seed;
+}
+
+void seed_thread_random(unsigned int seed, int family_id, int role) {
+    /* The (family, role) pair fills 64 bits and the splitmix64 finaliser is
+     * a bijection, so for one seed every actor gets a distinct input however
+     * many families and babies there are */
+    uint64_t key = ((uint64_t)((uint32_t)family_id + 1u) << 32) | ((uint32_t)role + 1u);
+    uint64_t mixed_seed = seed;
+    uint64_t x = splitmix64(&key) ^ splitmix64(&mixed_seed);
+    int i;
+    
+    for (i = 0; i < 4; i++) {
+        rng_state[i] = splitmix64(&x);
+    }
+}
+
+void seed_random(unsigned int seed) {
+    seed_thread_random(seed, -1, -1);
+}
+
+void random_get_state(uint64_t state[4]) {
+    memcpy(state, rng_state, sizeof(rng_state));
+}
+
+void random_set_state(const uint64_t state[4]) {
+    memcpy(rng_state, state, sizeof(rng_state));
 }
 
 int random_int(int min, int max) {
     if (min >= max) return min;
-    return min + rand() % (max - min + 1);
+    
+    /* Span fits in 32 bits; a full 2^32 span wraps to 0 */
+    uint32_t range = (uint32_t)((int64_t)max - (int64_t)min + 1);
+    if (range == 0) return (int)(uint32_t)(random_next() >> 32);
+    return (int)((int64_t)min + random_below(range));
 }
 
 float random_float(float min, float max) {
     if (min >= max) return min;
-    return min + (float)rand() / RAND_MAX * (max - min);
+    
+    /* 24 random bits: uniform in [0, 1) at float precision */
+    float unit = (float)(random_next() >> 40) * (1.0f / 16777216.0f);
+    return min + unit * (max - min);
 }
 
 int random_chance(float probability) {
@@ -40,131 +139,391 @@ void get_time_string(char* buffer, size_t size) {
 
 /* ==================== Logging Functions ==================== */
 
-static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * Asynchronous logger
+ * Each thread formats its lines into its own single-producer ring (no lock
+ * on the logging path); a writer thread per process drains every ring in
+ * batches with one writev() per flush.
+ */
+
+#define LOG_RING_SLOTS 256              // Lines per thread ring (power of two)
+#define LOG_LINE_MAX 256                // Bytes per line, including newline
+#define LOG_MAX_RINGS 64                // Threads per process with a ring
+#define LOG_BATCH_MAX 64                // Lines per writev()
+#define LOG_FLUSH_INTERVAL_MS 20        // Writer thread drain period
+
+typedef struct {
+    uint32_t len;
+    char text[LOG_LINE_MAX];
+} LogSlot;
+
+typedef struct {
+    uint64_t head;                      // Next slot to fill (owning thread)
+    char pad[56];                       // Keep producer and drainer on separate lines
+    uint64_t tail;                      // Next slot to write out (drainer)
+    LogSlot slots[LOG_RING_SLOTS];
+} LogRing;
+
+static LogRing* log_rings[LOG_MAX_RINGS];
+static int log_num_rings = 0;
+static __thread LogRing* log_my_ring = NULL;
+
+/* Cached timestamp: reformatted only when the second changes */
+static __thread time_t log_cached_sec = 0;
+static __thread char log_cached_time[16];
+
+static pthread_mutex_t log_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;   // Writer startup
+static pid_t log_writer_pid = 0;        // Process whose writer thread is running
+static int log_hooks_installed = 0;
+
+static const char* log_timestamp(void) {
+    struct timespec ts;
+    
+#ifdef CLOCK_REALTIME_COARSE
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+    if (ts.tv_sec != log_cached_sec || log_cached_time[0] == '\0') {
+        struct tm tm_info;
+        
+        log_cached_sec = ts.tv_sec;
+        localtime_r(&log_cached_sec, &tm_info);
+        strftime(log_cached_time, sizeof(log_cached_time), "%H:%M:%S", &tm_info);
+    }
+    return log_cached_time;
+}
 
-void log_event(const char* format, ...) {
-    char time_str[16];
-    va_list args;
+/*
+ * Write out everything pending in every ring
+ * Caller holds log_drain_lock
+ */
+static void log_drain_locked(void) {
+    struct iovec iov[LOG_BATCH_MAX];
+    LogRing* ring_of[LOG_BATCH_MAX];
+    int num_rings, n, i;
+    
+    num_rings = __atomic_load_n(&log_num_rings, __ATOMIC_ACQUIRE);
+    if (num_rings > LOG_MAX_RINGS) num_rings = LOG_MAX_RINGS;
+    
+    do {
+        n = 0;
+        
+        /* Gather pending lines from all rings into one batch */
+        for (i = 0; i < num_rings && n < LOG_BATCH_MAX; i++) {
+            LogRing* ring = __atomic_load_n(&log_rings[i], __ATOMIC_ACQUIRE);
+            uint64_t tail, head;
+            
+            if (ring == NULL) continue;
+            
+            tail = ring->tail;
+            head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            while (tail != head && n < LOG_BATCH_MAX) {
+                LogSlot* slot = &ring->slots[tail & (LOG_RING_SLOTS - 1)];
+                
+                iov[n].iov_base = slot->text;
+                iov[n].iov_len = slot->len;
+                ring_of[n] = ring;
+                n++;
+                tail++;
+            }
+        }
+        
+        if (n == 0) break;
+        
+        /* Keep stdio output (display, reports) ahead of newer log lines */
+        fflush(stdout);
+        
+        /* One system call for the whole batch; retry the rest on short writes */
+        {
+            struct iovec* v = iov;
+            int left = n;
+            
+            while (left > 0) {
+                ssize_t written = writev(STDOUT_FILENO, v, left);
+                
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    break;  /* stdout is gone: drop the batch */
+                }
+                while (left > 0 && (size_t)written >= v->iov_len) {
+                    written -= (ssize_t)v->iov_len;
+                    v++;
+                    left--;
+                }
+                if (left > 0) {
+                    v->iov_base = (char*)v->iov_base + written;
+                    v->iov_len -= (size_t)written;
+                }
+            }
+        }
+        
+        /* Only now hand the slots back to their producers */
+        for (i = 0; i < n; i++) {
+            __atomic_store_n(&ring_of[i]->tail, ring_of[i]->tail + 1, __ATOMIC_RELEASE);
+        }
+    } while (n == LOG_BATCH_MAX);
+}
+
+void log_flush(void) {
+    pthread_mutex_lock(&log_drain_lock);
+    log_drain_locked();
+    pthread_mutex_unlock(&log_drain_lock);
+}
+
+static void* log_writer_thread(void* arg) {
+    (void)arg;
     
+    for (;;) {
+        log_flush();
+        sleep_ms(LOG_FLUSH_INTERVAL_MS);
+    }
+    return NULL;
+}
+
+/* fork(): drain first so the child does not print the parent's lines again */
+static void log_atfork_prepare(void) {
     pthread_mutex_lock(&log_mutex);
+    pthread_mutex_lock(&log_drain_lock);
+    log_drain_locked();
+}
+
+static void log_atfork_parent(void) {
+    pthread_mutex_unlock(&log_drain_lock);
+    pthread_mutex_unlock(&log_mutex);
+}
+
+static void log_atfork_child(void) {
+    int i;
     
-    get_time_string(time_str, sizeof(time_str));
-    printf("[%s] ", time_str);
-    
-    va_start(args, format);
-    vprintf(format, args);
-    va_end(args);
+    /* Lines other threads queued during fork() belong to the parent */
+    for (i = 0; i < log_num_rings && i < LOG_MAX_RINGS; i++) {
+        if (log_rings[i] != NULL) {
+            log_rings[i]->tail = log_rings[i]->head;
+        }
+    }
+    pthread_mutex_unlock(&log_drain_lock);
+    pthread_mutex_unlock(&log_mutex);
+}
+
+/* Start this process's writer thread (again after fork) */
+static void log_start_writer(void) {
+    pid_t pid = getpid();
     
-    printf("\n");
-    fflush(stdout);
+    if (__atomic_load_n(&log_writer_pid, __ATOMIC_ACQUIRE) == pid) return;
     
+    pthread_mutex_lock(&log_mutex);
+    if (log_writer_pid != pid) {
+        pthread_t tid;
+        pthread_attr_t attr;
+        
+        if (!log_hooks_installed) {
+            pthread_atfork(log_atfork_prepare, log_atfork_parent, log_atfork_child);
+            atexit(log_flush);
+            log_hooks_installed = 1;
+        }
+        
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&tid, &attr, log_writer_thread, NULL) == 0) {
+            __atomic_store_n(&log_writer_pid, pid, __ATOMIC_RELEASE);
+        }
+        pthread_attr_destroy(&attr);
+    }
     pthread_mutex_unlock(&log_mutex);
 }
 
-void log_family(int family_id, const char* format, ...) {
-    char time_str[16];
-    va_list args;
+static LogRing* log_get_ring(void) {
+    LogRing* ring;
+    int idx;
     
-    pthread_mutex_lock(&log_mutex);
+    if (log_my_ring != NULL) return log_my_ring;
     
-    get_time_string(time_str, sizeof(time_str));
-    printf("[%s] [Family %d] ", time_str, family_id);
+    ring = (LogRing*)calloc(1, sizeof(LogRing));
+    if (ring == NULL) return NULL;
     
-    va_start(args, format);
-    vprintf(format, args);
-    va_end(args);
+    idx = __atomic_fetch_add(&log_num_rings, 1, __ATOMIC_ACQ_REL);
+    if (idx >= LOG_MAX_RINGS) {
+        free(ring);
+        return NULL;
+    }
+    __atomic_store_n(&log_rings[idx], ring, __ATOMIC_RELEASE);
+    log_my_ring = ring;
+    return ring;
+}
+
+/*
+ * Format one line ("[HH:MM:SS] <prefix><message>\n") into the calling
+ * thread's ring
+ */
+static void log_vwrite(const char* prefix, const char* format, va_list args) {
+    LogRing* ring;
+    LogSlot* slot;
+    uint64_t head;
+    int len, room;
+    
+    log_start_writer();
+    
+    ring = log_get_ring();
+    if (ring == NULL) {
+        /* More threads than rings: write this line directly */
+        char line[LOG_LINE_MAX];
+        
+        len = snprintf(line, sizeof(line), "[%s] %s", log_timestamp(), prefix);
+        if (len < 0 || len >= (int)sizeof(line) - 1) len = (int)sizeof(line) - 2;
+        len += vsnprintf(line + len, sizeof(line) - (size_t)len - 1, format, args);
+        if (len > (int)sizeof(line) - 2) len = (int)sizeof(line) - 2;
+        line[len++] = '\n';
+        pthread_mutex_lock(&log_drain_lock);
+        if (write(STDOUT_FILENO, line, (size_t)len) < 0) { /* nothing to do */ }
+        pthread_mutex_unlock(&log_drain_lock);
+        return;
+    }
     
-    printf("\n");
-    fflush(stdout);
+    /* Ring full: drain it ourselves rather than drop the line */
+    head = ring->head;
+    while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SLOTS) {
+        log_flush();
+    }
     
-    pthread_mutex_unlock(&log_mutex);
+    slot = &ring->slots[head & (LOG_RING_SLOTS - 1)];
+    room = LOG_LINE_MAX - 1;  /* Reserve the newline */
+    
+    len = snprintf(slot->text, (size_t)room, "[%s] %s", log_timestamp(), prefix);
+    if (len < 0 || len >= room) len = room - 1;
+    len += vsnprintf(slot->text + len, (size_t)(room - len), format, args);
+    if (len >= room) len = room - 1;
+    slot->text[len++] = '\n';
+    slot->len = (uint32_t)len;
+    
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
 }
 
-void log_female(int family_id, const char* format, ...) {
-    char time_str[16];
+void log_event(const char* format, ...) {
     va_list args;
     
-    pthread_mutex_lock(&log_mutex);
-    
-    get_time_string(time_str, sizeof(time_str));
-    printf("[%s] [Family %d] [Female] ", time_str, family_id);
-    
     va_start(args, format);
-    vprintf(format, args);
+    log_vwrite("", format, args);
     va_end(args);
+}
+
+void log_family(int family_id, const char* format, ...) {
+    char prefix[32];
+    va_list args;
     
-    printf("\n");
-    fflush(stdout);
+    snprintf(prefix, sizeof(prefix), "[Family %d] ", family_id);
+    va_start(args, format);
+    log_vwrite(prefix, format, args);
+    va_end(args);
+}
+
+void log_female(int family_id, const char* format, ...) {
+    char prefix[32];
+    va_list args;
     
-    pthread_mutex_unlock(&log_mutex);
+    snprintf(prefix, sizeof(prefix), "[Family %d] [Female] ", family_id);
+    va_start(args, format);
+    log_vwrite(prefix, format, args);
+    va_end(args);
 }
 
 void log_male(int family_id, const char* format, ...) {
-    char time_str[16];
+    char prefix[32];
     va_list args;
     
-    pthread_mutex_lock(&log_mutex);
-    
-    get_time_string(time_str, sizeof(time_str));
-    printf("[%s] [Family %d] [Male] ", time_str, family_id);
-    
+    snprintf(prefix, sizeof(prefix), "[Family %d] [Male] ", family_id);
     va_start(args, format);
-    vprintf(format, args);
+    log_vwrite(prefix, format, args);
     va_end(args);
-    
-    printf("\n");
-    fflush(stdout);
-    
-    pthread_mutex_unlock(&log_mutex);
 }
 
 void log_baby(int family_id, int baby_id, const char* format, ...) {
-    char time_str[16];
+    char prefix[40];
     va_list args;
     
-    pthread_mutex_lock(&log_mutex);
-    
-    get_time_string(time_str, sizeof(time_str));
-    printf("[%s] [Family %d] [Baby %d] ", time_str, family_id, baby_id);
-    
+    snprintf(prefix, sizeof(prefix), "[Family %d] [Baby %d] ", family_id, baby_id);
     va_start(args, format);
-    vprintf(format, args);
+    log_vwrite(prefix, format, args);
     va_end(args);
-    
-    printf("\n");
-    fflush(stdout);
-    
-    pthread_mutex_unlock(&log_mutex);
 }
 
 /* ==================== Shared Memory Helpers ==================== */
 
-int create_shared_memory(size_t size, int key) {
-    int shm_id = shmget(key, size, IPC_CREAT | 0666);
-    if (shm_id < 0) {
-        perror("shmget failed");
-        return -1;
+void* create_shared_memory(const char* name, size_t* size, int use_hugepages) {
+    void* ptr;
+    int fd;
+    
+    if (name == NULL) {
+        /* Anonymous mapping: visible only to this process and its forks */
+#ifdef MAP_HUGETLB
+        if (use_hugepages) {
+            size_t huge_size = (*size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+            ptr = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (ptr != MAP_FAILED) {
+                *size = huge_size;
+                return ptr;
+            }
+            fprintf(stderr, "Warning: MAP_HUGETLB failed (%s), using normal pages\n", strerror(errno));
+        }
+#endif
+        ptr = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            perror("mmap failed");
+            return NULL;
+        }
+        return ptr;
     }
-    return shm_id;
-}
-
-void* attach_shared_memory(int shm_id) {
-    void* ptr = shmat(shm_id, NULL, 0);
-    if (ptr == (void*)-1) {
-        perror("shmat failed");
+    
+    /* Named POSIX segment so external readers (apes_viewer) can attach */
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        if (errno == EEXIST) {
+            fprintf(stderr, "Shared memory %s already exists (stale run? try 'make clean-shm')\n", name);
+        } else {
+            perror("shm_open failed");
+        }
+        return NULL;
+    }
+    
+    if (ftruncate(fd, (off_t)*size) != 0) {
+        perror("ftruncate failed");
+        close(fd);
+        shm_unlink(name);
         return NULL;
     }
+    
+    ptr = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  /* The mapping keeps the segment alive */
+    if (ptr == MAP_FAILED) {
+        perror("mmap failed");
+        shm_unlink(name);
+        return NULL;
+    }
+    
+#ifdef MADV_HUGEPAGE
+    /* hugetlb pages cannot back a tmpfs object; ask for transparent ones */
+    if (use_hugepages) {
+        madvise(ptr, *size, MADV_HUGEPAGE);
+    }
+#else
+    (void)use_hugepages;
+#endif
+    
     return ptr;
 }
 
-void detach_shared_memory(void* ptr) {
+void detach_shared_memory(void* ptr, size_t size) {
     if (ptr != NULL) {
-        shmdt(ptr);
+        munmap(ptr, size);
     }
 }
 
-void destroy_shared_memory(int shm_id) {
-    shmctl(shm_id, IPC_RMID, NULL);
+void destroy_shared_memory(const char* name) {
+    if (name != NULL && name[0] != '\0') {
+        shm_unlink(name);
+    }
 }
 
 /* ==================== Console Helpers ==================== */
@@ -240,26 +599,43 @@ void set_shared_for_events(SharedData* shared) {
     g_shared_for_events = shared;
 }
 
+/* Yields to wait for a lagging producer before overwriting its slot anyway */
+#define EVENT_SLOT_WAIT_LIMIT 1000
+
 void add_shared_event(SharedData* shared, const char* format, ...) {
-    if (shared == NULL) return;
+    char message[MAX_EVENT_LEN];
+    uint64_t ticket, expected;
+    EventEntry* entry;
+    int waits = 0;
     
-    sem_wait(&shared->event_lock);
-    
-    /* Get current timestamp */
-    double elapsed = difftime(time(NULL), shared->start_time);
-    
-    /* Format the message */
-    EventEntry* entry = &shared->recent_events[shared->event_head];
-    entry->timestamp = elapsed;
+    if (shared == NULL) return;
     
+    /* Format outside the ring: producers only contend on one fetch-add */
     va_list args;
     va_start(args, format);
-    vsnprintf(entry->message, MAX_EVENT_LEN - 1, format, args);
+    vsnprintf(message, sizeof(message), format, args);
     va_end(args);
-    entry->message[MAX_EVENT_LEN - 1] = '\0';
     
-    /* Advance head (circular) */
-    shared->event_head = (shared->event_head + 1) % MAX_EVENTS;
+    /* Get current timestamp (simulated seconds under virtual time) */
+    double elapsed = sim_elapsed_seconds(shared);
     
-    sem_post(&shared->event_lock);
+    /* Reserve a ticket; its slot is reused once per lap of the ring */
+    ticket = __atomic_fetch_add(&shared->event_next, 1, __ATOMIC_RELAXED);
+    entry = event_slot(shared, ticket);
+    
+    /* The previous lap's writer must be done with the slot. A producer
+     * killed mid-write would never finish, so only wait a bounded time. */
+    expected = (ticket >= (uint64_t)shared->event_capacity)
+             ? ticket - (uint64_t)shared->event_capacity + 1 : 0;
+    while (__atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE) != expected &&
+           waits++ < EVENT_SLOT_WAIT_LIMIT) {
+        sched_yield();
+    }
+    
+    /* Mark busy, write, then publish: readers retry on a seq mismatch */
+    __atomic_store_n(&entry->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    entry->timestamp = elapsed;
+    memcpy(entry->message, message, sizeof(message));
+    __atomic_store_n(&entry->seq, ticket + 1, __ATOMIC_RELEASE);
 }
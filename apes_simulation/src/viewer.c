@@ -9,13 +9,15 @@
     #include <OpenGL/glu.h>
     #include <GLUT/glut.h>
 #else
+    #define GL_GLEXT_PROTOTYPES  /* Buffer objects (OpenGL 1.5) */
     #include <GL/gl.h>
     #include <GL/glu.h>
     #include <GL/glut.h>
 #endif
 
-#include <sys/shm.h>
-#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <time.h>
 #include "../include/shared_data.h"
@@ -30,9 +32,20 @@
 /* Animation */
 #define ANIMATION_INTERVAL 50  /* ms between frames */
 
+/* Level of detail, by cell size in pixels */
+#define DETAIL_MIN_CELL 8.0f   /* Smaller: obstacles and bananas drawn as points */
+#define GRID_MIN_CELL 4.0f     /* Smaller: no grid lines */
+#define LABEL_MIN_CELL 20.0f   /* Smaller: no banana counts or family numbers */
+
+#define BANANA_SEGMENTS 10     /* Points on a banana's outline */
+#define PARKED_COORD -100.0f   /* Empty banana slots sit off screen */
+#define STAGING_SLOTS 1024     /* Banana slots uploaded per glBufferSubData */
+#define CONNECT_RETRY_TICKS 10 /* Timer ticks between attach attempts (500 ms) */
+
 /* Shared memory */
 static SharedData* shared = NULL;
-static int shm_id = -1;
+static size_t shm_size = 0;
+static const char* shm_name = NULL;
 
 /* Colors for families */
 static float family_colors[][3] = {
@@ -48,12 +61,52 @@ static float family_colors[][3] = {
 /* Animation state */
 static float time_offset = 0.0f;
 
+/* Our copy of the published snapshot as of this frame (see read_snapshot()) */
+static Snapshot view;
+static FamilyStatus* families = NULL;   /* num_families entries */
+static int32_t* ape_cells = NULL;       /* Per family: its female's cell, -1 = not in the maze */
+static int32_t* banana_counts = NULL;   /* Per cell: bananas, for the labels */
+
+/* Interleaved vertex of the retained geometry */
+typedef struct {
+    float x, y;
+    float r, g, b;
+} Vertex;
+
+/* Retained maze geometry, built once the simulation has started: the
+ * static layer never changes, banana slots are rewritten only for cells
+ * whose banana changed, and apes share one mesh per family colour */
+static int layers_ready = 0;
+static int layer_rows = 0, layer_cols = 0;
+static float cell_size, start_x, start_y;
+static int detailed;                    /* cell_size >= DETAIL_MIN_CELL */
+static GLuint static_vbo;               /* Backgrounds and obstacles, then grid lines */
+static int static_tris, static_points, static_lines;   /* Vertex counts, in that order */
+static GLuint banana_vbo;               /* One slot of banana_slot vertices per cell */
+static int banana_slot;
+static unsigned char* banana_shown;     /* Per cell: 1 if its slot holds a banana */
+static Vertex* staging;                 /* STAGING_SLOTS slots on their way to banana_vbo */
+static GLuint monkey_vbo;               /* Unit-size monkey, once per family colour */
+static int monkey_vertices;             /* Vertices per monkey mesh */
+
+/* Our copies of the snapshot's change counters (groups, then blocks; see
+ * Snapshot), those the current copy read and which of them moved, and what
+ * the last posted frame showed */
+static uint32_t* seen_counts = NULL;
+static uint32_t* counts = NULL;
+static int* changed = NULL;
+static int full_scan;                   /* 1 until every banana slot has been filled */
+static uint32_t drawn_generation;
+static int drawn_running;
+static long long drawn_second;
+
 /* Forward declarations */
 void display(void);
 void reshape(int w, int h);
 void timer(int value);
 void keyboard(unsigned char key, int x, int y);
 void cleanup(void);
+int connect_shared_memory(void);
 
 /* ==================== Drawing Helpers ==================== */
 
@@ -83,176 +136,461 @@ void draw_rect_outline(float x, float y, float w, float h) {
     glEnd();
 }
 
-void draw_circle(float cx, float cy, float r, int segments) {
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2f(cx, cy);
-    for (int i = 0; i <= segments; i++) {
-        float theta = 2.0f * 3.14159f * i / segments;
-        glVertex2f(cx + r * cosf(theta), cy + r * sinf(theta));
+/* ==================== Geometry ==================== */
+
+static Vertex* put_vertex(Vertex* v, float x, float y, const float* color) {
+    v->x = x;
+    v->y = y;
+    v->r = color[0];
+    v->g = color[1];
+    v->b = color[2];
+    return v + 1;
+}
+
+static Vertex* put_triangle(Vertex* v, float x1, float y1, float x2, float y2,
+                            float x3, float y3, const float* color) {
+    v = put_vertex(v, x1, y1, color);
+    v = put_vertex(v, x2, y2, color);
+    return put_vertex(v, x3, y3, color);
+}
+
+static Vertex* put_quad(Vertex* v, float x, float y, float w, float h, const float* color) {
+    v = put_triangle(v, x, y, x + w, y, x + w, y + h, color);
+    return put_triangle(v, x, y, x + w, y + h, x, y + h, color);
+}
+
+/* Filled circle as segments triangles */
+static Vertex* put_disc(Vertex* v, float cx, float cy, float r, int segments, const float* color) {
+    for (int i = 0; i < segments; i++) {
+        float t0 = 2.0f * 3.14159f * i / segments;
+        float t1 = 2.0f * 3.14159f * (i + 1) / segments;
+        v = put_triangle(v, cx, cy, cx + r * cosf(t0), cy + r * sinf(t0),
+                         cx + r * cosf(t1), cy + r * sinf(t1), color);
     }
-    glEnd();
+    return v;
 }
 
-void draw_banana(float x, float y, float size) {
-    /* Draw a simple banana shape */
-    glColor3f(1.0f, 0.9f, 0.0f);  /* Yellow */
-    
-    /* Banana body (curved rectangle approximation) */
-    glBegin(GL_POLYGON);
-    for (int i = 0; i <= 20; i++) {
-        float t = (float)i / 20.0f;
-        float angle = t * 3.14159f * 0.7f - 0.35f;
-        float r = size * 0.4f;
-        float cx = x + size * 0.3f;
-        float cy = y + size * 0.5f;
-        glVertex2f(cx + r * cosf(angle), cy + r * sinf(angle) * 0.5f);
+/* Vertices put_banana() writes */
+#define BANANA_VERTICES (3 * (BANANA_SEGMENTS - 1) + 6)
+
+/* Banana in the size x size square at (x, y): curved body and stem */
+static Vertex* put_banana(Vertex* v, float x, float y, float size) {
+    static const float yellow[3] = {1.0f, 0.9f, 0.0f};
+    static const float brown[3] = {0.5f, 0.3f, 0.0f};
+    float px[BANANA_SEGMENTS + 1], py[BANANA_SEGMENTS + 1];
+    float r = size * 0.4f;
+    float cx = x + size * 0.3f;
+    float cy = y + size * 0.5f;
+    
+    /* Body: fan over the outline of an arc */
+    for (int i = 0; i <= BANANA_SEGMENTS; i++) {
+        float angle = (float)i / BANANA_SEGMENTS * 3.14159f * 0.7f - 0.35f;
+        px[i] = cx + r * cosf(angle);
+        py[i] = cy + r * sinf(angle) * 0.5f;
+    }
+    for (int i = 1; i < BANANA_SEGMENTS; i++) {
+        v = put_triangle(v, px[0], py[0], px[i], py[i], px[i + 1], py[i + 1], yellow);
     }
-    glEnd();
     
-    /* Stem */
-    glColor3f(0.5f, 0.3f, 0.0f);  /* Brown */
-    glBegin(GL_LINES);
-    glVertex2f(x + size * 0.1f, y + size * 0.45f);
-    glVertex2f(x + size * 0.25f, y + size * 0.55f);
-    glEnd();
+    /* Stem: a one-pixel strip */
+    v = put_triangle(v, x + size * 0.1f, y + size * 0.45f, x + size * 0.25f, y + size * 0.55f,
+                     x + size * 0.25f, y + size * 0.55f + 1.0f, brown);
+    return put_triangle(v, x + size * 0.1f, y + size * 0.45f, x + size * 0.25f, y + size * 0.55f + 1.0f,
+                        x + size * 0.1f, y + size * 0.45f + 1.0f, brown);
+}
+
+/* Rock with highlight and shadow, filling the size x size cell at (x, y) */
+static Vertex* put_obstacle(Vertex* v, float x, float y, float size) {
+    static const float rock[3] = {0.4f, 0.4f, 0.45f};
+    static const float highlight[3] = {0.5f, 0.5f, 0.55f};
+    static const float shadow[3] = {0.3f, 0.3f, 0.35f};
+    
+    v = put_quad(v, x + 2, y + 2, size - 4, size - 4, rock);
+    v = put_triangle(v, x + 2, y + size - 2, x + 2, y + 2, x + size - 2, y + 2, highlight);
+    return put_triangle(v, x + size - 2, y + 2, x + size - 2, y + size - 2, x + 2, y + size - 2, shadow);
+}
+
+/* Monkey of unit size in a family colour; later parts are drawn on top */
+static Vertex* put_monkey(Vertex* v, const float* color) {
+    const float body[3] = {color[0] * 0.7f, color[1] * 0.5f, color[2] * 0.3f};
+    const float head[3] = {color[0] * 0.8f, color[1] * 0.6f, color[2] * 0.4f};
+    const float face[3] = {0.9f, 0.8f, 0.7f};
+    const float eyes[3] = {0.0f, 0.0f, 0.0f};
+    const float ears[3] = {color[0] * 0.6f, color[1] * 0.4f, color[2] * 0.3f};
+    
+    v = put_disc(v, 0.5f, 0.4f, 0.35f, 16, body);
+    v = put_disc(v, 0.5f, 0.75f, 0.25f, 16, head);
+    v = put_disc(v, 0.5f, 0.7f, 0.15f, 12, face);
+    v = put_disc(v, 0.42f, 0.78f, 0.05f, 8, eyes);
+    v = put_disc(v, 0.58f, 0.78f, 0.05f, 8, eyes);
+    v = put_disc(v, 0.25f, 0.8f, 0.1f, 8, ears);
+    return put_disc(v, 0.75f, 0.8f, 0.1f, 8, ears);
+}
+
+/* Vertices put_monkey() writes */
+#define MONKEY_VERTICES (3 * (16 + 16 + 12 + 8 + 8 + 8 + 8))
+
+/* ==================== Retained Layers ==================== */
+
+static void cell_origin(int row, int col, float* x, float* y) {
+    *x = start_x + col * cell_size;
+    *y = start_y + (layer_rows - 1 - row) * cell_size;  /* Flip Y */
+}
+
+/*
+ * Write one cell's banana slot: the banana, or vertices parked off screen
+ */
+static void fill_banana_slot(Vertex* v, int cell, int shown) {
+    static const float yellow[3] = {1.0f, 0.9f, 0.0f};
+    float x, y;
+    
+    if (!shown) {
+        for (int i = 0; i < banana_slot; i++) {
+            v = put_vertex(v, PARKED_COORD, PARKED_COORD, yellow);
+        }
+        return;
+    }
+    cell_origin(cell / layer_cols, cell % layer_cols, &x, &y);
+    if (detailed) {
+        put_banana(v, x + cell_size * 0.2f, y + cell_size * 0.2f, cell_size * 0.6f);
+    } else {
+        put_vertex(v, x + cell_size * 0.5f, y + cell_size * 0.5f, yellow);
+    }
+}
+
+static void upload(GLuint vbo, const Vertex* vertices, int count, GLenum usage) {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)count * sizeof(Vertex), vertices, usage);
+}
+
+/* The host-side arrays that go with the layers */
+static void free_copies(void) {
+    free(banana_shown);
+    free(staging);
+    free(seen_counts);
+    free(counts);
+    free(changed);
+    free(families);
+    free(ape_cells);
+    free(banana_counts);
+    banana_shown = NULL;
+    staging = NULL;
+    seen_counts = NULL;
+    counts = NULL;
+    changed = NULL;
+    families = NULL;
+    ape_cells = NULL;
+    banana_counts = NULL;
+}
+
+static void release_layers(void) {
+    if (!layers_ready) return;
+    glDeleteBuffers(1, &static_vbo);
+    glDeleteBuffers(1, &banana_vbo);
+    glDeleteBuffers(1, &monkey_vbo);
+    free_copies();
+    layers_ready = 0;
+}
+
+/* Run of adjacent changed slots waiting in staging */
+static int run_first = 0, run_count = 0;
+
+static void flush_run(void) {
+    if (run_count == 0) return;
+    glBindBuffer(GL_ARRAY_BUFFER, banana_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    (GLintptr)(sizeof(Vertex) * (size_t)banana_slot * (size_t)run_first),
+                    (GLsizeiptr)(sizeof(Vertex) * (size_t)banana_slot * (size_t)run_count), staging);
+    run_count = 0;
+}
+
+/*
+ * Rewrite the slots of cells [first, last) whose banana appeared or went
+ * away in the snapshot (taken, or covered by an ape); adjacent changed
+ * cells go up in one upload
+ */
+static void update_cells(int first, int last) {
+    for (int c = first; c < last; c++) {
+        int i = c / layer_cols, j = c % layer_cols;
+        const SnapshotCell* cell = snapshot_cell(shared, i, j);
+        unsigned char shown = !maze_cell(shared, i, j)->is_obstacle &&
+                              cell->bananas > 0 && cell->ape < 0;
+        
+        banana_counts[c] = cell->bananas;
+        if (shown == banana_shown[c]) continue;
+        banana_shown[c] = shown;
+        
+        if (run_count > 0 && (c != run_first + run_count || run_count == STAGING_SLOTS)) {
+            flush_run();
+        }
+        if (run_count == 0) run_first = c;
+        fill_banana_slot(staging + (size_t)run_count * banana_slot, c, shown);
+        run_count++;
+    }
 }
 
-void draw_monkey(float x, float y, float size, int family_id, float anim_offset) {
-    float* color = family_colors[family_id % NUM_COLORS];
+/*
+ * Rescan only the blocks whose snapshot counter moved since the last
+ * frame (all of them after build_layers()), skipping whole groups whose
+ * counter did not: the cost follows how much happened, not the size of
+ * the maze
+ * Returns how many counters moved; the caller takes them over into
+ * seen_counts once the copy turns out not to be torn
+ */
+static int update_bananas(void) {
+    int num_cells = layer_rows * layer_cols;
+    int groups = change_groups(shared);
+    int n = snapshot_changed_counts(shared, seen_counts, counts, changed, full_scan);
+    
+    for (int i = 0; i < n; i++) {
+        int b = changed[i] - groups;
+        int last_cell = (b + 1) << CHANGE_BLOCK_SHIFT;
+        
+        if (b < 0) continue;  /* A group: its blocks follow */
+        update_cells(b << CHANGE_BLOCK_SHIFT, last_cell < num_cells ? last_cell : num_cells);
+    }
+    flush_run();
+    return n;
+}
+
+/*
+ * Lay out the maze and upload the static layer, the (empty) banana slots
+ * and the monkey meshes
+ * Returns 1 when ready, 0 if out of memory
+ */
+static int build_layers(int rows, int cols) {
+    static const float exit_bg[3] = {0.2f, 0.4f, 0.2f};
+    static const float maze_bg[3] = {0.15f, 0.18f, 0.15f};
+    static const float rock[3] = {0.4f, 0.4f, 0.45f};
+    static const float grid[3] = {0.3f, 0.35f, 0.3f};
+    size_t num_cells = (size_t)rows * (size_t)cols;
+    size_t num_counts = (size_t)(change_groups(shared) + change_blocks(shared));
+    int num_obstacles = 0;
+    Vertex* static_vertices;
+    Vertex* banana_vertices;
+    Vertex* monkey_mesh;
+    Vertex* v;
+    
+    release_layers();
+    layer_rows = rows;
+    layer_cols = cols;
     
-    /* Body bounce animation */
-    float bounce = sinf(anim_offset * 5.0f) * 2.0f;
-    y += bounce;
+    float cell_w = (float)(WINDOW_WIDTH - 2 * MARGIN) / cols;
+    float cell_h = (float)(WINDOW_HEIGHT - STATUS_HEIGHT - 2 * MARGIN) / rows;
+    cell_size = (cell_w < cell_h) ? cell_w : cell_h;
+    start_x = (WINDOW_WIDTH - cols * cell_size) / 2.0f;
+    start_y = MARGIN;
+    detailed = cell_size >= DETAIL_MIN_CELL;
     
-    /* Body */
-    glColor3f(color[0] * 0.7f, color[1] * 0.5f, color[2] * 0.3f);
-    draw_circle(x + size * 0.5f, y + size * 0.4f, size * 0.35f, 16);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if (maze_cell(shared, i, j)->is_obstacle) num_obstacles++;
+        }
+    }
     
-    /* Head */
-    glColor3f(color[0] * 0.8f, color[1] * 0.6f, color[2] * 0.4f);
-    draw_circle(x + size * 0.5f, y + size * 0.75f, size * 0.25f, 16);
+    /* Static layer: two background quads and the obstacles (12 vertices
+     * each, or one point), then the grid lines */
+    static_tris = 12 + (detailed ? 12 * num_obstacles : 0);
+    static_points = detailed ? 0 : num_obstacles;
+    static_lines = cell_size >= GRID_MIN_CELL ? 2 * (rows + 1 + cols + 1) : 0;
+    banana_slot = detailed ? BANANA_VERTICES : 1;
+    monkey_vertices = MONKEY_VERTICES;
+    
+    static_vertices = (Vertex*)malloc(sizeof(Vertex) * (size_t)(static_tris + static_points + static_lines));
+    banana_vertices = (Vertex*)malloc(sizeof(Vertex) * (size_t)banana_slot * num_cells);
+    monkey_mesh = (Vertex*)malloc(sizeof(Vertex) * (size_t)monkey_vertices * NUM_COLORS);
+    banana_shown = (unsigned char*)calloc(num_cells, 1);
+    staging = (Vertex*)malloc(sizeof(Vertex) * (size_t)banana_slot * STAGING_SLOTS);
+    seen_counts = (uint32_t*)malloc(sizeof(uint32_t) * num_counts);
+    counts = (uint32_t*)malloc(sizeof(uint32_t) * num_counts);
+    changed = (int*)malloc(sizeof(int) * num_counts);
+    families = (FamilyStatus*)malloc(sizeof(FamilyStatus) * (size_t)shared->num_families);
+    ape_cells = (int32_t*)malloc(sizeof(int32_t) * (size_t)shared->num_families);
+    banana_counts = (int32_t*)malloc(sizeof(int32_t) * num_cells);
+    if (static_vertices == NULL || banana_vertices == NULL || monkey_mesh == NULL ||
+        banana_shown == NULL || staging == NULL || seen_counts == NULL || counts == NULL ||
+        changed == NULL || families == NULL || ape_cells == NULL || banana_counts == NULL) {
+        free(static_vertices);
+        free(banana_vertices);
+        free(monkey_mesh);
+        free_copies();
+        return 0;
+    }
     
-    /* Face */
-    glColor3f(0.9f, 0.8f, 0.7f);
-    draw_circle(x + size * 0.5f, y + size * 0.7f, size * 0.15f, 12);
+    v = put_quad(static_vertices, start_x, start_y, cols * cell_size, (rows - 1) * cell_size, maze_bg);
+    v = put_quad(v, start_x, start_y + (rows - 1) * cell_size, cols * cell_size, cell_size, exit_bg);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            float x, y;
+            
+            if (!maze_cell(shared, i, j)->is_obstacle) continue;
+            cell_origin(i, j, &x, &y);
+            if (detailed) {
+                v = put_obstacle(v, x, y, cell_size);
+            } else {
+                v = put_vertex(v, x + cell_size * 0.5f, y + cell_size * 0.5f, rock);
+            }
+        }
+    }
+    if (static_lines > 0) {
+        for (int i = 0; i <= rows; i++) {
+            v = put_vertex(v, start_x, start_y + i * cell_size, grid);
+            v = put_vertex(v, start_x + cols * cell_size, start_y + i * cell_size, grid);
+        }
+        for (int j = 0; j <= cols; j++) {
+            v = put_vertex(v, start_x + j * cell_size, start_y, grid);
+            v = put_vertex(v, start_x + j * cell_size, start_y + rows * cell_size, grid);
+        }
+    }
     
-    /* Eyes */
-    glColor3f(0.0f, 0.0f, 0.0f);
-    draw_circle(x + size * 0.42f, y + size * 0.78f, size * 0.05f, 8);
-    draw_circle(x + size * 0.58f, y + size * 0.78f, size * 0.05f, 8);
+    /* Banana slots start empty; the first copy of the snapshot fills them */
+    for (size_t c = 0; c < num_cells; c++) {
+        fill_banana_slot(banana_vertices + c * banana_slot, (int)c, 0);
+    }
     
-    /* Ears */
-    glColor3f(color[0] * 0.6f, color[1] * 0.4f, color[2] * 0.3f);
-    draw_circle(x + size * 0.25f, y + size * 0.8f, size * 0.1f, 8);
-    draw_circle(x + size * 0.75f, y + size * 0.8f, size * 0.1f, 8);
+    for (int c = 0; c < NUM_COLORS; c++) {
+        put_monkey(monkey_mesh + c * monkey_vertices, family_colors[c]);
+    }
     
-    /* Family number */
-    glColor3f(1.0f, 1.0f, 1.0f);
-    char num[4];
-    snprintf(num, sizeof(num), "%d", family_id);
-    draw_text(x + size * 0.45f, y + size * 0.35f, num, GLUT_BITMAP_HELVETICA_12);
+    glGenBuffers(1, &static_vbo);
+    upload(static_vbo, static_vertices, static_tris + static_points + static_lines, GL_STATIC_DRAW);
+    glGenBuffers(1, &banana_vbo);
+    upload(banana_vbo, banana_vertices, banana_slot * (int)num_cells, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &monkey_vbo);
+    upload(monkey_vbo, monkey_mesh, monkey_vertices * NUM_COLORS, GL_STATIC_DRAW);
+    free(static_vertices);
+    free(banana_vertices);
+    free(monkey_mesh);
+    
+    /* The next copy of the snapshot fills every slot */
+    full_scan = 1;
+    layers_ready = 1;
+    return 1;
 }
 
-void draw_obstacle(float x, float y, float size) {
-    /* Rock/obstacle */
-    glColor3f(0.4f, 0.4f, 0.45f);
-    draw_rect(x + 2, y + 2, size - 4, size - 4);
-    
-    /* Highlight */
-    glColor3f(0.5f, 0.5f, 0.55f);
-    glBegin(GL_TRIANGLES);
-    glVertex2f(x + 2, y + size - 2);
-    glVertex2f(x + 2, y + 2);
-    glVertex2f(x + size - 2, y + 2);
-    glEnd();
+static void draw_vertices(GLuint vbo, GLenum mode, int first, int count) {
+    if (count == 0) return;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glVertexPointer(2, GL_FLOAT, sizeof(Vertex), (const GLvoid*)0);
+    glColorPointer(3, GL_FLOAT, sizeof(Vertex), (const GLvoid*)(2 * sizeof(float)));
+    glDrawArrays(mode, first, count);
+}
+
+/* ==================== Snapshot ==================== */
+
+/*
+ * Copy this frame's view of the simulation out of the published snapshot:
+ * the status, the families, the females' cells and the banana layer (see
+ * update_bananas()). A publish that overlaps the copy sends us round
+ * again; the simulation never waits for us.
+ * Returns 1 when there is something to draw, 0 if the simulation has not
+ * published a snapshot yet (or out of memory)
+ */
+static int read_snapshot(void) {
+    int rows = shared->maze_rows;
+    int cols = shared->maze_cols;
+    uint32_t seq;
+    int n;
+    
+    /* Nothing to draw until the simulation has laid out the segment and
+     * published the first snapshot (start_time is set once the run starts;
+     * the snapshot's counters are its last region) */
+    if (shared->maze_offset == 0 || shared->start_time == 0 ||
+        __atomic_load_n(&shared->snapshot.seq, __ATOMIC_ACQUIRE) == 0 ||
+        shared->maze_offset + (size_t)rows * (size_t)cols * sizeof(MazeCell) > shm_size ||
+        shared->snapshot.change_counts_offset + sizeof(uint32_t) *
+            (size_t)(change_groups(shared) + change_blocks(shared)) > shm_size) {
+        return 0;
+    }
+    if ((!layers_ready || rows != layer_rows || cols != layer_cols) && !build_layers(rows, cols)) {
+        return 0;
+    }
     
-    /* Shadow */
-    glColor3f(0.3f, 0.3f, 0.35f);
-    glBegin(GL_TRIANGLES);
-    glVertex2f(x + size - 2, y + 2);
-    glVertex2f(x + size - 2, y + size - 2);
-    glVertex2f(x + 2, y + size - 2);
-    glEnd();
+    do {
+        seq = snapshot_read_begin(shared);
+        memcpy(&view, &shared->snapshot, sizeof(Snapshot));
+        memcpy(families, snapshot_family(shared, 0), sizeof(FamilyStatus) * (size_t)shared->num_families);
+        memcpy(ape_cells, snapshot_female_cell(shared, 0), sizeof(int32_t) * (size_t)shared->num_families);
+        n = update_bananas();
+    } while (snapshot_read_retry(shared, seq));
+    
+    /* Slots rewritten from a torn copy were rewritten again by the last
+     * pass, as their counters had not been taken over */
+    snapshot_commit_counts(seen_counts, counts, changed, n);
+    full_scan = 0;
+    return 1;
 }
 
 /* ==================== Main Drawing ==================== */
 
 void draw_maze(void) {
-    if (shared == NULL) return;
+    int rows = layer_rows;
+    int cols = layer_cols;
+    
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    
+    /* Backgrounds and obstacles, then bananas */
+    glPointSize(cell_size > 1.0f ? cell_size : 1.0f);
+    draw_vertices(static_vbo, GL_TRIANGLES, 0, static_tris);
+    draw_vertices(static_vbo, GL_POINTS, static_tris, static_points);
+    if (detailed) {
+        draw_vertices(banana_vbo, GL_TRIANGLES, 0, banana_slot * rows * cols);
+    } else {
+        glPointSize(cell_size * 0.6f > 1.0f ? cell_size * 0.6f : 1.0f);
+        draw_vertices(banana_vbo, GL_POINTS, 0, rows * cols);
+    }
     
-    int rows = shared->maze_rows;
-    int cols = shared->maze_cols;
+    /* Draw apes from the copied family -> cell map: one pass over the
+     * families, not over every cell */
+    for (int f = 0; f < shared->num_families; f++) {
+        int32_t cell = ape_cells[f];
+        float x, y;
+        
+        if (cell < 0) continue;  /* At the basket */
+        cell_origin(cell / cols, cell % cols, &x, &y);
+        y += sinf((time_offset + f * 0.5f) * 5.0f) * 2.0f;  /* Body bounce */
+        
+        glPushMatrix();
+        glTranslatef(x, y, 0.0f);
+        glScalef(cell_size, cell_size, 1.0f);
+        draw_vertices(monkey_vbo, GL_TRIANGLES, (f % NUM_COLORS) * monkey_vertices, monkey_vertices);
+        glPopMatrix();
+    }
     
-    float cell_w = (float)(WINDOW_WIDTH - 2 * MARGIN) / cols;
-    float cell_h = (float)(WINDOW_HEIGHT - STATUS_HEIGHT - 2 * MARGIN) / rows;
-    float cell_size = (cell_w < cell_h) ? cell_w : cell_h;
+    /* Grid lines on top */
+    glLineWidth(1.0f);
+    draw_vertices(static_vbo, GL_LINES, static_tris + static_points, static_lines);
     
-    float start_x = (WINDOW_WIDTH - cols * cell_size) / 2.0f;
-    float start_y = MARGIN;
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-    /* Draw grid background */
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            float x = start_x + j * cell_size;
-            float y = start_y + (rows - 1 - i) * cell_size;  /* Flip Y */
-            
-            const MazeCell* cell = &shared->maze[i][j];
+    /* Labels: banana counts and family numbers, where cells are big enough */
+    if (cell_size >= LABEL_MIN_CELL) {
+        char text[12];
+        
+        glColor3f(1.0f, 1.0f, 1.0f);
+        for (int c = 0; c < rows * cols; c++) {
+            float x, y;
             
-            /* Cell background */
-            if (i == 0) {
-                /* Exit row - green tint */
-                glColor3f(0.2f, 0.4f, 0.2f);
-            } else {
-                glColor3f(0.15f, 0.18f, 0.15f);
-            }
-            draw_rect(x, y, cell_size - 1, cell_size - 1);
+            if (!banana_shown[c]) continue;
+            cell_origin(c / cols, c % cols, &x, &y);
+            snprintf(text, sizeof(text), "%d", banana_counts[c]);
+            draw_text(x + cell_size * 0.7f, y + cell_size * 0.2f, text, GLUT_BITMAP_HELVETICA_10);
+        }
+        for (int f = 0; f < shared->num_families; f++) {
+            int32_t cell = ape_cells[f];
+            float x, y;
             
-            if (cell->is_obstacle) {
-                draw_obstacle(x, y, cell_size);
-            } else {
-                /* Check for female ape */
-                int female_here = -1;
-                for (int k = 0; k < shared->num_families; k++) {
-                    if (cell->females_in_cell[k]) {
-                        female_here = k;
-                        break;
-                    }
-                }
-                
-                if (female_here >= 0) {
-                    /* Draw monkey */
-                    draw_monkey(x, y, cell_size, female_here, time_offset + female_here * 0.5f);
-                } else if (cell->bananas > 0) {
-                    /* Draw bananas */
-                    draw_banana(x + cell_size * 0.2f, y + cell_size * 0.2f, cell_size * 0.6f);
-                    
-                    /* Show count */
-                    glColor3f(1.0f, 1.0f, 1.0f);
-                    char count[4];
-                    snprintf(count, sizeof(count), "%d", cell->bananas);
-                    draw_text(x + cell_size * 0.7f, y + cell_size * 0.2f, count, 
-                             GLUT_BITMAP_HELVETICA_10);
-                }
-            }
+            if (cell < 0) continue;
+            cell_origin(cell / cols, cell % cols, &x, &y);
+            y += sinf((time_offset + f * 0.5f) * 5.0f) * 2.0f;
+            snprintf(text, sizeof(text), "%d", f);
+            draw_text(x + cell_size * 0.45f, y + cell_size * 0.35f, text, GLUT_BITMAP_HELVETICA_12);
         }
     }
     
-    /* Draw grid lines */
-    glColor3f(0.3f, 0.35f, 0.3f);
-    glLineWidth(1.0f);
-    for (int i = 0; i <= rows; i++) {
-        glBegin(GL_LINES);
-        glVertex2f(start_x, start_y + i * cell_size);
-        glVertex2f(start_x + cols * cell_size, start_y + i * cell_size);
-        glEnd();
-    }
-    for (int j = 0; j <= cols; j++) {
-        glBegin(GL_LINES);
-        glVertex2f(start_x + j * cell_size, start_y);
-        glVertex2f(start_x + j * cell_size, start_y + rows * cell_size);
-        glEnd();
-    }
-    
     /* Exit label */
     glColor3f(0.5f, 1.0f, 0.5f);
     draw_text(start_x + cols * cell_size / 2 - 20, start_y + rows * cell_size + 5, 
@@ -260,8 +598,6 @@ void draw_maze(void) {
 }
 
 void draw_status(void) {
-    if (shared == NULL) return;
-    
     float y = WINDOW_HEIGHT - STATUS_HEIGHT + 20;
     
     /* Title bar */
@@ -277,13 +613,12 @@ void draw_status(void) {
     glColor3f(0.8f, 0.8f, 0.8f);
     char status[128];
     
-    if (shared->simulation_running) {
-        time_t elapsed = time(NULL) - shared->start_time;
-        snprintf(status, sizeof(status), "Time: %lds  |  Bananas in maze: %d  |  Withdrawn: %d",
-                 elapsed, shared->total_bananas_in_maze, shared->withdrawn_count);
+    if (view.simulation_running) {
+        snprintf(status, sizeof(status), "Time: %llds  |  Bananas in maze: %d  |  Withdrawn: %d",
+                 view.elapsed_ms / 1000, view.total_bananas_in_maze, view.withdrawn_count);
     } else {
         const char* reason = "Unknown";
-        switch (shared->termination_reason) {
+        switch (view.termination_reason) {
             case TERM_WITHDRAWN_THRESHOLD: reason = "Too many withdrawals"; break;
             case TERM_BASKET_THRESHOLD: reason = "Basket threshold reached"; break;
             case TERM_BABY_ATE_THRESHOLD: reason = "Baby ate too much"; break;
@@ -298,7 +633,7 @@ void draw_status(void) {
     float box_width = (WINDOW_WIDTH - 40) / shared->num_families;
     
     for (int i = 0; i < shared->num_families; i++) {
-        FamilyStatus* f = &shared->families[i];
+        const FamilyStatus* f = &families[i];
         float bx = 20 + i * box_width;
         float by = y;
         
@@ -381,6 +716,10 @@ void display(void) {
                   "Waiting for simulation...", GLUT_BITMAP_HELVETICA_18);
         draw_text(WINDOW_WIDTH / 2 - 80, WINDOW_HEIGHT / 2 - 30, 
                   "Run: ./apes_simulation", GLUT_BITMAP_HELVETICA_12);
+    } else if (!read_snapshot()) {
+        glColor3f(1.0f, 0.5f, 0.5f);
+        draw_text(WINDOW_WIDTH / 2 - 100, WINDOW_HEIGHT / 2, 
+                  "Waiting for simulation...", GLUT_BITMAP_HELVETICA_18);
     } else {
         draw_maze();
         draw_status();
@@ -398,27 +737,76 @@ void reshape(int w, int h) {
     glLoadIdentity();
 }
 
+/*
+ * Map the simulation's POSIX shared memory read-only
+ * The segment is sized for the running maze, so its size comes from fstat
+ * Returns 1 when connected, 0 if the simulation is not running (yet)
+ */
+int connect_shared_memory(void) {
+    struct stat st;
+    void* ptr;
+    int fd;
+    
+    fd = shm_open(shm_name, O_RDONLY, 0);
+    if (fd < 0) return 0;
+    
+    /* The creator sizes the segment right after creating it */
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SharedData)) {
+        close(fd);
+        return 0;
+    }
+    
+    ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) return 0;
+    
+    shared = (SharedData*)ptr;
+    shm_size = (size_t)st.st_size;
+    return 1;
+}
+
 void timer(int value) {
+    static int connect_wait = 0;
     (void)value;
+    glutTimerFunc(ANIMATION_INTERVAL, timer, 0);
     
-    /* Try to connect to shared memory if not connected */
+    /* Try to connect to shared memory if not connected, every
+     * CONNECT_RETRY_TICKS ticks; the waiting screen needs no redraw */
     if (shared == NULL) {
-        shm_id = shmget(SHM_KEY, sizeof(SharedData), 0666);
-        if (shm_id >= 0) {
-            shared = (SharedData*)shmat(shm_id, NULL, 0);
-            if (shared == (void*)-1) {
-                shared = NULL;
-            } else {
-                printf("Connected to simulation shared memory\n");
-            }
-        }
+        if (connect_wait-- > 0) return;
+        connect_wait = CONNECT_RETRY_TICKS;
+        if (!connect_shared_memory()) return;
+        printf("Connected to simulation shared memory\n");
+        glutPostRedisplay();
+        return;
     }
     
+    /* Redraw only when the snapshot reports a change, the clock on the
+     * status bar ticked, or the run stopped; until the maze is laid out
+     * keep polling */
+    uint32_t generation, seq;
+    int running;
+    long long second;
+    
+    do {
+        seq = snapshot_read_begin(shared);
+        generation = shared->snapshot.change_generation;
+        running = shared->snapshot.simulation_running;
+        second = shared->snapshot.elapsed_ms / 1000;
+    } while (snapshot_read_retry(shared, seq));
+    
+    if (layers_ready && generation == drawn_generation && running == drawn_running &&
+        (!running || second == drawn_second)) {
+        return;
+    }
+    drawn_generation = generation;
+    drawn_running = running;
+    drawn_second = second;
+    
     /* Update animation */
     time_offset += 0.05f;
     
     glutPostRedisplay();
-    glutTimerFunc(ANIMATION_INTERVAL, timer, 0);
 }
 
 void keyboard(unsigned char key, int x, int y) {
@@ -432,15 +820,23 @@ void keyboard(unsigned char key, int x, int y) {
 
 void cleanup(void) {
     if (shared != NULL) {
-        shmdt(shared);
+        munmap(shared, shm_size);
         shared = NULL;
     }
+    release_layers();
     printf("Viewer closed\n");
 }
 
 /* ==================== Main ==================== */
 
 int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <shm_name>\n", argv[0]);
+        fprintf(stderr, "  The name is printed by apes_simulation at startup (e.g. /apes_sim_1234)\n");
+        return 1;
+    }
+    shm_name = argv[1];
+    
     printf("\n");
     printf("╔════════════════════════════════════════════════════════════════╗\n");
     printf("║        APES SIMULATION - OpenGL Viewer                         ║\n");
@@ -468,17 +864,10 @@ int main(int argc, char** argv) {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     /* Try initial connection */
-    shm_id = shmget(SHM_KEY, sizeof(SharedData), 0666);
-    if (shm_id >= 0) {
-        shared = (SharedData*)shmat(shm_id, NULL, 0);
-        if (shared == (void*)-1) {
-            shared = NULL;
-            printf("Shared memory exists but couldn't attach. Waiting...\n");
-        } else {
-            printf("Connected to simulation!\n");
-        }
+    if (connect_shared_memory()) {
+        printf("Connected to simulation!\n");
     } else {
-        printf("Simulation not running yet. Waiting for connection...\n");
+        printf("Simulation not running yet. Waiting for %s...\n", shm_name);
     }
     
     /* Register cleanup */